@@ -2360,9 +2360,11 @@ int _EditBot(lua_State *L)
 		}
 
 		robot->mClass = (tUserCl)clas; // set new class
+		serv->OnUserClassChange(robot); // move to new class in recipient indexes
 	}
 
 	serv->mP.Create_MyINFO(robot->mMyINFO, nick, desc, conn, mail, shar, false); // send new myinfo after quit, dont reserve for pipe, we are not sending this
+	serv->mUserList.OnInfoChange(robot);
 
 #ifdef USE_BUFFER_RESERVE
 	if (temp.capacity() < (robot->mMyINFO.size() + 1)) // reserve for pipe
@@ -503,22 +503,22 @@ bool cpiLua::OnParsedMsgSearch(cConnDC *conn, cMessageDC *msg)
 {
 	if (conn && conn->mpUser && msg) {
 		string data;
+		const char *search = NULL;
 
 		switch (msg->mType) {
 			case eDC_SEARCH_PAS:
-				data = msg->ChunkString(eCH_PS_ALL);
-				break;
-
 			case eDC_SEARCH:
-				data = msg->ChunkString(eCH_AS_ALL);
+				search = msg->mStr.c_str(); // whole message, no need to copy it
 				break;
 
 			case eDC_TTHS:
-				server->mP.Create_Search(data, msg->ChunkString(eCH_SA_ADDR), msg->ChunkString(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+				server->mP.Create_Search(data, msg->ChunkView(eCH_SA_ADDR), msg->ChunkView(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+				search = data.c_str();
 				break;
 
 			case eDC_TTHS_PAS:
-				server->mP.Create_Search(data, msg->ChunkString(eCH_SP_NICK), msg->ChunkString(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+				server->mP.Create_Search(data, msg->ChunkView(eCH_SP_NICK), msg->ChunkView(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+				search = data.c_str();
 				break;
 
 			default:
@@ -527,7 +527,7 @@ bool cpiLua::OnParsedMsgSearch(cConnDC *conn, cMessageDC *msg)
 
 		const char *args[] = {
 			conn->mpUser->mNick.c_str(),
-			data.c_str(),
+			search,
 			NULL
 		};
 
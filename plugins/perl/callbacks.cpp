@@ -150,6 +150,7 @@ bool nVerliHub::nPerlPlugin::nCallback::EditBot(const char *nick, int clas, cons
 	}
 
 	serv->mP.Create_MyINFO(robot->mMyINFO, nick, desc, conn, mail, shar, false); // dont reserve for pipe, we are not sending this
+	serv->mUserList.OnInfoChange(robot);
 	//pi->mPerl.editBot(nick, shar, (char*)robot->mMyINFO.c_str(), clas);
 	string temp;
 #ifdef USE_BUFFER_RESERVE
@@ -298,19 +298,22 @@ bool nVerliHub::nPerlPlugin::cpiPerl::OnParsedMsgSearch(cConnDC *conn, cMessageD
 		return true;
 
 	string data;
+	const char *search = NULL;
 
 	switch (msg->mType) {
 		case eDC_SEARCH_PAS:
 		case eDC_SEARCH:
-			data = msg->mStr;
+			search = msg->mStr.c_str(); // whole message, no need to copy it
 			break;
 
 		case eDC_TTHS:
-			conn->mpUser->mxServer->mP.Create_Search(data, msg->ChunkString(eCH_SA_ADDR), msg->ChunkString(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+			conn->mpUser->mxServer->mP.Create_Search(data, msg->ChunkView(eCH_SA_ADDR), msg->ChunkView(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+			search = data.c_str();
 			break;
 
 		case eDC_TTHS_PAS:
-			conn->mpUser->mxServer->mP.Create_Search(data, msg->ChunkString(eCH_SP_NICK), msg->ChunkString(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+			conn->mpUser->mxServer->mP.Create_Search(data, msg->ChunkView(eCH_SP_NICK), msg->ChunkView(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+			search = data.c_str();
 			break;
 
 		default:
@@ -320,7 +323,7 @@ bool nVerliHub::nPerlPlugin::cpiPerl::OnParsedMsgSearch(cConnDC *conn, cMessageD
 	const char *args[] = {
 		"VH_OnParsedMsgSearch",
 		conn->mpUser->mNick.c_str(),
-		data.c_str(),
+		search,
 		NULL
 	};
 
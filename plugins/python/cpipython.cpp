@@ -729,29 +729,29 @@ bool cpiPython::OnParsedMsgSearch(cConnDC *conn, cMessageDC *msg)
 {
 	if (conn && conn->mpUser && msg) {
 		string data;
+		const char *search = NULL;
 
 		switch (msg->mType) {
 			case eDC_SEARCH_PAS:
-				data = msg->ChunkString(eCH_PS_ALL);
-				break;
-
 			case eDC_SEARCH:
-				data = msg->ChunkString(eCH_AS_ALL);
+				search = msg->mStr.c_str(); // whole message, no need to copy it
 				break;
 
 			case eDC_TTHS:
-				cpiPython::me->server->mP.Create_Search(data, msg->ChunkString(eCH_SA_ADDR), msg->ChunkString(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+				cpiPython::me->server->mP.Create_Search(data, msg->ChunkView(eCH_SA_ADDR), msg->ChunkView(eCH_SA_TTH), false, false); // dont reserve for pipe, we are not sending this
+				search = data.c_str();
 				break;
 
 			case eDC_TTHS_PAS:
-				cpiPython::me->server->mP.Create_Search(data, msg->ChunkString(eCH_SP_NICK), msg->ChunkString(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+				cpiPython::me->server->mP.Create_Search(data, msg->ChunkView(eCH_SP_NICK), msg->ChunkView(eCH_SP_TTH), true, false); // dont reserve for pipe, we are not sending this
+				search = data.c_str();
 				break;
 
 			default:
 				return true;
 		}
 
-		w_Targs *args = lib_pack("ss", conn->mpUser->mNick.c_str(), data.c_str());
+		w_Targs *args = lib_pack("ss", conn->mpUser->mNick.c_str(), search);
 		return CallAll(W_OnParsedMsgSearch, args, conn);
 	}
 
@@ -1484,6 +1484,7 @@ w_Targs *_SetMyINFO(int id, w_Targs *args)
 #endif
 
 	u->mMyINFO = newinfo;
+	cpiPython::me->server->mUserList.OnInfoChange(u);
 #ifdef USE_BUFFER_RESERVE
 	newinfo.reserve(newinfo.size() + 1); // reserve for pipe
 #endif
@@ -0,0 +1,170 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifdef HAVE_CONFIG_H
+	#include <config.h>
+#endif
+
+#include "cacceptthread.h"
+
+#if HAVE_ERRNO_H
+	#include <errno.h>
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+
+namespace nVerliHub {
+	namespace nSocket {
+
+cAcceptThread::cAcceptThread(const string &addr, int port, unsigned int backlog, unsigned int queue, cWakeUp *wake):
+	mAccepted(0),
+	mDropped(0),
+	mSock(INVALID_SOCKET),
+	mAddr(addr),
+	mPort(port),
+	mBacklog(backlog),
+	mQueue(queue),
+	mWake(wake)
+{}
+
+cAcceptThread::~cAcceptThread()
+{
+	Stop(true);
+	tSocket sock;
+
+	while (mQueue.Pop(sock)) // close sockets that were never taken by main loop
+		::close(sock);
+
+	if (mSock != INVALID_SOCKET) {
+		::close(mSock);
+		mSock = INVALID_SOCKET;
+	}
+}
+
+tSocket cAcceptThread::Listen()
+{
+	if (mSock != INVALID_SOCKET)
+		return -1;
+
+	if ((mSock = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+		return -1;
+
+	int yes = 1;
+
+	if (setsockopt(mSock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) == SOCKET_ERROR)
+		return -1;
+
+	#ifdef SO_REUSEPORT
+	if (setsockopt(mSock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes)) == SOCKET_ERROR) // all threads listen on same port
+		return -1;
+	#endif
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+
+	if (mAddr.size())
+		inet_aton(mAddr.c_str(), &addr.sin_addr);
+
+	addr.sin_port = htons(mPort);
+
+	if (bind(mSock, (struct sockaddr*)&addr, sizeof(addr)) == -1)
+		return -1;
+
+	if (listen(mSock, mBacklog) == -1)
+		return -1;
+
+	int flags;
+
+	if (((flags = fcntl(mSock, F_GETFL, 0)) < 0) || (fcntl(mSock, F_SETFL, flags | O_NONBLOCK) < 0))
+		return -1;
+
+	return mSock;
+}
+
+tSocket cAcceptThread::Pop()
+{
+	tSocket sock;
+
+	if (mQueue.Pop(sock))
+		return sock;
+
+	return INVALID_SOCKET;
+}
+
+bool cAcceptThread::HasSomethingToDo()
+{
+	if (mSock == INVALID_SOCKET)
+		return false;
+
+	struct pollfd pfd;
+	pfd.fd = mSock;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	return ::poll(&pfd, 1, 100) > 0; // short timeout, so stop request is noticed soon
+}
+
+void cAcceptThread::DoSomething()
+{
+	struct sockaddr_in client;
+	socklen_t namelen;
+	tSocket sock;
+	int yes = 1, flags;
+	bool queued = false;
+
+	while (!mStop) {
+		namelen = sizeof(client);
+		sock = ::accept(mSock, (struct sockaddr*)&client, &namelen);
+
+		if (sock == INVALID_SOCKET) {
+			if (errno == EINTR)
+				continue;
+
+			break; // nothing left or error
+		}
+
+		if ((setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &yes, sizeof(yes)) == SOCKET_ERROR) || ((flags = fcntl(sock, F_GETFL, 0)) < 0) || (fcntl(sock, F_SETFL, flags | O_NONBLOCK) < 0)) {
+			::close(sock);
+			continue;
+		}
+
+		if (!mQueue.Push(sock)) { // main loop is too busy
+			::close(sock);
+			mDropped.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+
+		mAccepted.fetch_add(1, std::memory_order_relaxed);
+		queued = true;
+	}
+
+	if (queued && mWake) // main loop may be waiting for events
+		mWake->Wake();
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
@@ -0,0 +1,88 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCACCEPTTHREAD_H
+#define NSOCKETCACCEPTTHREAD_H
+
+#include "cthread.h"
+#include "cconnbase.h"
+#include "tlockfreequeue.h"
+#include "cwakeup.h"
+#include <string>
+#include <atomic>
+
+using namespace std;
+
+namespace nVerliHub {
+	namespace nSocket {
+
+/**
+* Thread that owns its own listening socket and accepts incoming connections.
+*
+* Every thread binds to the same address and port with SO_REUSEPORT so the kernel spreads new connections among them.
+* Accepted sockets are already set up as non blocking with keepalive and are handed to the main loop through a lock free queue,
+* main loop takes them in small portions, so a reconnect storm does not delay users that are already logged in.
+*/
+class cAcceptThread : public nThread::cThread
+{
+public:
+	/**
+	* @param wake Woken up when new sockets are queued, may be NULL.
+	*/
+	cAcceptThread(const string &addr, int port, unsigned int backlog, unsigned int queue, cWakeUp *wake);
+	virtual ~cAcceptThread();
+
+	/**
+	* Create, bind and listen on the socket.
+	* @return Socket descriptor or negative number on failure.
+	*/
+	tSocket Listen();
+
+	/**
+	* Take next accepted socket, called from main thread only.
+	* @return Socket descriptor or INVALID_SOCKET if there is none.
+	*/
+	tSocket Pop();
+
+	/// Wait a while for incoming connection.
+	virtual bool HasSomethingToDo();
+
+	/// Accept all pending connections.
+	virtual void DoSomething();
+
+	/// Number of accepted sockets, written by the thread and read by main thread.
+	std::atomic<unsigned long> mAccepted;
+
+	/// Number of sockets closed because the queue was full.
+	std::atomic<unsigned long> mDropped;
+
+protected:
+	tSocket mSock;
+	string mAddr;
+	int mPort;
+	unsigned int mBacklog;
+	nThread::tLockFreeQueue<tSocket> mQueue;
+	cWakeUp *mWake;
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
@@ -49,13 +49,14 @@
 	#include <arpa/inet.h>
 	#include <netinet/in.h> // sockaddr_in
 	#include <sys/socket.h> // AF_INET
-	#include <netdb.h> // gethostbyaddr
+	#include <netdb.h>
 //#endif
 
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 #include "ctime.h"
+#include "czlib.h"
 #include "stringutils.h"
 
 //#if !defined _WIN32
@@ -79,12 +80,12 @@ namespace nVerliHub {
 
 	namespace nSocket {
 
-vector<char> cAsyncConn::msBuffer(MAX_MESS_SIZE + 1); // todo: use dynamic grow
 unsigned long cAsyncConn::sSocketCounter = 0;
 
 cAsyncConn::cAsyncConn(int desc, cAsyncSocketServer *s, tConnType ct): // incoming connection
 	cObj("cAsyncConn"),
 	mZLibFlag(false),
+	mpZStream(NULL),
 	ok(desc > 0),
 	mWritable(true),
 	mxServer(s),
@@ -93,6 +94,7 @@ cAsyncConn::cAsyncConn(int desc, cAsyncSocketServer *s, tConnType ct): // incomi
 	mxProtocol(NULL),
 	mpMsgParser(NULL),
 	mSockDesc(desc),
+	mFlushClass(eTC_SEARCH),
 	mSeparator('|'),
 	mLineSize(0),
 	mIP(0),
@@ -104,9 +106,11 @@ cAsyncConn::cAsyncConn(int desc, cAsyncSocketServer *s, tConnType ct): // incomi
 	mType(ct),
 	mxLine(NULL),
 	meLineStatus(AC_LS_NO_LINE),
-	mBufEnd(0),
-	mBufReadPos(0),
-	mCloseAfter(0, 0)
+	mpReadBuf(NULL),
+	mCloseAfter(0, 0),
+	mTimerDue(0),
+	mDNSWait(0),
+	mpIOUring(NULL)
 {
 	if (mxServer) {
 		nVerliHub::cServerDC *serv = (nVerliHub::cServerDC*)mxServer;
@@ -136,10 +140,6 @@ cAsyncConn::cAsyncConn(int desc, cAsyncSocketServer *s, tConnType ct): // incomi
 #endif
 			mAddrIP = temp; // ip address
 			mNumIP = cBanList::Ip2Num(mAddrIP);
-
-			if (mxServer && mxServer->mUseDNS) // host name
-				DNSLookup();
-
 			mAddrPort = ntohs(addr_in->sin_port); // port number
 
 			if (getsockname(mSockDesc, &saddr, &addr_size) == 0) { // get server address and port that user is connected to
@@ -163,6 +163,7 @@ cAsyncConn::cAsyncConn(int desc, cAsyncSocketServer *s, tConnType ct): // incomi
 cAsyncConn::cAsyncConn(const string &host, int port/*, bool udp*/): // outgoing connection
 	cObj("cAsyncConn"),
 	mZLibFlag(false),
+	mpZStream(NULL),
 	ok(false),
 	mWritable(true),
 	mxServer(NULL),
@@ -177,6 +178,7 @@ cAsyncConn::cAsyncConn(const string &host, int port/*, bool udp*/): // outgoing
 	mSockDesc(0),
 #endif
 */
+	mFlushClass(eTC_SEARCH),
 	mSeparator('|'),
 	mLineSize(0),
 	mIP(0),
@@ -188,9 +190,11 @@ cAsyncConn::cAsyncConn(const string &host, int port/*, bool udp*/): // outgoing
 	mType(eCT_SERVER),
 	mxLine(NULL),
 	meLineStatus(AC_LS_NO_LINE),
-	mBufEnd(0),
-	mBufReadPos(0),
-	mCloseAfter(0, 0)
+	mpReadBuf(NULL),
+	mCloseAfter(0, 0),
+	mTimerDue(0),
+	mDNSWait(0),
+	mpIOUring(NULL)
 {
 	/*
 	if (udp) {
@@ -208,6 +212,20 @@ cAsyncConn::~cAsyncConn()
 		this->DeleteParser(mpMsgParser);
 
 	mpMsgParser = NULL;
+
+	if (mpReadBuf) {
+		cReadBuffer::Put(mpReadBuf);
+		mpReadBuf = NULL;
+	}
+
+	if (mTimerDue && mxServer)
+		mxServer->mTimerWheel.Cancel(this);
+
+	if (mpZStream) {
+		delete mpZStream;
+		mpZStream = NULL;
+	}
+
 	this->Close();
 }
 
@@ -250,31 +268,31 @@ int cAsyncConn::ReadLineLocal()
 	if (!mxLine)
 		throw "ReadLine with null line pointer";
 
-	char *pos, *buf = msBuffer.data() + mBufReadPos;
-	int len = mBufEnd - mBufReadPos;
+	if (!mpReadBuf)
+		return 0;
+
+	const char *line;
+	size_t len;
 
-	if (NULL == (pos = (char*)memchr(buf, mSeparator, len))) {
-		if ((mxLine->size() + len) > mLineSizeMax) {
+	if (!mpReadBuf->NextLine(mSeparator, line, len)) { // line is not complete yet, it stays in buffer until rest of it arrives
+		len = mpReadBuf->Pending();
+
+		if (len > mLineSizeMax) {
 			CloseNow();
 			return 0;
 		}
 
-#ifdef USE_BUFFER_RESERVE
-		mxLine->reserve(len);
-#endif
-		mxLine->append((char*)buf, len);
-		mBufEnd = 0;
-		mBufReadPos = 0;
 		return len;
 	}
 
-	len = pos - buf;
-#ifdef USE_BUFFER_RESERVE
-	mxLine->reserve(len);
-#endif
-	mxLine->append((char*)buf, len);
-	mBufReadPos += len + 1;
+	mxLine->assign(line, len); // only copy, line points into read buffer
 	meLineStatus = AC_LS_LINE_DONE;
+
+	if (!mpReadBuf->Pending()) { // nothing left, return buffer to pool
+		cReadBuffer::Put(mpReadBuf);
+		mpReadBuf = NULL;
+	}
+
 	return len + 1;
 }
 
@@ -323,6 +341,7 @@ void cAsyncConn::CloseNice(int msec)
 		mCloseAfter.Get();
 
 	mCloseAfter += msec;
+	ScheduleTimer();
 }
 
 void cAsyncConn::CloseNow()
@@ -333,6 +352,7 @@ void cAsyncConn::CloseNow()
 	if (mxServer) {
 		mxServer->mConnChooser.OptOut((cConnBase*)this, eCC_ALL);
 		mxServer->mConnChooser.OptIn((cConnBase*)this, eCC_CLOSE);
+		mxServer->mNoWait = true; // dont wait with removing it
 	}
 }
 
@@ -341,14 +361,49 @@ int cAsyncConn::ReadAll(const unsigned int tries, const unsigned int sleep)
 	if (!ok || !mWritable)
 		return -1;
 
+#if USE_IO_URING
+	if (mpIOUring) { // data was already received by io_uring engine into our buffer
+		const size_t got = mpIOUring->mRead;
+		mpIOUring->mRead = 0;
+
+		if (got) {
+			if (mpIOUring->mError && mxServer->mIOUring) // process received data first, error on next step
+				mxServer->mIOUring->Ready(this);
+
+			mTimeLastIOAction = mxServer->mTime;
+			return got;
+		}
+
+		if (mpIOUring->mError > 0) {
+			if (Log(2))
+				LogStream() << "Read IO error: " << mpIOUring->mError << " = " << strerror(mpIOUring->mError) << endl;
+		} else if (mpIOUring->mError && Log(2)) {
+			LogStream() << "User hung up" << endl;
+		}
+
+		if (mpIOUring->mError)
+			CloseNow();
+
+		return (mpIOUring->mError ? -1 : 0);
+	}
+#endif
+
 	int buf_len = 0; //addr_len = sizeof(struct sockaddr)
 	unsigned int i = 0;
-	mBufReadPos = 0;
-	mBufEnd = 0;
+
+	if (!mpReadBuf)
+		mpReadBuf = cReadBuffer::Get();
+
+	size_t len = mpReadBuf->mChunk;
+	char *buf = mpReadBuf->WritePtr(len);
+
+	if (len > MAX_MESS_SIZE)
+		len = MAX_MESS_SIZE;
+
 	//bool udp = (this->GetType() == eCT_CLIENTUDP);
 
 	//if (!udp) {
-		while (((buf_len = recv(mSockDesc, msBuffer.data(), MAX_MESS_SIZE, 0)) == -1) && ((errno == EAGAIN) || (errno == EINTR)) && (i++ <= tries)) {
+		while (((buf_len = recv(mSockDesc, buf, len, 0)) == -1) && ((errno == EAGAIN) || (errno == EINTR)) && (i++ <= tries)) {
 	//#if !defined _WIN32
 			::usleep(sleep);
 	//#endif
@@ -395,8 +450,10 @@ int cAsyncConn::ReadAll(const unsigned int tries, const unsigned int sleep)
 		//}
 
 	} else { // received data
-		mBufEnd = buf_len;
-		msBuffer[mBufEnd] = '\0'; // end string
+		mpReadBuf->Written(buf_len);
+
+		if (((size_t)buf_len == len) && (mpReadBuf->mChunk < MAX_MESS_SIZE)) // socket had more data than we asked for, read more next time
+			mpReadBuf->mChunk *= 2;
 
 		if (mxServer)
 			mTimeLastIOAction = mxServer->mTime;
@@ -825,6 +882,20 @@ int cAsyncConn::OnTimerBase(const cTime &now)
 	return 0;
 }
 
+long cAsyncConn::NextTimer(const cTime &now)
+{
+	if (bool(mCloseAfter))
+		return now.Sec();
+
+	return 0;
+}
+
+void cAsyncConn::ScheduleTimer(long due)
+{
+	if (mxServer)
+		mxServer->mTimerWheel.Schedule(this, due);
+}
+
 int cAsyncConn::OnTimer(const cTime &now)
 {
 	return 0;
@@ -836,11 +907,16 @@ void cAsyncConn::OnFlushDone()
 */
 
 int cAsyncConn::Write(const string &data, bool flush) // note: data can actually be empty when we perform a timed flush
+{
+	return Write(data, flush, cSendQueue::Classify(data.data(), data.size()));
+}
+
+int cAsyncConn::Write(const string &data, bool flush, unsigned int cls)
 {
 	size_t flush_size = GetFlushSize(), buf_size = GetBufferSize(), data_size = data.size();
 	size_t calc_size = flush_size + buf_size + data_size;
 
-	if (calc_size > mMaxBuffer) { // disconnect user who is receiving too slow and his buffer is overfilled, we cant waste memory forever
+	if ((calc_size > mMaxBuffer) && !MakeRoom(calc_size - mMaxBuffer, data_size, cls)) { // dropping searches made no room, disconnect user who is receiving too slow and his buffer is overfilled, we cant waste memory forever
 		if (Log(2))
 			LogStream() << "Output buffer is too big, closing: " << flush_size << " + " << buf_size << " + " << data_size << " = " << calc_size << " of " << mMaxBuffer << endl;
 
@@ -848,20 +924,36 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 		return -1;
 	}
 
+	if (calc_size > mMaxBuffer) { // searches were dropped, see what fits now
+		flush_size = GetFlushSize();
+		buf_size = GetBufferSize();
+
+		if ((flush_size + buf_size + data_size) > mMaxBuffer) // new search was dropped too
+			data_size = 0;
+	}
+
 	if (data_size) { // we have something new to append
 #ifdef USE_BUFFER_RESERVE
 		mBufFlush.reserve(mBufFlush.size() + data_size); // always reserve because we are adding new data
 #endif
 		mBufFlush.append(data.data(), data_size);
 		flush_size += data_size;
+
+		if (cls < mFlushClass) // flush buffer is as important as the most important data in it
+			mFlushClass = cls;
 	}
 
 	buf_size += flush_size;
 	flush = (flush || (buf_size > (mMaxBuffer >> 1))); // force flush if required
 
-	if (!buf_size || !flush) // nothing to send or send it later
+	if (!buf_size) // nothing to send
 		return 0;
 
+	if (!flush) { // send it later, at latest on next timer
+		ScheduleTimer();
+		return 0;
+	}
+
 	nVerliHub::cServerDC *serv = NULL;
 
 	if (mxServer)
@@ -871,7 +963,41 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 
 	const char *send_buf = mBufFlush.data(); // pointer to flush buffer
 
-	if (flush_size) { // check if there is something to flush, else send old remaining data
+	if (flush_size && serv && (mpZStream || (mZLibFlag && !serv->mC.disable_zlib && serv->mC.zlib_stream))) { // persistent stream, every flush is compressed regardless of its size
+		if (!mpZStream)
+			mpZStream = new cZLibStream(serv->mC.zlib_compress_level, serv->mC.zlib_stream_window, serv->mC.zlib_stream_memlevel);
+
+		calc_size = 0;
+		const char *zlib_buf = mpZStream->Compress(send_buf, flush_size, calc_size);
+
+		if (zlib_buf) {
+			buf_size -= flush_size; // recalculate final send buffer size
+			buf_size += calc_size;
+			mBufSend.Append(zlib_buf, calc_size, eTC_CONTROL); // parts of stream can never be dropped
+
+			if (flush_size > calc_size)
+				serv->mProtoSaved[0] += flush_size - calc_size; // add difference to saved upload statistics
+
+		} else if (mpZStream->Started()) { // client can not decode anything that follows
+			if (Log(1))
+				LogStream() << "Failed compressing data with ZLib stream, closing" << endl;
+
+			CloseNow();
+			return -1;
+
+		} else { // stream could not be created, keep sending raw data
+			if (Log(1))
+				LogStream() << "Failed creating ZLib stream, fall back" << endl;
+
+			delete mpZStream;
+			mpZStream = NULL;
+			mBufSend.Swap(mBufFlush, mFlushClass);
+		}
+
+		mBufFlush.clear();
+		mFlushClass = eTC_SEARCH;
+
+	} else if (flush_size) { // check if there is something to flush, else send old remaining data
 		if (mZLibFlag && serv && !serv->mC.disable_zlib && (flush_size >= serv->mC.zlib_min_len)) { // compress data only when flushing or we will destroy everything, only if minimum length is reached
 			if (send_buf[flush_size - 1] == '|') {
 				calc_size = 0; // we dont use it anymore
@@ -881,17 +1007,11 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 				if (calc_size && zlib_buf) { // compression successful
 					buf_size -= flush_size; // recalculate final send buffer size
 					buf_size += calc_size;
-#ifdef USE_BUFFER_RESERVE
-					mBufSend.reserve(mBufSend.size() + calc_size); // always reserve because we are adding new data
-#endif
-					mBufSend.append(zlib_buf, calc_size); // add compressed data to final send buffer
+					mBufSend.Append(zlib_buf, calc_size, mFlushClass); // add compressed data to final send buffer
 					serv->mProtoSaved[0] += flush_size - calc_size; // add difference to saved upload statistics
 
 				} else { // compression is larger than initial data or something failed
-#ifdef USE_BUFFER_RESERVE
-					mBufSend.reserve(mBufSend.size() + flush_size); // always reserve because we are adding new data
-#endif
-					mBufSend.append(send_buf, flush_size); // add uncompressed data to final send buffer
+					mBufSend.Swap(mBufFlush, mFlushClass); // add uncompressed data to final send buffer
 
 					if (calc_size) {
 						if (Log(5))
@@ -906,35 +1026,39 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 					}
 				}
 
-				mBufFlush.clear(); // clean up flush buffer in both cases
-				ShrinkStringToFit(mBufFlush);
+				mBufFlush.clear(); // clean up flush buffer in both cases, memory is kept for next write
+				mFlushClass = eTC_SEARCH;
 
 			} else if (Log(1)) { // client will fail to decompress when pipe is missing, this happens when we are flushing incomplete data, todo: not sure if wait or do something already here
 				LogStream() << "Missing ending pipe in compress data: " << mBufFlush << endl; // todo: log only tail of data, dont fill logs
 			}
 
 		} else { // compression is disabled or data too short for good result
-#ifdef USE_BUFFER_RESERVE
-			mBufSend.reserve(mBufSend.size() + flush_size); // always reserve because we are adding new data
-#endif
-			mBufSend.append(send_buf, flush_size); // add uncompressed data to final send buffer
-			mBufFlush.clear(); // clean up flush buffer
-			ShrinkStringToFit(mBufFlush);
+			mBufSend.Swap(mBufFlush, mFlushClass); // add uncompressed data to final send buffer, this moves the data without copying
+			mFlushClass = eTC_SEARCH;
 		}
 	}
 
-	send_buf = mBufSend.data(); // pointer to send buffer
-
-	/*
-	if (!send_buf)
+#if USE_IO_URING
+	if (mpIOUring && serv && serv->mIOUring) { // queued and sent together with all other connections at the end of main loop step
+		serv->mIOUring->Send(this);
 		return 0;
-	*/
+	}
+#endif
 
 	calc_size = buf_size; // we dont use it anymore, make copy of send buffer size because send method will change it
+	const int res = mBufSend.Send(mSockDesc, calc_size); // try to send as much data as possible
+	return SendDone(res, calc_size, buf_size);
+}
 
-	if (SendAll(send_buf, calc_size) == -1) { // try to send as much data as possible
+int cAsyncConn::SendDone(int res, size_t sent, size_t buf_size)
+{
+	nVerliHub::cServerDC *serv = (nVerliHub::cServerDC*)mxServer;
+	size_t calc_size = sent;
+
+	if (res == -1) {
 		if (Log(6) && serv && serv->mNetOutLog && serv->mNetOutLog.is_open())
-			serv->mNetOutLog << '[' << AddrIP() << "] Failed sending all data, " << calc_size << " of " << buf_size << ", " << errno << '=' << strerror(errno) << ": " << mBufSend << endl; // todo: log only part of data, dont fill logs
+			serv->mNetOutLog << '[' << AddrIP() << "] Failed sending all data, " << calc_size << " of " << buf_size << ", " << errno << '=' << strerror(errno) << endl;
 
 		if ((errno != EAGAIN) && (errno != EINTR)) { // analyse the error if any
 			if (Log(2))
@@ -950,18 +1074,17 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 			else
 				mTimeLastIOAction.Get();
 
-			StrCutLeft(mBufSend, calc_size); // this is supposed to actually reduce the size of buffer, it does a copy so it is slower but memory usage is important
-			buf_size -= calc_size;
+			buf_size -= calc_size; // sent data was already removed from the queue
 
 		} else if (bool(mCloseAfter)) { // we must close nice the connection
 			CloseNow();
 		}
 
 		if (serv && ok) { // buffer overfill protection, only on registered connections
-			serv->mConnChooser.OptIn(this, eCC_OUTPUT); // choose the connection to send the rest of data as soon as possible
+			ChooseIO(eCC_OUTPUT, true); // choose the connection to send the rest of data as soon as possible
 
 			if (buf_size < serv->mC.max_unblock_size) { // if buffer size is smaller than unblock size, allow read operation on the connection
-				serv->mConnChooser.OptIn(this, eCC_INPUT);
+				ChooseIO(eCC_INPUT, true);
 
 				if (Log(5)) {
 					if (serv->mNetOutLog && serv->mNetOutLog.is_open())
@@ -970,7 +1093,7 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 					LogStream() << "Unblocking input: " << buf_size << " of " << serv->mC.max_unblock_size << endl;
 				}
 			} else if (buf_size >= serv->mC.max_outfill_size) { // if buffer is bigger than maximum send size, block read operation
-				serv->mConnChooser.OptOut(this, eCC_INPUT);
+				ChooseIO(eCC_INPUT, false);
 
 				if (Log(5)) {
 					if (serv->mNetOutLog && serv->mNetOutLog.is_open())
@@ -981,14 +1104,11 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 			}
 		}
 	} else { // all data was sent
-		mBufSend.clear(); // clean up send buffer
-		ShrinkStringToFit(mBufSend);
-
 		if (bool(mCloseAfter)) // close nice the connection
 			CloseNow();
 
 		if (serv && ok) { // unregister connection for write operation
-			serv->mConnChooser.OptOut(this, eCC_OUTPUT);
+			ChooseIO(eCC_OUTPUT, false);
 
 			if (Log(5))
 				LogStream() << "Blocking output" << endl;
@@ -1005,6 +1125,137 @@ int cAsyncConn::Write(const string &data, bool flush) // note: data can actually
 	return calc_size;
 }
 
+void cAsyncConn::ChooseIO(tChEvent event, bool on)
+{
+	if (on && mDNSWait && (event == eCC_INPUT)) // stays blocked until host name is known
+		return;
+
+#if USE_IO_URING
+	if (mpIOUring && mxServer->mIOUring) { // engine reads and writes the socket, chooser only watches for errors
+		if (event == eCC_INPUT)
+			mxServer->mIOUring->Input(this, on);
+		else if (on)
+			mxServer->mIOUring->Send(this);
+
+		return;
+	}
+#endif
+
+	if (on)
+		mxServer->mConnChooser.OptIn(this, event);
+	else
+		mxServer->mConnChooser.OptOut(this, event);
+}
+
+#if USE_IO_URING
+void cAsyncConn::PutInput(const char *data, size_t len)
+{
+	if (!mpReadBuf)
+		mpReadBuf = cReadBuffer::Get();
+
+	size_t room = len;
+	memcpy(mpReadBuf->WritePtr(room), data, len);
+	mpReadBuf->Written(len);
+}
+
+int cAsyncConn::OnIOUringSent(int res)
+{
+	const size_t buf_size = mBufSend.Size();
+	size_t sent = 0;
+
+	if (res > 0) {
+		sent = res;
+		mBufSend.Consume(sent);
+	}
+
+	if (res < 0)
+		errno = -res;
+	else if (!mBufSend.Empty())
+		errno = EAGAIN;
+
+	const int ret = SendDone(((res < 0) || !mBufSend.Empty()) ? -1 : 0, sent, buf_size);
+
+	if (sent)
+		OnWriteDone(sent);
+
+	return ret;
+}
+#endif
+
+int cAsyncConn::WriteShared(cSendSegment *seg, bool flush, bool zipped)
+{
+	string empty;
+
+	if (!seg)
+		return Write(empty, flush);
+
+	nVerliHub::cServerDC *serv = (nVerliHub::cServerDC*)mxServer;
+
+	const unsigned int cls = cSendQueue::Classify(seg->mData.data(), seg->mData.size());
+	size_t saved = 0;
+
+	if (mpZStream || (!zipped && mZLibFlag && serv && !serv->mC.disable_zlib)) { // data must go through compression with rest of flush buffer
+		if (mpZStream || !flush || mBufFlush.size() || serv->mC.zlib_stream || (seg->mData.size() < serv->mC.zlib_min_len))
+			return Write(seg->mData, flush, cls);
+
+		cSendSegment *zip = serv->GetZippedSegment(seg); // flush would hold nothing but this broadcast, use block compressed once for all users
+
+		if (!zip)
+			return Write(seg->mData, flush, cls);
+
+		saved = seg->mData.size() - zip->mData.size();
+		seg = zip; // keep traffic class of original data
+	}
+
+	const size_t data_size = seg->mData.size(), calc_size = GetFlushSize() + GetBufferSize() + data_size;
+
+	if ((calc_size > mMaxBuffer) && !MakeRoom(calc_size - mMaxBuffer, data_size, cls)) { // same protection as in Write
+		if (Log(2))
+			LogStream() << "Output buffer is too big, closing: " << GetFlushSize() << " + " << GetBufferSize() << " + " << data_size << " = " << calc_size << " of " << mMaxBuffer << endl;
+
+		CloseNow();
+		return -1;
+	}
+
+	mBufSend.Swap(mBufFlush, mFlushClass); // keep order of data, anything written before goes first
+	mFlushClass = eTC_SEARCH;
+
+	if ((GetBufferSize() + data_size) <= mMaxBuffer) { // not dropped
+		mBufSend.Append(seg, cls); // reference to the same data that other users get
+
+		if (saved)
+			serv->mProtoSaved[0] += saved; // add difference to saved upload statistics
+	}
+
+	return Write(empty, flush, eTC_CONTROL);
+}
+
+bool cAsyncConn::MakeRoom(size_t need, size_t data_size, unsigned int cls)
+{
+	size_t freed = mBufSend.Drop(eTC_SEARCH); // old searches are worth less than anything new
+
+	if (mBufFlush.size() && (mFlushClass >= eTC_SEARCH)) {
+		cSendQueue::sDropped[eTC_SEARCH]++;
+		cSendQueue::sDroppedBytes[eTC_SEARCH] += mBufFlush.size();
+		freed += mBufFlush.size();
+		mBufFlush.clear();
+	}
+
+	if (freed && Log(3))
+		LogStream() << "Output buffer is full, dropped " << freed << " bytes of searches" << endl;
+
+	if (freed >= need)
+		return true;
+
+	if (data_size && (cls >= eTC_SEARCH)) { // still no room, drop the new search instead of closing
+		cSendQueue::sDropped[cls]++;
+		cSendQueue::sDroppedBytes[cls] += data_size;
+		return ((freed + data_size) >= need);
+	}
+
+	return false;
+}
+
 int cAsyncConn::OnCloseNice(void)
 {
 	return 0;
@@ -1056,7 +1307,7 @@ bool cAsyncConn::SetSecConn(const string &addr, string &vers)
 
 	if (mxServer && mxServer->mUseDNS && (mAddrHost.empty() || (mAddrHost == "localhost"))) {
 		mAddrHost.clear();
-		DNSLookup();
+		mxServer->LookupHost(this); // real address of the user is known only now
 	}
 
 	if (vers.size() == 1) {
@@ -1095,7 +1346,7 @@ bool cAsyncConn::SetUserIP(const string &addr)
 
 		if (mxServer->mUseDNS && (mAddrHost.empty() || (mAddrHost == "localhost"))) {
 			mAddrHost.clear();
-			DNSLookup();
+			mxServer->LookupHost(this);
 		}
 	}
 
@@ -1107,16 +1358,35 @@ bool cAsyncConn::DNSLookup()
 	if (mAddrHost.size())
 		return true;
 
-	struct hostent *hp;
+	if (mxServer && mxServer->mResolver && mxServer->mResolver->Find(mNumIP, mAddrHost, mxServer->mTime.Sec())) // already known
+		return mAddrHost.size();
 
-	if ((hp = gethostbyaddr((char*)&mIP, sizeof(mIP), AF_INET))) {
-#ifdef USE_BUFFER_RESERVE
-		mAddrHost.reserve(strlen(hp->h_name));
-#endif
-		mAddrHost = hp->h_name;
-	}
+	return cDNSResolver::Resolve(mNumIP, mAddrHost);
+}
+
+void cAsyncConn::DNSWait(long now)
+{
+	if (mDNSWait)
+		return;
+
+	mDNSWait = now;
 
-	return (hp != NULL);
+	if (mxServer && ok)
+		ChooseIO(eCC_INPUT, false); // nothing is read until we know the host name
+}
+
+void cAsyncConn::DNSDone(const string &host)
+{
+	if (host.size())
+		mAddrHost = host;
+
+	if (!mDNSWait)
+		return;
+
+	mDNSWait = 0;
+
+	if (mxServer && ok)
+		ChooseIO(eCC_INPUT, true);
 }
 
 unsigned long cAsyncConn::DNSResolveHost(const string &host)
@@ -1144,12 +1414,7 @@ bool cAsyncConn::DNSResolveReverse(const string &ip, string &host)
 #endif
 */
 
-	struct hostent *hp;
-
-	if ((hp = gethostbyaddr((char*)&addr, sizeof(addr), AF_INET)))
-		host = hp->h_name;
-
-	return (hp != NULL);
+	return cDNSResolver::Resolve(ntohl(addr.s_addr), host);
 }
 
 /*
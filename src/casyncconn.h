@@ -30,6 +30,11 @@
 #include "cobj.h"
 #include "ctime.h"
 #include "cconnbase.h"
+#include "cconnchoose.h"
+#include "creadbuffer.h"
+#include "csendqueue.h"
+#include "ciouring.h"
+#include "cdnsresolver.h"
 #include "cprotocol.h"
 
 //#ifndef _WIN32
@@ -43,6 +48,10 @@
 using namespace std;
 
 namespace nVerliHub {
+	namespace nSocket {
+		struct sIOUringConn;
+	};
+
 	namespace nEnums {
 
 		/**
@@ -81,6 +90,10 @@ namespace nVerliHub {
  		class cMessageParser;
  	};
 
+	namespace nUtils {
+		class cZLibStream;
+	};
+
 	namespace nSocket {
  		class cAsyncSocketServer;
  		class cAsyncConn;
@@ -223,7 +236,7 @@ namespace nVerliHub {
 				 */
 				bool BufferEmpty()
 				{
-					 return mBufEnd == mBufReadPos;
+					 return !mpReadBuf || mpReadBuf->Scanned();
 				}
 
 				/*
@@ -231,12 +244,17 @@ namespace nVerliHub {
 				*/
 				size_t GetBufferSize() const
 				{
-					return mBufSend.size();
+					return mBufSend.Size();
 				}
 
 				size_t GetBufferCapacity() const
 				{
-					return mBufSend.capacity();
+					return mBufSend.Capacity();
+				}
+
+				size_t GetBufferSegments() const
+				{
+					return mBufSend.Count();
 				}
 
 				size_t GetFlushSize() const
@@ -296,17 +314,36 @@ namespace nVerliHub {
 
 				/**
 				 * Return the hostname for the IP address of the connection.
-				 * The hostname is stored in mAddrHost attribute and mIp attribute is used.
+				 * The hostname is stored in mAddrHost attribute and mNumIP attribute is used.
 				 *
-				 * Please note that DNS lookup may be extremely slow when dealing with a large amount of connections.
+				 * Cached result of server resolver is used when there is one, otherwise this blocks until the answer comes,
+				 * so it is meant for commands only. Connections are resolved in background by cAsyncSocketServer::LookupHost().
 				 * @return True on success or false on failure.
 				 */
 				bool DNSLookup();
 
+				/**
+				 * Stop reading from connection until DNSDone() is called.
+				 * @param now Current time in seconds.
+				 */
+				void DNSWait(long now);
+
+				/**
+				 * Set result of background lookup and continue reading.
+				 * @param host The hostname, empty if lookup failed or timed out.
+				 */
+				void DNSDone(const string &host);
+
+				/// Return time when connection started waiting for its hostname, zero if it is not waiting.
+				long DNSWaiting() const
+				{
+					return mDNSWait;
+				}
+
 				/**
 				 * Return the hostname for the given IP address.
 				 *
-				 * Please note that DNS lookup may be extremely slow when dealing with a large amount of connections.
+				 * This blocks until the answer comes, it is meant for commands only.
 				 * @param ip The IP address to resolve.
 				 * @param host A string that contains the result.
 				 * @return True on success or false on failure.
@@ -423,6 +460,19 @@ namespace nVerliHub {
 				 */
 				int OnTimerBase(const cTime &now);
 
+				/**
+				 * Return time of the next deadline of the connection, OnTimerBase() is called only when it passes.
+				 * @param now The current time.
+				 * @return Deadline in seconds or zero if there is none.
+				 */
+				virtual long NextTimer(const cTime &now);
+
+				/**
+				 * Make sure OnTimerBase() is called not later than given time.
+				 * @param due Deadline in seconds, zero means next connection timer period.
+				 */
+				void ScheduleTimer(long due = 0);
+
 				/**
 				 * Read all available data from the socket and store them in the buffer.
 				 * @see ReadLineLocal()
@@ -493,9 +543,33 @@ namespace nVerliHub {
 				 */
 				int Write(const string &data, bool flush);
 
+				/**
+				 * Write data of known traffic class into the output buffer.
+				 * When the buffer is full, queued searches are dropped first and a new search is dropped instead of closing the connection.
+				 * @param data Data to be written.
+				 * @param flush True if the buffer must be flushed.
+				 * @param cls Traffic class of data, see tTrafficClass.
+				 * @return Same as Write().
+				 */
+				int Write(const string &data, bool flush, unsigned int cls);
+
+				/**
+				 * Queue a segment that is shared with other connections, used for broadcasts.
+				 * The segment data is not copied unless it must be compressed.
+				 * @param seg Segment to send.
+				 * @param flush True if the buffer must be flushed.
+				 * @param zipped True if segment already holds compressed data with $ZOn, it is queued as is.
+				 * @return Same as Write().
+				 * @see Write()
+				 */
+				int WriteShared(cSendSegment *seg, bool flush, bool zipped = false);
+
 				// states that client supports zlib compression
 				bool mZLibFlag;
 
+				// persistent deflate stream, once started everything sent to the connection is compressed with it
+				cZLibStream *mpZStream;
+
 				// tls proxy
 				string mTLSVer;
 				bool SetSecConn(const string &addr, string &vers);
@@ -543,7 +617,20 @@ namespace nVerliHub {
 					we dont want to mix compressed and uncompressed buffers
 					else we are going to recompress already compressed unsent data
 				*/
-				string mBufSend, mBufFlush;
+				cSendQueue mBufSend;
+				string mBufFlush;
+
+				/// Traffic class of the most important data in flush buffer.
+				unsigned int mFlushClass;
+
+				/**
+				 * Drop searches from output buffers to make room for new data.
+				 * @param need Number of bytes that must be freed.
+				 * @param data_size Size of new data.
+				 * @param cls Traffic class of new data, new search is dropped too if there is still no room.
+				 * @return True if there is room now.
+				 */
+				bool MakeRoom(size_t need, size_t data_size, unsigned int cls);
 
 				/// Line separator character.
 				/// Delimiter is used to split lines in the buffer and the default one is new line.
@@ -571,7 +658,6 @@ namespace nVerliHub {
 				unsigned int mServPort;
 
 				/// The maximum size of the buffer that contains stock data.
-				/// @see msBuffer
 				unsigned long mMaxBuffer;
 
 				/// The maximum size of the buffer that contains the read line.
@@ -643,30 +729,76 @@ namespace nVerliHub {
 				* @return Number of sent bytes
 				*/
 				int SendAll(const char *buf, size_t &len);
+
+				/**
+				* Finish a write, close connection on error and choose it for output and input according to what is left in send buffer.
+				* @param res Result of the send, zero when everything was sent or -1 with errno set.
+				* @param sent Number of sent bytes.
+				* @param buf_size Size of send buffer before the send.
+				* @return Number of sent bytes or -1 if connection is closed.
+				*/
+				int SendDone(int res, size_t sent, size_t buf_size);
+
+				/**
+				* Enable or disable input or output event of the connection, in connection chooser or in io_uring engine that handles it.
+				* @param event eCC_INPUT or eCC_OUTPUT.
+				* @param on True to enable.
+				*/
+				void ChooseIO(nEnums::tChEvent event, bool on);
+
+				/**
+				* Event handler function called when data queued by Write() is sent later by io_uring engine.
+				* @param sent Number of sent bytes.
+				*/
+				virtual void OnWriteDone(int sent)
+				{}
 			private:
 				/// Pointer to a line in the buffer.
 				/// The string is stored by ReadLineLocal() call and then fetched with GetLine() call.
 				/// Buffer is split in lines depending on the delimiter stored in mSeparator.
 				/// @see GetLine()
 				/// @see ReadLineLocal()
-				/// @see msBuffer
 				string *mxLine;
 
 				/// The status of the read line from the buffer.
 				/// @see tLineStatus
 				nEnums::tLineStatus meLineStatus;
 
-				static vector<char> msBuffer; // note: this buffer is shared between all connections
-				unsigned int mBufEnd;
-
-				// Read buffer position
-				/// Current position in the buffer.
-				/// The position is pushed forward when a new line is read from the buffer.
+				/// Received data that was not yet split into lines.
+				/// Taken from a pool when there is something to read and returned when it gets empty.
 				/// @see ReadLineLocal()
-				unsigned int mBufReadPos;
+				cReadBuffer *mpReadBuf;
 
 				/// The time when the connection has been closed.
 				cTime mCloseAfter;
+
+				/// Second when the connection is due in timer wheel, zero if not scheduled.
+				long mTimerDue;
+
+				/// Position in timer wheel slot.
+				tCLIt mTimerIt;
+
+				/// Time when connection started waiting for background DNS lookup, zero if not waiting.
+				long mDNSWait;
+
+				friend class cTimerWheel;
+
+				/// State in io_uring engine, NULL when socket is handled by connection chooser.
+				sIOUringConn *mpIOUring;
+
+			#if USE_IO_URING
+				/// Append data received by io_uring engine to the read buffer.
+				void PutInput(const char *data, size_t len);
+
+				/**
+				* Called by io_uring engine when a send finishes.
+				* @param res Number of sent bytes or negative error code.
+				* @return Same as SendDone().
+				*/
+				int OnIOUringSent(int res);
+
+				friend class cIOUring;
+			#endif
 		};
 		/// @}
 	}; // namespace nSocket
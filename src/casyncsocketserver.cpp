@@ -31,6 +31,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <algorithm>
+#include <map>
 
 using namespace std;
 
@@ -52,17 +53,29 @@ cAsyncSocketServer::cAsyncSocketServer(int port):
 	mNoConnDelay(0),
 	mNoReadTry(0),
 	mNoReadDelay(0),
-	mChooseTimeOut(0),
 	mAcceptNum(0),
 	mAcceptTry(0),
+	mAcceptThreadNum(0),
 	mMaxLineLength(0),
 	mUseDNS(0),
+	mDNSTimeout(5),
+	mDNSCacheTTL(3600),
+	mResolver(NULL),
+	mUseIOUring(false),
+#if USE_IO_URING
+	mIOUring(NULL),
+#endif
 	mFrequency(mTime, 90.0, 20),
 	mbRun(false),
 	mFactory(NULL),
+	mNoWait(false),
+	mWaitSteps(0),
 	mRunResult(0),
 	mNowTreating(NULL)
 {
+	mConnChooser.AddConn(&mWakeUp);
+	mConnChooser.cConnChoose::OptIn((cConnBase*)&mWakeUp, eCC_INPUT);
+
 	/*
 	#ifdef _WIN32
 	if(!this->WSinitialized) {
@@ -114,6 +127,26 @@ int cAsyncSocketServer::run()
 {
 	mT.stop = cTime(0, 0);
 	mbRun = true;
+
+	if (mUseIOUring) {
+	#if USE_IO_URING
+		if (!mIOUring) {
+			mIOUring = new cIOUring;
+
+			if (mIOUring->Init(IOURING_ENTRIES)) {
+				mIOUring->Notify(mWakeUp.EventFD()); // completions wake up main loop
+				vhLog(0) << "Using io_uring for client connections" << endl;
+			} else {
+				vhErr(0) << "Kernel does not support required io_uring features, falling back to connection chooser" << endl;
+				delete mIOUring;
+				mIOUring = NULL;
+			}
+		}
+	#else
+		vhErr(0) << "Hub was compiled without io_uring support, using connection chooser" << endl;
+	#endif
+	}
+
 	vhLog(1) << "Main loop start" << endl;
 
 	while (mbRun) {
@@ -125,15 +158,12 @@ int cAsyncSocketServer::run()
 			OnTimerBase(mTime);
 		}
 
-		//#if !defined _WIN32
-			::usleep(mStepDelay * 1000);
-		/*
-		#else
-			::Sleep(mStepDelay);
-		#endif
-		*/
+	#if USE_IO_URING
+		if (mIOUring) // send everything written during this step by single call
+			mIOUring->Submit();
+	#endif
 
-		mFrequency.Insert(mTime);
+		mFrequency.Insert(mTime, 1 + mWaitSteps); // time spent waiting counts as idle steps, so frequency drops only when steps take long
 
 		if (mT.stop.Sec() && (mTime >= mT.stop))
 			mbRun = false;
@@ -158,10 +188,24 @@ void cAsyncSocketServer::close()
 {
 	mbRun = false;
 
+	for (tAcceptThreads::iterator ait = mAcceptThreads.begin(); ait != mAcceptThreads.end(); ++ait) {
+		if (*ait) {
+			delete (*ait);
+			(*ait) = NULL;
+		}
+	}
+
+	mAcceptThreads.clear();
+
 	for (tCLIt it = mConnList.begin(); it != mConnList.end(); ++it) {
 		if (*it) {
 			mConnChooser.DelConn(*it);
 
+		#if USE_IO_URING
+			if (mIOUring)
+				mIOUring->Del(*it);
+		#endif
+
 			if (mFactory) {
 				mFactory->DeleteConn(*it);
 			} else {
@@ -170,6 +214,20 @@ void cAsyncSocketServer::close()
 			}
 		}
 	}
+
+#if USE_IO_URING
+	if (mIOUring) {
+		delete mIOUring;
+		mIOUring = NULL;
+	}
+#endif
+
+	mDNSWaitList.clear();
+
+	if (mResolver) {
+		delete mResolver;
+		mResolver = NULL;
+	}
 }
 
 /*
@@ -199,13 +257,25 @@ void cAsyncSocketServer::addConnection(cAsyncConn *new_conn)
 	}
 
 	mConnChooser.AddConn(new_conn);
-	mConnChooser.cConnChoose::OptIn((cConnBase*)new_conn, tChEvent(eCC_INPUT | eCC_ERROR));
+
+#if USE_IO_URING
+	if (mIOUring && (new_conn->GetType() == eCT_CLIENT)) { // engine reads the socket, chooser only reports errors and closing
+		mConnChooser.cConnChoose::OptIn((cConnBase*)new_conn, eCC_ERROR);
+		mIOUring->Add(new_conn);
+	} else
+#endif
+		mConnChooser.cConnChoose::OptIn((cConnBase*)new_conn, tChEvent(eCC_INPUT | eCC_ERROR));
+
 	tCLIt it = mConnList.insert(mConnList.begin(), new_conn);
 	new_conn->mIterator = it;
+	ScheduleConn(new_conn);
 
 	if (mTLSProxy.size() && (new_conn->AddrIP() == mTLSProxy)) // tls proxy, wait for myip command
 		return;
 
+	if (mUseDNS && (new_conn->GetType() == eCT_CLIENT))
+		LookupHost(new_conn);
+
 	if (0 > OnNewConn(new_conn))
 		delConnection(new_conn);
 }
@@ -245,6 +315,23 @@ void cAsyncSocketServer::delConnection(cAsyncConn *old_conn)
 	}
 
 	mConnChooser.DelConn(old_conn);
+	mTimerWheel.Cancel(old_conn);
+
+#if USE_IO_URING
+	if (mIOUring) {
+		if (!mIOUring->Del(old_conn)) // before socket is closed
+			vhErr(1) << "Failed to cancel io_uring requests, socket was shut down: " << old_conn << endl;
+
+		if (!mIOReady.empty()) // deleted while input is processed
+			replace(mIOReady.begin(), mIOReady.end(), old_conn, (cAsyncConn*)NULL);
+	}
+#endif
+
+	if (old_conn->DNSWaiting())
+		replace(mDNSWaitList.begin(), mDNSWaitList.end(), old_conn, (cAsyncConn*)NULL);
+
+	if (!mTimerExpired.empty()) // deleted while timers are processed
+		replace(mTimerExpired.begin(), mTimerExpired.end(), old_conn, (cAsyncConn*)NULL);
 
 	if (!badit)
 		mConnList.erase(it);
@@ -261,12 +348,20 @@ void cAsyncSocketServer::delConnection(cAsyncConn *old_conn)
 
 int cAsyncSocketServer::input(cAsyncConn *conn)
 {
+	if (conn->DNSWaiting()) // reported before input was disabled, read it later
+		return 1;
+
 	if (conn->ReadAll(mNoReadTry, mNoReadDelay) <= 0) // read all data available into a buffer
 		return 0;
 
+	return ReadLines(conn);
+}
+
+int cAsyncSocketServer::ReadLines(cAsyncConn *conn)
+{
 	int just_read = 0;
 
-	while (conn->ok && conn->mWritable) {
+	while (conn->ok && conn->mWritable && !conn->DNSWaiting()) {
 		if (conn->LineStatus() == AC_LS_NO_LINE) // create new line if necessary
 			conn->SetLineToRead(FactoryString(conn), '|', mMaxLineLength);
 
@@ -321,41 +416,133 @@ int cAsyncSocketServer::OnTimerBase(const cTime &now)
 {
 	OnTimer(now);
 
+	if (!mDNSWaitList.empty()) { // dont wait for slow name servers forever
+		cAsyncConn *conn;
+		size_t pos = 0;
+
+		while (pos < mDNSWaitList.size()) {
+			conn = mDNSWaitList[pos];
+
+			if (conn && ((conn->DNSWaiting() + (long)mDNSTimeout) > now.Sec())) {
+				pos++;
+				continue;
+			}
+
+			mDNSWaitList[pos] = mDNSWaitList.back();
+			mDNSWaitList.pop_back();
+
+			if (conn)
+				DNSResume(conn, "");
+		}
+	}
+
 	if ((mT.conn + timer_conn_period) <= now) {
 		mT.conn = now;
-		tCLIt it;
 
-		for (it = mConnList.begin(); it != mConnList.end(); ++it) {
-			if ((*it) && (*it)->ok)
-				(*it)->OnTimerBase(now);
+		if (mResolver)
+			mResolver->Purge(now.Sec());
+
+		mTimerWheel.Expire(now.Sec(), mTimerExpired); // only connections with passed deadline
+		cAsyncConn *conn;
+
+		for (size_t pos = 0; pos < mTimerExpired.size(); ++pos) {
+			conn = mTimerExpired[pos];
+
+			if (conn && conn->ok) {
+				conn->OnTimerBase(now);
+
+				if (conn->ok)
+					ScheduleConn(conn);
+			}
 		}
+
+		mTimerExpired.clear();
 	}
 
 	return 0;
 }
 
+void cAsyncSocketServer::ScheduleConn(cAsyncConn *conn)
+{
+	long due = conn->NextTimer(mTime);
+
+	if (due)
+		mTimerWheel.Schedule(conn, due);
+}
+
 int cAsyncSocketServer::OnTimer(const cTime &now)
 {
 	return 0;
 }
 
+void cAsyncSocketServer::AcceptQueued()
+{
+	tSocket sd;
+	unsigned int i;
+	cAsyncConn *new_conn;
+
+	for (tAcceptThreads::iterator it = mAcceptThreads.begin(); it != mAcceptThreads.end(); ++it) {
+		for (i = 0; i < mAcceptNum; i++) {
+			sd = (*it)->Pop();
+
+			if (sd == INVALID_SOCKET)
+				break;
+
+			cAsyncConn::sSocketCounter++;
+
+			if (!mFactory || !(new_conn = mFactory->CreateConn(sd)))
+				throw "Unable to create connection";
+
+			addConnection(new_conn);
+		}
+
+		if (i == mAcceptNum) // more may be waiting, take them on next step without waiting
+			mNoWait = true;
+	}
+}
+
+void cAsyncSocketServer::GetAcceptCounts(unsigned long &accepted, unsigned long &dropped) const
+{
+	accepted = dropped = 0;
+
+	for (tAcceptThreads::const_iterator it = mAcceptThreads.begin(); it != mAcceptThreads.end(); ++it) {
+		accepted += (*it)->mAccepted.load(std::memory_order_relaxed);
+		dropped += (*it)->mDropped.load(std::memory_order_relaxed);
+	}
+}
+
 void cAsyncSocketServer::TimeStep()
 {
-	cTime tmout(0, ((mChooseTimeOut * 1000) + 1));
+	if (mAcceptThreads.size())
+		AcceptQueued();
 
-	if (!mConnChooser.Choose(tmout)) {
-		//#if !defined _WIN32
-			::usleep(mNoConnDelay);
-		/*
-		#else
-			::Sleep(0);
-		#endif
-		*/
+#if USE_IO_URING
+	if (mIOUring)
+		IOUringStep();
+#endif
 
-		return;
+	if (mResolver && mResolver->HasResults())
+		DNSStep();
+
+	cTime tmout = WaitTime(), start(mTime);
+	const bool closing = mNoWait; // closed connections are reported by chooser even if kernel has nothing
+	mNoWait = false;
+	const int chosen = mConnChooser.Choose(tmout); // sleep here until there is something to do
+	mWaitSteps = 0;
+
+	if (tmout) { // we might have waited, time has changed
+		mTime.Get();
+
+		if (mStepDelay)
+			mWaitSteps = (mTime - start).MiliSec() / mStepDelay;
 	}
 
-	#if !USE_SELECT
+	if (!chosen && !closing)
+		return;
+
+	#if USE_EPOLL
+		cConnEpoll::iterator it;
+	#elif !USE_SELECT
 		cConnChoose::iterator it;
 	#else
 		cConnSelect::iterator it;
@@ -366,6 +553,11 @@ void cAsyncSocketServer::TimeStep()
 	for (it = mConnChooser.begin(); it != mConnChooser.end();) {
 		res = (*it);
 		++it;
+		if (res.mConn == &mWakeUp) { // only wakes us up
+			mWakeUp.Clear();
+			continue;
+		}
+
 		mNowTreating = (cAsyncConn*)res.mConn;
 
 		if (!mNowTreating)
@@ -410,6 +602,140 @@ void cAsyncSocketServer::TimeStep()
 	}
 }
 
+#if USE_IO_URING
+void cAsyncSocketServer::IOUringStep()
+{
+	mIOUring->Reap(mIOReady);
+	cAsyncConn *conn;
+
+	for (size_t pos = 0; pos < mIOReady.size(); ++pos) {
+		conn = mIOReady[pos];
+
+		if (!conn || !conn->ok)
+			continue;
+
+		mNowTreating = conn;
+
+		if (input(conn) <= 0) // engine reports only connections with new data or error
+			conn->ok = false;
+
+		mNowTreating = NULL;
+
+		if (!conn->ok)
+			delConnection(conn);
+	}
+
+	mIOReady.clear();
+}
+#endif
+
+void cAsyncSocketServer::LookupHost(cAsyncConn *conn)
+{
+	if (!conn || conn->DNSWaiting() || conn->AddrHost().size())
+		return;
+
+	if (!mResolver) {
+		try {
+			mResolver = new cDNSResolver(DNS_THREADS, &mWakeUp);
+		} catch (const char *ex) {
+			vhErr(1) << ex << ", using blocking lookup" << endl;
+			mResolver = NULL;
+		}
+
+		if (!mResolver) {
+			conn->DNSLookup();
+			return;
+		}
+	}
+
+	mResolver->mTTL = mDNSCacheTTL;
+	string host;
+
+	if (mResolver->Find(conn->IP2Num(), host, mTime.Sec())) {
+		conn->DNSDone(host);
+		return;
+	}
+
+	mResolver->Request(conn->IP2Num());
+	conn->DNSWait(mTime.Sec());
+	mDNSWaitList.push_back(conn);
+}
+
+void cAsyncSocketServer::DNSStep()
+{
+	vector<cDNSResolver::sResult> done;
+	mResolver->Collect(done, mTime.Sec());
+
+	if (done.empty() || mDNSWaitList.empty())
+		return;
+
+	map<unsigned long, const string*> hosts; // results are passed as they are, with short ttl they may be expired in cache already
+	map<unsigned long, const string*>::const_iterator res;
+
+	for (vector<cDNSResolver::sResult>::const_iterator it = done.begin(); it != done.end(); ++it)
+		hosts[it->mIP] = &it->mHost;
+
+	cAsyncConn *conn;
+	size_t pos = 0;
+
+	while (pos < mDNSWaitList.size()) {
+		conn = mDNSWaitList[pos];
+
+		if (conn) {
+			res = hosts.find(conn->IP2Num());
+
+			if (res == hosts.end()) { // still running
+				pos++;
+				continue;
+			}
+		}
+
+		mDNSWaitList[pos] = mDNSWaitList.back();
+		mDNSWaitList.pop_back();
+
+		if (conn)
+			DNSResume(conn, *res->second);
+	}
+}
+
+void cAsyncSocketServer::DNSResume(cAsyncConn *conn, const string &host)
+{
+	conn->DNSDone(host);
+
+	if (!conn->ok)
+		return;
+
+	if (!conn->BufferEmpty()) { // data that came while waiting
+		mNowTreating = conn;
+		ReadLines(conn);
+		mNowTreating = NULL;
+
+		if (!conn->ok)
+			delConnection(conn);
+	}
+}
+
+cTime cAsyncSocketServer::WaitTime()
+{
+	if (mNoWait)
+		return cTime(0, 0);
+
+#if USE_IO_URING
+	if (mIOUring && mIOUring->Pending())
+		return cTime(0, 0);
+#endif
+
+	cTime due(mT.main + timer_serv_period);
+
+	if (mT.stop.Sec() && (mT.stop < due))
+		due = mT.stop;
+
+	if (due <= mTime)
+		return cTime(0, 0);
+
+	return due - mTime;
+}
+
 cAsyncConn* cAsyncSocketServer::Listen(int OnPort/*, bool UDP*/)
 {
 	//if(!UDP)
@@ -436,6 +762,9 @@ int cAsyncSocketServer::StartListening(int OverrideDefaultPort)
 	if (mPort && !OverrideDefaultPort)
 		OverrideDefaultPort = mPort;
 
+	if (mAcceptThreadNum)
+		return (this->ListenThreaded(OverrideDefaultPort) ? 0 : -1);
+
 	if (this->Listen(OverrideDefaultPort/*, false*/))
 		return 0;
 
@@ -480,5 +809,34 @@ bool cAsyncSocketServer::StopListenConn(cAsyncConn *connection)
 }
 */
 
+bool cAsyncSocketServer::ListenThreaded(int OnPort)
+{
+	cAcceptThread *th;
+
+	for (unsigned int i = 0; i < mAcceptThreadNum; i++) {
+		th = new cAcceptThread(mAddr, OnPort, mAcceptNum, mAcceptNum * 10, &mWakeUp);
+
+		if (th->Listen() < 0) {
+			if (Log(0)) {
+				LogStream() << "Cannot listen on " << mAddr << ':' << OnPort << " TCP with accept thread " << i << endl;
+				LogStream() << "Please make sure the port is open and not already used by another process" << endl;
+				LogStream() << "Remember that hub must be started using root when port number is below 1024" << endl;
+			}
+
+			delete th;
+			throw "Unable to listen";
+			return false;
+		}
+
+		th->Start();
+		mAcceptThreads.push_back(th);
+	}
+
+	if (Log(0))
+		LogStream() << "Listening for connections on " << mAddr << ':' << OnPort << " TCP using " << mAcceptThreadNum << " accept threads" << endl;
+
+	return true;
+}
+
 	}; // namespace nSocket
 }; // namespace nVerliHub
@@ -25,12 +25,18 @@
 
 #if USE_SELECT
 	#include "cconnselect.h"
+#elif USE_EPOLL
+	#include "cconnepoll.h"
 #else
 	#include "cconnpoll.h"
 #endif
 
 #include "ctimeout.h"
+#include "cacceptthread.h"
+#include "ctimerwheel.h"
+#include "cwakeup.h"
 #include <list>
+#include <vector>
 #include "cobj.h"
 //#include "cconndc.h" // added
 #include "casyncconn.h"
@@ -101,6 +107,14 @@ namespace nVerliHub {
 				 */
 				virtual cAsyncConn* ListenWithConn(cAsyncConn *connection, int OnPort/*, bool UDP=false*/);
 
+				/**
+				 * Start accept threads that listen on the given port using SO_REUSEPORT.
+				 * Accepted connections are taken over by main loop in TimeStep().
+				 * @param OnPort The port to listen on.
+				 * @return True on success.
+				 */
+				bool ListenThreaded(int OnPort);
+
 				/**
 				* This event is triggered when a connection is closed.
 				* @param conn The closed connection closed.
@@ -185,15 +199,18 @@ namespace nVerliHub {
 				/// This value controls how often OnTimerBase() is called.
 				int timer_serv_period;
 
-				/// Delay in milliseconds to wait in main loop for every iteration.
+				/// Nominal length of main loop step in milliseconds.
+				/// Main loop waits for events instead of sleeping, time spent waiting is counted to mFrequency as steps of this length.
 				unsigned int mStepDelay;
 				unsigned int mNoConnDelay;
 				unsigned int mNoReadTry;
 				unsigned int mNoReadDelay;
-				unsigned int mChooseTimeOut;
 				unsigned int mAcceptNum;
 				unsigned int mAcceptTry;
 
+				/// Number of accept threads per listening port, zero accepts connections in main loop.
+				unsigned int mAcceptThreadNum;
+
 				/// Maximum size of the buffer for cAsyncConn::SetLineToRead() method.
 				unsigned long mMaxLineLength;
 
@@ -203,12 +220,42 @@ namespace nVerliHub {
 				/// Use reverse DNS lookup feature when there is a new connection.
 				int mUseDNS;
 
+				/// Seconds a new connection waits for its host name before it is processed without it.
+				unsigned int mDNSTimeout;
+
+				/// Seconds to keep resolved host names in cache.
+				unsigned int mDNSCacheTTL;
+
+				/// Background resolver, created on first lookup.
+				cDNSResolver *mResolver;
+
+				/**
+				* Find host name of a connection.
+				* Cached name is set immediately, otherwise connection stops reading until background lookup finishes or times out.
+				* @param conn The connection.
+				*/
+				void LookupHost(cAsyncConn *conn);
+
+				/// Read and write client connections with io_uring engine when kernel supports it.
+				bool mUseIOUring;
+
+			#if USE_IO_URING
+				/// The io_uring engine, NULL when client connections are handled by connection chooser.
+				cIOUring *mIOUring;
+			#endif
+
 				/// The current time.
 				cTimePrint mTime;
 
 				/// Measure the frequency of the server.
 				nUtils::cMeanFrequency<unsigned ,21> mFrequency;
 
+				/// Deadlines of connections, only connections with expired deadline are visited by OnTimerBase().
+				cTimerWheel mTimerWheel;
+
+				/// Wakes main loop from waiting in connection chooser, used by accept threads and io_uring engine.
+				cWakeUp mWakeUp;
+
 				unsigned int GetConnListSize() const
 				{
 					return mConnList.size();
@@ -219,6 +266,14 @@ namespace nVerliHub {
 					return mConnChooser.mConnList.size();
 				}
 
+				unsigned int GetAcceptThreads() const
+				{
+					return mAcceptThreads.size();
+				}
+
+				// sockets accepted and dropped by all accept threads
+				void GetAcceptCounts(unsigned long &accepted, unsigned long &dropped) const;
+
 		protected:
 			/// Indicate if the main loop is running.
 			bool mbRun;
@@ -227,7 +282,10 @@ namespace nVerliHub {
 			/// The list contains pointers to cAsyncConn instance.
 			tConnList mConnList;
 
-			#if !USE_SELECT
+			#if USE_EPOLL
+				/// Connection chooser for epoll.
+				cConnEpoll mConnChooser;
+			#elif !USE_SELECT
 				/// Connection chooser for poll.
 				cConnPoll mConnChooser;
 			#else
@@ -241,6 +299,18 @@ namespace nVerliHub {
 			/// Pointer to connection factory instance.
 			cConnFactory *mFactory;
 
+			/// Define a list of accept threads.
+			typedef vector<cAcceptThread*> tAcceptThreads;
+
+			/// Threads that accept incoming connections when mAcceptThreadNum is set.
+			tAcceptThreads mAcceptThreads;
+
+			/**
+			* Take connections accepted by accept threads and add them to the server.
+			* At most mAcceptNum connections are taken from each thread per call.
+			*/
+			void AcceptQueued();
+
 			/**
 			* Add the connection to the server so it can be processed.
 			* @param conn The connection to add.
@@ -281,6 +351,14 @@ namespace nVerliHub {
 			*/
 			virtual int input(cAsyncConn *conn);
 
+			/**
+			* Process complete lines in the buffer of the given connection.
+			* Stops when connection starts waiting for its host name.
+			* @param conn The connection.
+			* @return Number of processed bytes.
+			*/
+			int ReadLines(cAsyncConn *conn);
+
 			/**
 			* This event is triggered when there is a new incoming message
 			* for a connection.
@@ -313,6 +391,45 @@ namespace nVerliHub {
 			};
 
 			sTimers mT; // timer structure
+
+			/// Next step must not wait for events, for example because a connection is closing.
+			bool mNoWait;
+
+			/// Nominal steps spent waiting in last step, see mStepDelay.
+			unsigned int mWaitSteps;
+
+			/**
+			* Return how long main loop may wait for events, that is until next server timer or stop time.
+			* @return Time to wait, zero if there is work to do.
+			*/
+			cTime WaitTime();
+
+			/// Connections taken from timer wheel in current timer period.
+			vector<cAsyncConn*> mTimerExpired;
+
+			/**
+			* Put connection to timer wheel according to its next deadline.
+			* @param conn The connection.
+			*/
+			void ScheduleConn(cAsyncConn *conn);
+
+		#if USE_IO_URING
+			/// Connections with input received by io_uring engine in current step.
+			vector<cAsyncConn*> mIOReady;
+
+			/// Read input of connections reported by io_uring engine.
+			void IOUringStep();
+		#endif
+
+			/// Connections waiting for background DNS lookup.
+			vector<cAsyncConn*> mDNSWaitList;
+
+			/// Continue connections whose host name was resolved.
+			void DNSStep();
+
+			/// Continue a connection that waited for its host name and process data it has already sent.
+			void DNSResume(cAsyncConn *conn, const string &host);
+
 			int mRunResult; // stop code
 		private:
 			/// Pointer to the connection that server is currently handling
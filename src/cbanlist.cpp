@@ -559,7 +559,7 @@ void cBanList::Num2Ip(unsigned long mask, string &ip)
 
 void cBanList::AddNickTempBan(const string &nick, long until, const string &reason, unsigned bantype)
 {
-	unsigned long hash = mTempNickBanlist.HashLowerString(nick);
+	tTempNickIPBans::tHashType hash = mTempNickBanlist.HashLowerString(nick);
 	sTempBan *tban = mTempNickBanlist.GetByHash(hash);
 
 	if (tban) {
@@ -603,7 +603,7 @@ void cBanList::AddIPTempBan(unsigned long ip, long until, const string &reason,
 
 void cBanList::DelNickTempBan(const string &nick)
 {
-	unsigned long hash = mTempNickBanlist.HashLowerString(nick);
+	tTempNickIPBans::tHashType hash = mTempNickBanlist.HashLowerString(nick);
 	sTempBan *tban = mTempNickBanlist.GetByHash(hash);
 
 	if (tban) {
@@ -655,12 +655,12 @@ int cBanList::RemoveOldShortTempBans(long before)
 {
 	int n = 0;
 	tTempNickIPBans::iterator it;
-	unsigned long Hash;
+	tTempNickIPBans::tHashType Hash;
 	long Until;
 	sTempBan *tban;
 
 	for(it = mTempNickBanlist.begin(); it != mTempNickBanlist.end();) {
-		Hash = it.mItem->mHash;
+		Hash = it.Hash();
 		tban = *it;
 		Until = tban->mUntil;
 
@@ -673,7 +673,7 @@ int cBanList::RemoveOldShortTempBans(long before)
 		}
 	}
 	for(it = mTempIPBanlist.begin(); it != mTempIPBanlist.end();) {
-		Hash = it.mItem->mHash;
+		Hash = it.Hash();
 		tban = *it;
 		Until = tban->mUntil;
 
@@ -25,7 +25,7 @@
 #include "ckick.h"
 #include <string>
 #include <iostream>
-#include "thasharray.h"
+#include "tdensehasharray.h"
 
 using std::string;
 using std::ostream;
@@ -148,7 +148,7 @@ namespace nVerliHub {
 				bool IsIPTempBanned(unsigned long ip);
 
 				// list of temporary nick and ip bans
-				typedef tHashArray<sTempBan*> tTempNickIPBans;
+				typedef tDenseHashArray<sTempBan*> tTempNickIPBans;
 				tTempNickIPBans mTempNickBanlist;
 				tTempNickIPBans mTempIPBanlist;
 
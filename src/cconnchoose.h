@@ -56,6 +56,14 @@
 	#endif
 //#endif // _WIN32
 
+#if !USE_SELECT && defined(USE_EPOLL) && HAVE_SYS_EPOLL_H
+	#undef USE_EPOLL
+	#define USE_EPOLL 1
+#else
+	#undef USE_EPOLL
+	#define USE_EPOLL 0
+#endif
+
 #include "ctime.h"
 #include "cconnbase.h"
 
@@ -93,6 +93,32 @@ int cConnDC::Send(string &data, bool AddPipe, bool Flush)
 		data.append(1, '|');
 
 	size_t len = data.size();
+	LogSend(data);
+	int ret = Write(data, Flush);
+	OnSent(ret);
+
+	if (AddPipe)
+		data.erase(len - 1, 1);
+
+	return ret;
+}
+
+int cConnDC::SendShared(cSendSegment *seg, bool Flush, bool zipped)
+{
+	if (!mWritable)
+		return 0;
+
+	if (seg && !zipped)
+		LogSend(seg->mData);
+
+	int ret = WriteShared(seg, Flush, zipped);
+	OnSent(ret);
+	return ret;
+}
+
+void cConnDC::LogSend(const string &data)
+{
+	size_t len = data.size();
 
 	if (len > 1) { // write only if we really got anything excluding pipe
 		if (Log(5))
@@ -101,24 +127,28 @@ int cConnDC::Send(string &data, bool AddPipe, bool Flush)
 		if ((msLogLevel >= 3) && Server()->mNetOutLog && Server()->mNetOutLog.is_open())
 			Server()->mNetOutLog << len << ": " << data.substr(0, 100) << endl;
 	}
+}
 
-	int ret = Write(data, Flush);
-
-	if ((Server()->mTime.Sec() - mTimeLastAttempt.Sec()) >= 2) // delay 2 seconds
+void cConnDC::OnSent(int ret)
+{
+	if ((Server()->mTime.Sec() - mTimeLastAttempt.Sec()) >= 2) { // delay 2 seconds
 		mTimeLastAttempt = Server()->mTime;
 
-	if (ret > 0) { // calculate upload bandwidth in real time
-		SetGeoZone(); // must be called first
-		//Server()->mUploadZone[mGeoZone].Dump();
-		Server()->mUploadZone[mGeoZone].Insert(Server()->mTime, ret);
-		//Server()->mUploadZone[mGeoZone].Dump();
-		Server()->mProtoTotal[1] += ret; // add total upload
+		if (mTimeLastIOAction.Sec() < (mTimeLastAttempt.Sec() - 270)) // any action timeout, see OnTimer()
+			ScheduleTimer();
 	}
 
-	if (AddPipe)
-		data.erase(len - 1, 1);
+	if (ret > 0)
+		OnWriteDone(ret);
+}
 
-	return ret;
+void cConnDC::OnWriteDone(int sent) // calculate upload bandwidth in real time
+{
+	SetGeoZone(); // must be called first
+	//Server()->mUploadZone[mGeoZone].Dump();
+	Server()->mUploadZone[mGeoZone].Insert(Server()->mTime, sent);
+	//Server()->mUploadZone[mGeoZone].Dump();
+	Server()->mProtoTotal[1] += sent; // add total upload
 }
 
 int cConnDC::StrLog(ostream & ostr, int level)
@@ -211,11 +241,40 @@ int cConnDC::OnTimer(const cTime &now)
 	return 0;
 }
 
+long cConnDC::NextTimer(const cTime &now)
+{
+	long due = cAsyncConn::NextTimer(now), next;
+
+	for (int i = 0; i < eTO_MAXTO; i++) { // operation timeouts
+		if (bool(mTO[i].mLast) && bool(mTO[i].mMaxDelay)) {
+			next = (mTO[i].mLast + mTO[i].mMaxDelay).Sec() + 1; // must be exceeded
+
+			if (!due || (next < due))
+				due = next;
+		}
+	}
+
+	next = mTimeLastIOAction.Sec() + 271; // any action timeout, later it can only be triggered by OnSent()
+
+	if ((next > now.Sec()) && (!due || (next < due)))
+		due = next;
+
+	if (mpUser && mpUser->mInList && Server()->mC.delayed_ping) { // frozen user check
+		next = mT.ping.Sec() + Server()->mC.delayed_ping;
+
+		if (!due || (next < due))
+			due = next;
+	}
+
+	return due;
+}
+
 int cConnDC::ClearTimeOut(tTimeOut timeout)
 {
 	if(timeout >= eTO_MAXTO)
 		return 0;
 	mTO[timeout].Disable();
+	ScheduleTimer(); // login steps change other deadlines
 	return 1;
 }
 
@@ -227,6 +286,7 @@ int cConnDC::SetTimeOut(tTimeOut timeout, double seconds, cTime &now)
 		return 0;
 	mTO[timeout].mMaxDelay = seconds;
 	mTO[timeout].Reset(now);
+	ScheduleTimer(NextTimer(now));
 	return 1;
 }
 
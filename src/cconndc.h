@@ -23,6 +23,7 @@
 #include "casyncconn.h"
 #include "creguserinfo.h"
 #include "ctimeout.h"
+#include "tobjpool.h"
 
 namespace nVerliHub {
 	using namespace nSocket;
@@ -229,6 +230,17 @@ namespace nVerliHub {
 				 */
 				virtual ~cConnDC();
 
+				/// Memory of closed connections is reused by new ones.
+				static void* operator new(size_t size)
+				{
+					return tObjPool<cConnDC>::Alloc(size);
+				}
+
+				static void operator delete(void *ptr, size_t size)
+				{
+					tObjPool<cConnDC>::Free(ptr, size);
+				}
+
 				/**
 				 * Check if the given timeout is expired..
 				 * @param timeout The timeout.
@@ -298,6 +310,13 @@ namespace nVerliHub {
 				 */
 				virtual int OnTimer(const cTime &now);
 
+				/**
+				 * Return time of the next timeout, ping or close deadline of the connection.
+				 * @param now Current time.
+				 * @return Deadline in seconds or zero if there is none.
+				 */
+				virtual long NextTimer(const cTime &now);
+
 				/**
 				 * Reset login status flag and set a new value.
 				 * @param statusFlag Status flag.
@@ -327,6 +346,15 @@ namespace nVerliHub {
 				*/
 				int Send(string &data, bool AddPipe = true, bool Flush = true);
 
+				/**
+				* Send data shared with other users, data must already contain the pipe.
+				* @param seg Shared segment.
+				* @param flush Set it to true if data should be send immediatly or stored in the internal buffer.
+				* @param zipped Set it to true if segment already holds compressed data.
+				* @return The number of sent bytes.
+				*/
+				int SendShared(cSendSegment *seg, bool Flush = true, bool zipped = false);
+
 				/**
 				* Return a pointer to cServerDC instance.
 				* @return The pointer to cServerDC instance.
@@ -429,7 +457,16 @@ namespace nVerliHub {
 				/// @see tLogStatus
 				unsigned int mLogStatus;
 
+				/// Log outgoing data.
+				void LogSend(const string &data);
+
+				/// Update upload statistics after a write.
+				void OnSent(int ret);
+
 		protected:
+			/// Update upload statistics, also called for data sent later by io_uring engine.
+			virtual void OnWriteDone(int sent);
+
 			/**
 			 * Event handler function called before the connection is closed.
 			 * This method will also send the redirect protocol message ($ForceMove) to the user.
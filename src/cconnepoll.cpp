@@ -0,0 +1,267 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "cconnepoll.h"
+
+#if USE_EPOLL
+
+#include <unistd.h>
+
+#include <errno.h>
+
+namespace nVerliHub {
+	using namespace nEnums;
+
+	namespace nSocket {
+
+cConnEpoll::cConnEpoll():
+	mEpollFD(-1)
+{
+	mEpollFD = epoll_create1(EPOLL_CLOEXEC);
+
+	if (mEpollFD < 0)
+		throw "Unable to create epoll descriptor";
+
+	mFDs.reserve(20480);
+	mEvents.resize(1024);
+	mReady.reserve(1024);
+}
+
+cConnEpoll::~cConnEpoll()
+{
+	if (mEpollFD >= 0) {
+		::close(mEpollFD);
+		mEpollFD = -1;
+	}
+}
+
+void cConnEpoll::Ctl(int op, tSocket sock, unsigned events)
+{
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.u64 = 0;
+	ev.data.fd = sock;
+
+	if ((epoll_ctl(mEpollFD, op, sock, &ev) < 0) && (op == EPOLL_CTL_MOD) && (errno == ENOENT)) // socket was removed by kernel, register it again
+		epoll_ctl(mEpollFD, EPOLL_CTL_ADD, sock, &ev);
+}
+
+void cConnEpoll::OptIn(tSocket sock, tChEvent mask)
+{
+	sEpollFD &theFD = FD(sock);
+	unsigned event = theFD.events;
+
+	if (mask & eCC_CLOSE) {
+		if (theFD.events && (theFD.fd == sock)) // kernel does not need to know about it anymore
+			Ctl(EPOLL_CTL_DEL, sock, 0);
+
+		theFD.fd = sock;
+		theFD.events = 0;
+		mCloseList.push_back(sock);
+		return;
+	}
+
+	if (mask & eCC_INPUT)
+		event |= EPOLLIN | EPOLLPRI;
+
+	if (mask & eCC_OUTPUT)
+		event |= EPOLLOUT;
+
+	if (mask & eCC_ERROR)
+		event |= EPOLLERR | EPOLLHUP;
+
+	if (!event || ((theFD.fd == sock) && (event == theFD.events))) // nothing changed
+		return;
+
+	Ctl(((theFD.events && (theFD.fd == sock)) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD), sock, event);
+	theFD.fd = sock;
+	theFD.events = event;
+}
+
+void cConnEpoll::OptOut(tSocket sock, tChEvent mask)
+{
+	sEpollFD &theFD = FD(sock);
+	unsigned event = theFD.events;
+
+	if (mask & eCC_INPUT)
+		event &= ~unsigned(EPOLLIN | EPOLLPRI);
+
+	if (mask & eCC_OUTPUT)
+		event &= ~unsigned(EPOLLOUT);
+
+	if (mask & eCC_ERROR)
+		event &= ~unsigned(EPOLLERR | EPOLLHUP);
+
+	if (event) {
+		if (event != theFD.events) {
+			Ctl(EPOLL_CTL_MOD, sock, event);
+			theFD.events = event;
+		}
+	} else { // nothing left
+		if (theFD.events && (theFD.fd == sock))
+			Ctl(EPOLL_CTL_DEL, sock, 0);
+
+		theFD.reset();
+	}
+}
+
+int cConnEpoll::OptGet(tSocket sock)
+{
+	int mask = 0;
+	sEpollFD &theFD = FD(sock);
+	unsigned event = theFD.events;
+
+	if (!event && (theFD.fd == sock)) {
+		mask = eCC_CLOSE;
+	} else {
+		if (event & (EPOLLIN | EPOLLPRI))
+			mask |= eCC_INPUT;
+
+		if (event & EPOLLOUT)
+			mask |= eCC_OUTPUT;
+
+		if (event & (EPOLLERR | EPOLLHUP))
+			mask |= eCC_ERROR;
+	}
+
+	return mask;
+}
+
+int cConnEpoll::RevGet(tSocket sock)
+{
+	int mask = 0;
+	sEpollFD &theFD = FD(sock);
+	unsigned event = theFD.revents;
+
+	if (!theFD.events && (theFD.fd == sock))
+		mask = eCC_CLOSE;
+
+	if (event & (EPOLLIN | EPOLLPRI))
+		mask |= eCC_INPUT;
+
+	if (event & EPOLLOUT)
+		mask |= eCC_OUTPUT;
+
+	if (event & (EPOLLERR | EPOLLHUP))
+		mask |= eCC_ERROR;
+
+	return mask;
+}
+
+bool cConnEpoll::RevTest(tSocket sock)
+{
+	if ((sock < 0) || (sock >= (tSocket)mFDs.size()))
+		return false;
+
+	sEpollFD &theFD = FD(sock);
+
+	if (theFD.fd == INVALID_SOCKET)
+		return false;
+
+	if (!theFD.events)
+		return true;
+
+	return (theFD.revents & (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0;
+}
+
+void cConnEpoll::ClearRevents()
+{
+	tSockList::iterator it;
+
+	for (it = mReady.begin(); it != mReady.end(); ++it) {
+		if ((*it) < (tSocket)mFDs.size()) {
+			FD(*it).revents = 0;
+			FD(*it).queued = false;
+		}
+	}
+
+	mReady.clear();
+}
+
+int cConnEpoll::epoll(int wp_msec)
+{
+	ClearRevents();
+
+	if (!mCloseList.empty()) // dont wait when there are closed connections to report
+		wp_msec = 0;
+
+	int ret = epoll_wait(mEpollFD, &mEvents[0], mEvents.size(), wp_msec);
+
+	if (ret < 0) // interrupted
+		ret = 0;
+
+	tSocket sock;
+
+	for (int i = 0; i < ret; i++) {
+		sock = mEvents[i].data.fd;
+
+		if ((sock < 0) || (sock >= (tSocket)mFDs.size()))
+			continue;
+
+		sEpollFD &theFD = FD(sock);
+		theFD.revents = mEvents[i].events;
+
+		if (!theFD.queued) {
+			theFD.queued = true;
+			mReady.push_back(sock);
+		}
+	}
+
+	if ((ret == (int)mEvents.size()) && (mEvents.size() < mFDs.size())) // more sockets might be ready, let them all in next time
+		mEvents.resize(mEvents.size() * 2);
+
+	if (!mCloseList.empty()) {
+		tSockList::iterator it;
+
+		for (it = mCloseList.begin(); it != mCloseList.end(); ++it) {
+			sock = *it;
+
+			if (sock >= (tSocket)mFDs.size())
+				continue;
+
+			sEpollFD &theFD = FD(sock);
+
+			if ((theFD.fd == sock) && !theFD.events && !theFD.queued) {
+				theFD.queued = true;
+				mReady.push_back(sock);
+			}
+		}
+
+		mCloseList.clear();
+	}
+
+	return mReady.size();
+}
+
+bool cConnEpoll::AddConn(cConnBase *conn)
+{
+	if (!cConnChoose::AddConn(conn))
+		return false;
+
+	if (mLastSock >= (tSocket)mFDs.size())
+		mFDs.resize(mLastSock + (mLastSock / 2) + 1);
+
+	return true;
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
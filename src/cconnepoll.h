@@ -0,0 +1,213 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSERVERCCONNEPOLL_H
+#define NSERVERCCONNEPOLL_H
+
+#include "cconnchoose.h"
+
+#if USE_EPOLL
+#include <sys/epoll.h>
+#include <vector>
+
+using std::vector;
+
+namespace nVerliHub {
+	namespace nSocket {
+
+/**
+epoll connection chooser
+
+Unlike poll and select, the kernel keeps the list of registered descriptors,
+so a single choose operation and the following iteration only cost as much as the number of ready sockets.
+Connections that were closed by the hub are not known to the kernel, they are queued separately and reported on next choose.
+*/
+class cConnEpoll : public cConnChoose
+{
+public:
+	cConnEpoll();
+	~cConnEpoll();
+
+	/** Calls the epoll_wait function to determine ready sockets
+	  * \sa cConnChoose::Choose
+	  */
+	virtual int Choose(nUtils::cTime &tmout)
+	{
+		return this->epoll((int)tmout.MiliSec());
+	}
+
+	/**
+	* Register the connection for the given I/O operation.
+	* @param conn The connection.
+	* @param event Bitwise OR list of I/O operation.
+	*/
+	virtual void OptIn(tSocket sock, nEnums::tChEvent event);
+	using cConnChoose::OptIn;
+
+	/**
+	* Unregister the connection for the given I/O operations.
+	* @param conn The connection.
+	* @param event Bitwise OR list of I/O operation.
+	*/
+	virtual void OptOut(tSocket sock, nEnums::tChEvent event);
+	using cConnChoose::OptOut;
+
+	/**
+	* Return I/O operations for the given connection.
+	* @param conn The connection.
+	* @return Bitwise OR list of I/O operation.
+	*/
+	virtual int OptGet(tSocket sock);
+	using cConnChoose::OptGet;
+
+	/// @see cConnChoose::RevGet
+	virtual int RevGet(tSocket sock);
+
+	virtual bool RevTest(tSocket sock);
+
+	/**
+	* Add new connection to be handled by connection manager.
+	* @param conn The connection.
+	* @return True if connection is added; otherwise false.
+	*/
+	virtual bool AddConn(cConnBase *conn);
+
+	/**
+	  * State of single socket, what we asked the kernel for and what it returned after last choose.
+	*/
+	struct sEpollFD
+	{
+		tSocket fd;
+		unsigned events;
+		unsigned revents;
+		bool queued;
+
+		sEpollFD()
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			fd = INVALID_SOCKET;
+			events = revents = 0;
+			queued = false;
+		}
+	};
+
+	int epoll(int wp_msec);
+	typedef vector<sEpollFD> tFDArray;
+	typedef vector<tSocket> tSockList;
+
+	sEpollFD &FD(tSocket sock)
+	{
+		return mFDs[sock];
+	}
+
+	/**
+	* Iterator over sockets that were returned by last choose operation, it never touches idle sockets.
+	*/
+	struct iterator
+	{
+		cConnEpoll *mChoose;
+		tSockList::size_type mPos;
+		sChooseRes mRes;
+
+		iterator():
+			mChoose(NULL),
+			mPos(0)
+		{}
+
+		iterator(cConnEpoll *ch, tSockList::size_type pos):
+			mChoose(ch),
+			mPos(pos)
+		{
+			Skip();
+		}
+
+		void Skip()
+		{
+			while ((mPos < mChoose->mReady.size()) && !mChoose->RevTest(mChoose->mReady[mPos]))
+				++mPos;
+		}
+
+		iterator &operator++()
+		{
+			++mPos;
+			Skip();
+			return *this;
+		}
+
+		sChooseRes &operator*()
+		{
+			mRes.mSock = mChoose->mReady[mPos];
+			mRes.mEvent = mChoose->OptGet(mRes.mSock);
+			mRes.mRevent = mChoose->RevGet(mRes.mSock);
+			mRes.mConn = mChoose->operator[](mRes.mSock);
+			return mRes;
+		}
+
+		bool operator!=(const iterator &it) const
+		{
+			return mPos != it.mPos;
+		}
+
+		bool operator==(const iterator &it) const
+		{
+			return mPos == it.mPos;
+		}
+	};
+
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, mReady.size());
+	}
+
+protected:
+	void Ctl(int op, tSocket sock, unsigned events);
+	void ClearRevents();
+
+	// epoll descriptor
+	int mEpollFD;
+
+	// state of registered sockets, indexed by socket
+	tFDArray mFDs;
+
+	// epoll_wait result buffer, grows when filled up
+	vector<struct epoll_event> mEvents;
+
+	// sockets returned by last choose
+	tSockList mReady;
+
+	// sockets waiting to be reported as closed
+	tSockList mCloseList;
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
+
+#endif
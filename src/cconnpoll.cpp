@@ -31,8 +31,7 @@ namespace nVerliHub {
 
 	namespace nSocket {
 
-cConnPoll::cConnPoll():
-	mBlockSize(1024) // todo: what is this?
+cConnPoll::cConnPoll()
 {
 	mFDs.reserve(20480); // todo: what is this? really need that big reserve?
 }
@@ -155,33 +154,20 @@ bool cConnPoll::RevTest(tSocket sock)
 
 int cConnPoll::poll(int wp_sec)
 {
-//#if !defined _WIN32
-	int ret = 0, n = 0, done = 0, todo = mFDs.size(), tmp;
+	if (mFDs.empty())
+		return 0;
 
-	while (todo) {
-		tmp = todo;
+	nfds_t count = mFDs.size();
 
-		if (tmp > mBlockSize)
-			tmp = mBlockSize;
+	if ((tSocket)count > (mLastSock + 1)) // table is allocated ahead, passing more than open files limit fails with EINVAL
+		count = mLastSock + 1;
 
-		//TEMP_FAILURE_RETRY( // todo: TEMP_FAILURE_RETRY for the poll
-			ret = ::poll(&(mFDs[done]), tmp, wp_sec + 1);
-		//);
+	int ret = ::poll(&mFDs[0], count, wp_sec); // single call over all sockets, main loop may wait here for long time
 
-		if (ret < 0)
-			continue;
+	if (ret < 0) // interrupted
+		ret = 0;
 
-		todo -= tmp;
-		done += tmp;
-		n += ret;
-	}
-
-	return n;
-/*
-#else
-	return 0;
-#endif
-*/
+	return ret;
 }
 
 bool cConnPoll::AddConn(cConnBase *conn)
@@ -124,8 +124,6 @@ public:
 	}
 protected:
 	tFDArray mFDs;
-
-	const int mBlockSize;
 };
 
 	}; // namespace nSocket
@@ -21,79 +21,344 @@
 #include "cdcclients.h"
 #include "cconfigitembase.h"
 #include "cserverdc.h"
-#include "cpcre.h"
 #include "i18n.h"
+#include <limits.h>
 
 namespace nVerliHub {
-	using nUtils::cPCRE;
 	using namespace nEnums;
-	cDCTagParser cDCClients::mParser;
 
-	cDCTagParser::cDCTagParser()
+	static inline bool IsDigit(char c)
 	{
-		/*
-			0 - whole chunk
-			1 - whole prefix
-			2 - id in prefix
-			3 - version in prefix
-			4 - id
-			5 - version
-			6 - body
-		*/
+		return (c >= '0') && (c <= '9');
+	}
 
-		if (!mTagRE.Compile("(<(.+) +v?(.+)>)?<(.+?) +[Vv]\\:?([^,]+),([^>]*)>"))
-			throw "Error in tag general regular expression";
+	// leading digits as int, clamped on overflow like stream extraction
+	static int DigitsToInt(const char *str, const char *end)
+	{
+		long long res = 0;
 
-		/*
-			0 - whole chunk
-			1 - version number
-			2 - additional information
-		*/
+		while ((str < end) && IsDigit(*str)) {
+			res = (res * 10) + (*str++ - '0');
 
-		if (!mVersRE.Compile("\\(?r?([\\d\\.]+)\\)?(\\-[^\\d]+(\\d+)?)?(\\-(\\d+))?"))
-			throw "Error in version regular expression";
+			if (res > INT_MAX)
+				return INT_MAX;
+		}
 
-		/*
-			0 - whole chunk
-			1 - mode name
-		*/
+		return (int)res;
+	}
 
-		if (!mModeRE.Compile("[Mm]\\:([^,]+)"))
-			throw "Error in mode regular expression";
+	bool cDCTagParser::MatchTag(const string &desc, size_t start, sTagPos &pos)
+	{
+		const char *data = desc.data();
+		const size_t size = desc.size();
+		size_t vers, comma, close;
 
-		/*
-			0 - whole chunk
-			1 - guest hubs
-			2 - registered hubs
-			3 - operator hubs
-		*/
+		for (size_t id = start + 2; id < size; ++id) { // shortest id first
+			if (data[id - 1] == '\n') // id can not span lines
+				return false;
 
-		if (!mHubsRE.Compile("[Hh]\\:(\\d+)(\\/\\d+)?(\\/\\d+)?"))
-			throw "Error in hubs regular expression";
+			if (data[id] != ' ')
+				continue;
 
-		/*
-			0 - whole chunk
-			1 - slots
-		*/
+			vers = id + 1;
+
+			while ((vers < size) && (data[vers] == ' '))
+				++vers;
+
+			if ((vers >= size) || ((data[vers] != 'V') && (data[vers] != 'v')))
+				continue;
+
+			++vers;
+
+			if ((vers < size) && (data[vers] == ':') && ((vers + 1) < size) && (data[vers + 1] != ','))
+				++vers; // otherwise colon itself is the version
+
+			comma = desc.find(',', vers);
+
+			if ((comma == desc.npos) || (comma == vers))
+				continue;
 
-		if (!mSlotsRE.Compile("[Ss]\\:(\\d+)"))
-			throw "Error in slots regular expression";
+			close = desc.find('>', comma + 1);
+
+			if (close == desc.npos)
+				continue;
+
+			pos.mStart = start;
+			pos.mEnd = close + 1;
+			pos.mID = start + 1;
+			pos.mIDLen = id - start - 1;
+			pos.mVers = vers;
+			pos.mVersLen = comma - vers;
+			pos.mBody = comma + 1;
+			pos.mBodyLen = close - comma - 1;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool cDCTagParser::FindTag(const string &desc, sTagPos &pos)
+	{
+		const char *data = desc.data();
+		size_t start = desc.find('<'), line, tag, space;
+
+		while (start != desc.npos) {
+			/*
+				optional prefix tag reaches the last valid tag on same line
+				it needs a space inside and makes a part of the whole tag
+			*/
+
+			line = desc.find('\n', start);
+
+			if (line == desc.npos)
+				line = desc.size();
+
+			space = desc.find(' ', start + 2);
+
+			for (tag = line - 1; (space != desc.npos) && (tag >= (space + 3)) && (tag < line); --tag) {
+				if ((data[tag] != '<') || (data[tag - 1] != '>'))
+					continue;
+
+				if (MatchTag(desc, tag, pos)) {
+					pos.mStart = start;
+					return true;
+				}
+			}
+
+			if (MatchTag(desc, start, pos))
+				return true;
+
+			start = desc.find('<', start + 1);
+		}
+
+		return false;
+	}
+
+	double cDCTagParser::ParseVersion(const char *vers, size_t len)
+	{
+		const char *end = vers + len, *num = vers, *num_end, *build = NULL, *build_end = NULL;
+
+		while ((num < end) && !IsDigit(*num) && (*num != '.')) // version number
+			++num;
+
+		if (num == end)
+			return 0.;
+
+		num_end = num;
+
+		while ((num_end < end) && (IsDigit(*num_end) || (*num_end == '.')))
+			++num_end;
+
+		const char *cur = num_end;
+
+		if ((cur < end) && (*cur == ')'))
+			++cur;
+
+		if (((cur + 1) < end) && (*cur == '-') && !IsDigit(cur[1])) { // additional information and its number
+			cur += 2;
+
+			while ((cur < end) && !IsDigit(*cur))
+				++cur;
+
+			while ((cur < end) && IsDigit(*cur))
+				++cur;
+		}
+
+		if (((cur + 1) < end) && (*cur == '-') && IsDigit(cur[1])) { // build number
+			build = ++cur;
+
+			while ((cur < end) && IsDigit(*cur))
+				++cur;
+
+			build_end = cur;
+		}
 
 		/*
-			0 - whole chunk
-			1 - identifier
-			2 - value
+			build is appended as another decimal part and every dot after the first is dropped
+			value is exact as mantissa over power of ten while both fit in double
 		*/
 
-		if (!mLimitRE.Compile("([Bb]\\:|[Ll]\\:|[Ff]\\:\\d+\\/)(\\d+(\\.\\d)?)"))
-			throw "Error in limiter regular expression";
+		static const double pow10[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		const unsigned long long max_mant = ((1ULL << 53) - 1 - 9) / 10;
+		const char *part[2][2] = {{num, num_end}, {build, build_end}};
+		unsigned long long mant = 0;
+		unsigned int frac = 0;
+		bool dot = false, digit = false, exact = true;
+
+		for (int i = 0; i < 2; ++i) {
+			if (i)
+				dot = true;
+
+			for (cur = part[i][0]; cur < part[i][1]; ++cur) {
+				if (*cur == '.') {
+					dot = true;
+					continue;
+				}
+
+				digit = true;
+
+				if (dot)
+					++frac;
+
+				if (mant > max_mant)
+					exact = false;
+				else
+					mant = (mant * 10) + (*cur - '0');
+			}
+		}
+
+		if (!digit)
+			return 0.;
+
+		if (exact && (frac < (sizeof(pow10) / sizeof(double))))
+			return (double(mant) / pow10[frac]);
+
+		string ver; // rare long version is left to the stream
+		dot = false;
+
+		for (int i = 0; i < 2; ++i) {
+			if (i && build && !dot) {
+				ver.append(1, '.');
+				dot = true;
+			}
+
+			for (cur = part[i][0]; cur < part[i][1]; ++cur) {
+				if (*cur != '.')
+					ver.append(1, *cur);
+				else if (!dot)
+					ver.append(1, '.');
+
+				dot = dot || (*cur == '.');
+			}
+		}
+
+		double res = 0.;
+		istringstream is(ver);
+		is >> res;
+		return res;
 	}
 
+	void cDCTagParser::ParseBody(cDCTag *tag, int sum_hubs)
+	{
+		const char *body = tag->mTagBody.data(), *end = body + tag->mTagBody.size(), *cur, *val;
+		bool mode = false, hubs = false, slots = false, limit = false;
+
+		for (cur = body; ((cur + 2) < end) && !(mode && hubs && slots && limit); ++cur) { // first match of each field
+			if (cur[1] != ':')
+				continue;
+
+			val = cur + 2;
+
+			switch (*cur) {
+				case 'M':
+				case 'm':
+					if (mode || (*val == ','))
+						break;
+
+					mode = true;
+
+					{
+						const char *mode_end = val;
+
+						while ((mode_end < end) && (*mode_end != ','))
+							++mode_end;
+
+						const size_t len = mode_end - val;
+						const char sec = ((len == 2) ? val[1] : 0);
+
+						if ((len > 2) || ((len == 2) && (sec != 'A') && (sec != 'P') && (sec != '5') && (sec != 'N')))
+							tag->mClientMode = eCM_OTHER;
+						else if (*val == 'A') // A, AA, AP, A5, AN
+							tag->mClientMode = eCM_ACTIVE;
+						else if (*val == 'P') // P, PP, PA, P5, PN
+							tag->mClientMode = eCM_PASSIVE;
+						else if (*val == '5') // 5, 55, 5A, 5P, 5N
+							tag->mClientMode = eCM_SOCK5;
+						else
+							tag->mClientMode = eCM_OTHER;
+					}
+
+					break;
+
+				case 'H':
+				case 'h':
+					if (hubs || !IsDigit(*val))
+						break;
+
+					hubs = true;
+					tag->mHubsUsr = tag->mTotHubs = DigitsToInt(val, end); // where user is guest
+
+					while ((val < end) && IsDigit(*val))
+						++val;
+
+					if (((val + 1) < end) && (*val == '/') && IsDigit(val[1])) { // where user is registered
+						tag->mHubsReg = DigitsToInt(++val, end);
+
+						if (sum_hubs >= 2)
+							tag->mTotHubs += tag->mHubsReg;
+
+						while ((val < end) && IsDigit(*val))
+							++val;
+
+						if (((val + 1) < end) && (*val == '/') && IsDigit(val[1])) { // where user is operator
+							tag->mHubsOp = DigitsToInt(++val, end);
+
+							if (sum_hubs >= 3)
+								tag->mTotHubs += tag->mHubsOp;
+						}
+					}
+
+					break;
+
+				case 'S':
+				case 's':
+					if (slots || !IsDigit(*val))
+						break;
+
+					slots = true;
+					tag->mSlots = DigitsToInt(val, end);
+					break;
+
+				case 'F':
+				case 'f':
+					if (limit || !IsDigit(*val))
+						break;
+
+					while ((val < end) && IsDigit(*val))
+						++val;
+
+					if (((val + 1) >= end) || (*val != '/') || !IsDigit(val[1]))
+						break;
+
+					++val;
+					// fall through
+
+				case 'B':
+				case 'b':
+				case 'L':
+				case 'l':
+					if (limit || !IsDigit(*val))
+						break;
+
+					limit = true;
+					tag->mLimit = DigitsToInt(val, end);
+					break;
+
+				default:
+					break;
+			}
+		}
+	}
 	namespace nTables {
 
 	cDCClients::cDCClients(cServerDC *server):
 		tMySQLMemoryList<cDCClient,cServerDC>(server->mMySQL, server, "client_list"),
-		mServer(server)
+		mServer(server),
+		mTagIndexDirty(true)
 	{
 		SetClassName("nDC::cDCClients");
 		mPositionInDesc = -1;
@@ -114,19 +379,49 @@ namespace nVerliHub {
 
 	cDCClient* cDCClients::FindTag(const string &tagID)
 	{
-		iterator it;
-		cDCClient *client;
+		if (mTagIndexDirty) { // first enabled client wins like in list order
+			mTagIndex.clear();
 
-		for (it= begin(); it != end(); ++it) {
-			client = *it;
+			for (iterator it = begin(); it != end(); ++it) {
+				if (*it && (*it)->mEnable)
+					mTagIndex.insert(tTagIndex::value_type((*it)->mTagID, *it));
+			}
 
-			if (client && client->mEnable && (client->mTagID == tagID)) // todo: use map
-				return client;
+			mTagIndexDirty = false;
 		}
 
+		tTagIndex::const_iterator it = mTagIndex.find(tagID);
+
+		if (it != mTagIndex.end())
+			return it->second;
+
 		return NULL; // unknwon client
 	}
 
+	void cDCClients::Empty()
+	{
+		mTagIndexDirty = true;
+		tClientsBase::Empty();
+	}
+
+	cDCClient* cDCClients::AppendData(cDCClient const &data)
+	{
+		mTagIndexDirty = true;
+		return tClientsBase::AppendData(data);
+	}
+
+	int cDCClients::UpdateData(cDCClient &data)
+	{
+		mTagIndexDirty = true;
+		return tClientsBase::UpdateData(data);
+	}
+
+	void cDCClients::DelData(cDCClient &data)
+	{
+		mTagIndexDirty = true;
+		tClientsBase::DelData(data);
+	}
+
 	bool cDCClients::CompareDataKey(const cDCClient &D1, const cDCClient &D2)
 	{
 		return (D1.mName == D2.mName);
@@ -134,166 +429,32 @@ namespace nVerliHub {
 
 	bool cDCClients::ParsePos(const string &desc)
 	{
+		cDCTagParser::sTagPos pos;
 		mPositionInDesc = -1;
 
-		if (mParser.mTagRE.Exec(desc) >= 0)
-			mPositionInDesc = mParser.mTagRE.StartOf(0);
+		if (cDCTagParser::FindTag(desc, pos))
+			mPositionInDesc = pos.mStart;
 
 		return (mPositionInDesc > -1);
 	}
 
 	cDCTag* cDCClients::ParseTag(const string &desc)
 	{
-		string str, ver("0");
 		cDCTag *tag = new cDCTag(mServer);
-
-		/*
-			0 - whole chunk
-			1 - whole prefix
-			2 - id in prefix
-			3 - version in prefix
-			4 - id
-			5 - version
-			6 - body
-		*/
-
-		enum {
-			eTP_COMPLETE,
-			eTP_PREFIX, eTP_PTAGID, eTP_PVERSION,
-			eTP_TAGID, eTP_VERSION,
-			eTP_BODY
-		};
-
+		cDCTagParser::sTagPos pos;
 		tag->mClientMode = eCM_NOTAG; // todo: detect invalid tag
 		mPositionInDesc = -1;
 
-		if (mParser.mTagRE.Exec(desc) >= 3) {
-			mPositionInDesc = mParser.mTagRE.StartOf(eTP_COMPLETE); // copy tag parts
-			mParser.mTagRE.Extract(eTP_COMPLETE, desc, tag->mTag);
-			mParser.mTagRE.Extract(eTP_BODY, desc, tag->mTagBody);
-			mParser.mTagRE.Extract(eTP_TAGID, desc, tag->mTagID);
-			mParser.mTagRE.Extract(eTP_VERSION, desc, str);
-
-			/*
-				0 - whole chunk
-				1 - main version
-				2 - crap information
-				3 - crap number
-				4 - build information
-				5 - build number
-			*/
-
-			enum {
-				eVP_COMPLETE,
-				eVP_MAINVER,
-				eVP_CRAPINFO, eVP_CRAPNUM,
-				eVP_BUILDINFO, eVP_BUILDVER
-			};
-
-			if (mParser.mVersRE.Exec(str) >= 1) { // client version
-				mParser.mVersRE.Extract(eVP_MAINVER, str, ver);
-
-				if (mParser.mVersRE.PartFound(eVP_BUILDINFO)) {
-					mParser.mVersRE.Extract(eVP_BUILDVER, str, str);
-					ver.append(1, '.');
-					ver.append(str);
-				}
-
-				size_t pos = ver.find('.');
-
-				if (pos != ver.npos) {
-					pos = ver.find('.', pos + 1);
-
-					while (pos != ver.npos) {
-						ver.erase(pos, 1);
-						pos = ver.find('.', pos);
-					}
-				}
-			}
-
-			/*
-			if (mParser.mTagRE.PartFound(eTP_PREFIX)) {
-				mParser.mTagRE.Extract(eTP_PTAGID, desc, tag->mTagID);
-				mParser.mTagRE.Extract(eTP_PVERSION, desc, str);
-			}
-			*/
+		if (cDCTagParser::FindTag(desc, pos)) {
+			mPositionInDesc = pos.mStart; // copy tag parts
+			tag->mTag.assign(desc, pos.mStart, pos.mEnd - pos.mStart);
+			tag->mTagBody.assign(desc, pos.mBody, pos.mBodyLen);
+			tag->mTagID.assign(desc, pos.mID, pos.mIDLen);
+			tag->mClientVersion = cDCTagParser::ParseVersion(desc.data() + pos.mVers, pos.mVersLen);
+			cDCTagParser::ParseBody(tag, mServer->mC.tag_sum_hubs);
 		}
 
 		tag->client = FindTag(tag->mTagID); // todo: use FindData
-
-		if (mParser.mModeRE.Exec(tag->mTagBody) >= 1) { // client mode
-			mParser.mModeRE.Extract(1, tag->mTagBody, str);
-
-			if ((str == "A") || (str == "AA") || (str == "AP") || (str == "A5") || (str == "AN"))
-				tag->mClientMode = eCM_ACTIVE;
-			else if ((str == "P") || (str == "PP") || (str == "PA") || (str == "P5") || (str == "PN"))
-				tag->mClientMode = eCM_PASSIVE;
-			else if ((str == "5") || (str == "55") || (str == "5A") || (str == "5P") || (str == "5N"))
-				tag->mClientMode = eCM_SOCK5;
-			else
-				tag->mClientMode = eCM_OTHER;
-		}
-
-		istringstream is(ver);
-		is >> tag->mClientVersion;
-		is.clear();
-
-		int hubs = -1, hubs_usr = -1, hubs_reg = -1, hubs_op = -1, tmp;
-		char c;
-
-		if (mParser.mHubsRE.Exec(tag->mTagBody) >= 1) { // number of hubs
-			mParser.mHubsRE.Extract(1, tag->mTagBody, str); // where user is guest
-			is.str(str);
-			is >> hubs;
-			is.clear();
-			hubs_usr = hubs;
-
-			if (mParser.mHubsRE.PartFound(2)) { // where user is registered
-				tmp = 0;
-				mParser.mHubsRE.Extract(2, tag->mTagBody, str);
-				is.str(str);
-				is >> c >> tmp;
-				is.clear();
-
-				if (mServer->mC.tag_sum_hubs >= 2)
-					hubs += tmp;
-
-				hubs_reg = tmp;
-			}
-
-			if (mParser.mHubsRE.PartFound(3)) { // where user is operator
-				tmp = 0;
-				mParser.mHubsRE.Extract(3, tag->mTagBody, str);
-				is.str(str);
-				is >> c >> tmp;
-				is.clear();
-
-				if (mServer->mC.tag_sum_hubs >= 3)
-					hubs += tmp;
-
-				hubs_op = tmp;
-			}
-
-			tag->mTotHubs = hubs;
-			tag->mHubsUsr = hubs_usr;
-			tag->mHubsReg = hubs_reg;
-			tag->mHubsOp = hubs_op;
-		}
-
-		if (mParser.mSlotsRE.Exec(tag->mTagBody) >= 1) { // number of slots
-			mParser.mSlotsRE.Extract(1, tag->mTagBody, str);
-			is.str(str);
-			is >> tag->mSlots;
-			is.clear();
-		}
-
-		if (mParser.mLimitRE.Exec(tag->mTagBody) >= 2) { // limiter
-			mParser.mLimitRE.Extract(2, tag->mTagBody, str);
-			is.str(str);
-			is >> tag->mLimit;
-			is.clear();
-		}
-
 		return tag;
 	}
 
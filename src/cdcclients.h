@@ -24,11 +24,13 @@
 #include "tlistconsole.h"
 #include "cdcconsole.h"
 #include <sstream>
+#include <unordered_map>
 #include "cpcre.h"
 #include "cdctag.h"
 #include "cdcclient.h"
 
 using namespace std;
+using std::unordered_map;
 
 namespace nVerliHub {
 	/*
@@ -42,20 +44,36 @@ namespace nVerliHub {
 	*/
 
 	/*
-		parser for dc tag
+		single pass parser for dc tag, it matches exactly what following regular expressions used to match
+		tag: (<(.+) +v?(.+)>)?<(.+?) +[Vv]\:?([^,]+),([^>]*)>
+		version: \(?r?([\d\.]+)\)?(\-[^\d]+(\d+)?)?(\-(\d+))?
+		mode: [Mm]\:([^,]+)
+		hubs: [Hh]\:(\d+)(\/\d+)?(\/\d+)?
+		slots: [Ss]\:(\d+)
+		limiter: ([Bb]\:|[Ll]\:|[Ff]\:\d+\/)(\d+(\.\d)?)
 	*/
 	class cDCTagParser
 	{
 		public:
-		// constructor
-		cDCTagParser();
-		// regular expressions
-		nUtils::cPCRE mTagRE;
-		nUtils::cPCRE mVersRE;
-		nUtils::cPCRE mModeRE;
-		nUtils::cPCRE mHubsRE;
-		nUtils::cPCRE mSlotsRE;
-		nUtils::cPCRE mLimitRE;
+		// position of the tag in description and its parts, as offset and length
+		struct sTagPos
+		{
+			size_t mStart, mEnd;
+			size_t mID, mIDLen;
+			size_t mVers, mVersLen;
+			size_t mBody, mBodyLen;
+		};
+
+		// find the tag in description, false if there is none
+		static bool FindTag(const string &desc, sTagPos &pos);
+		// client version from version part of the tag, 0 if it has no number
+		static double ParseVersion(const char *vers, size_t len);
+		// fill mode, hubs, slots and limit of the tag from its body in one pass
+		static void ParseBody(cDCTag *tag, int sum_hubs);
+
+		private:
+		// match tag without prefix starting at the given position
+		static bool MatchTag(const string &desc, size_t start, sTagPos &pos);
 	};
 
 	namespace nSocket {
@@ -69,8 +87,11 @@ namespace nVerliHub {
 		typedef tMySQLMemoryList<cDCClient, nSocket::cServerDC> tClientsBase;
 		class cDCClients : public tClientsBase
 		{
-			static cDCTagParser mParser;
 			nSocket::cServerDC *mServer;
+			// enabled clients by tag id, rebuilt after the list changes
+			typedef unordered_map<string, cDCClient*> tTagIndex;
+			tTagIndex mTagIndex;
+			bool mTagIndexDirty;
 			public:
 				int mPositionInDesc;
 
@@ -82,6 +103,10 @@ namespace nVerliHub {
 				bool ParsePos(const string &desc);
 				cDCTag* ParseTag(const string &desc);
 				bool ValidateTag(cDCTag *tag, ostream &os, cConnType *conn_type, int &code);
+				virtual void Empty();
+				virtual cDCClient *AppendData(cDCClient const &data);
+				virtual int UpdateData(cDCClient &data);
+				virtual void DelData(cDCClient &data);
 		};
 
 
@@ -124,6 +124,7 @@ void cDCConf::AddVars()
 	Add("int_search_reg_pas", int_search_reg_pas, 48);
 	Add("int_search_vip", int_search_vip, 8);
 	Add("int_search_op", int_search_op, 1);
+	Add("tth_search_window", tth_search_window, 0); // seconds in which same tth search is sent only once, 0 to disable
 	Add("min_search_chars", min_search_chars, 4);
 	Add("max_passive_sr",max_passive_sr,25);
 	Add("delayed_search", delayed_search, true);
@@ -317,6 +318,8 @@ void cDCConf::AddVars()
 	Add("tban_max", tban_max, 3600 * 24 * 30);
 	Add("log_level",mS.msLogLevel, 0);
 	Add("dns_lookup",mS.mUseDNS, 0);
+	Add("dns_lookup_timeout", mS.mDNSTimeout, 5u);
+	Add("dns_cache_ttl", mS.mDNSCacheTTL, 3600u);
 	Add("report_dns_lookup", report_dns_lookup, false);
 	Add("report_user_country", report_user_country, true);
 	Add("hide_all_kicks", hide_all_kicks, true);
@@ -338,13 +341,14 @@ void cDCConf::AddVars()
 	Add("adv_timer_conn_period", mS.timer_conn_period, 4);
 	Add("adv_timer_serv_period", mS.timer_serv_period, 1);
 	Add("adv_min_frequency", min_frequency, 0.3);
-	Add("adv_step_delay", mS.mStepDelay, 50); // note: this is milliseconds
+	Add("adv_step_delay", mS.mStepDelay, 50); // note: this is milliseconds, main loop does not sleep anymore, waiting is counted as steps of this length in hub frequency
 	Add("adv_no_conn_delay", mS.mNoConnDelay, 50); // note: this is microseconds
 	Add("adv_no_read_try", mS.mNoReadTry, 100);
 	Add("adv_no_read_delay", mS.mNoReadDelay, 5); // note: this is microseconds
-	Add("adv_conn_choose_timeout", mS.mChooseTimeOut, 10); // note: this is milliseconds
 	Add("adv_conn_accept_num", mS.mAcceptNum, 100); // note: this also sets listen backlog
 	Add("adv_conn_accept_try", mS.mAcceptTry, 10);
+	Add("adv_conn_accept_threads", mS.mAcceptThreadNum, 0); // note: number of threads per port, needs restart
+	Add("adv_io_uring", mS.mUseIOUring, false); // note: client connections are read and written by io_uring engine, needs restart
 	Add("adv_max_upload_kbps", max_upload_kbps, 131072.);
 	Add("adv_max_outbuf_size", max_outbuf_size, (unsigned long)MAX_SEND_SIZE);
 	Add("adv_max_outfill_size", max_outfill_size, (unsigned long)MAX_SEND_FILL_SIZE);
@@ -359,6 +363,9 @@ void cDCConf::AddVars()
 	Add("disable_zlib", disable_zlib, true);
 	Add("zlib_compress_level", zlib_compress_level, int(Z_DEFAULT_COMPRESSION));
 	Add("zlib_min_len", zlib_min_len, 100);
+	Add("zlib_stream", zlib_stream, false); // keep one deflate stream per connection instead of compressing each flush alone
+	Add("zlib_stream_window", zlib_stream_window, 13); // window bits of the stream, 9 to 15, state memory grows with both
+	Add("zlib_stream_memlevel", zlib_stream_memlevel, 6); // memory level of the stream, 1 to 9
 	Add("detect_ctmtohub", detect_ctmtohub, true); // ctm2hub
 	Add("disable_extjson", disable_extjson, true); // extjson
 	Add("mmdb_names_lang", mmdb_names_lang, ""); // maxminddb names language, empty means english
@@ -188,6 +188,7 @@ public:
 	unsigned int int_search_reg;
 	unsigned int int_search_vip;
 	unsigned int int_search_op;
+	unsigned int tth_search_window;
 	unsigned int int_login;
 
 	// protocol flood
@@ -276,6 +277,9 @@ public:
 	bool disable_zlib;
 	int zlib_compress_level;
 	unsigned int zlib_min_len;
+	bool zlib_stream;
+	int zlib_stream_window;
+	int zlib_stream_memlevel;
 	bool detect_ctmtohub; // ctm2hub
 	bool disable_extjson; // extjson
 	string mmdb_names_lang; // mmdb
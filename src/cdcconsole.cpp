@@ -836,6 +836,8 @@ int cDCConsole::CmdRegMe(istringstream &cmd_line, cConnDC *conn, bool unreg)
 					mOwner->mTotalShare += conn->mpUser->mShare;
 				}
 
+				mOwner->OnUserClassChange(conn->mpUser);
+
 				mOwner->SetUserRegInfo(conn, conn->mpUser->mNick); // update registration information in real time aswell
 				mOwner->ReportUserToOpchat(conn, _("User has been unregistered"), false);
 				return 1;
@@ -929,6 +931,7 @@ int cDCConsole::CmdRegMe(istringstream &cmd_line, cConnDC *conn, bool unreg)
 			}
 
 			conn->mpUser->mClass = tUserCl(mOwner->mC.autoreg_class);
+			mOwner->OnUserClassChange(conn->mpUser);
 			mOwner->SetUserRegInfo(conn, conn->mpUser->mNick); // update registration information in real time aswell
 			os.str("");
 			os << autosprintf(_("New user has been registered with class %d"), mOwner->mC.autoreg_class);
@@ -1079,6 +1082,7 @@ int cDCConsole::CmdRegMyPasswd(istringstream &cmd_line, cConnDC *conn)
 	}
 
 	conn->mpUser->mClass = tUserCl(ui.getClass());
+	mOwner->OnUserClassChange(conn->mpUser);
 
 	if ((conn->mpUser->mClass >= mOwner->mC.opchat_class) && !mOwner->mOpchatList.ContainsHash(conn->mpUser->mNickHash)) // opchat list
 		mOwner->mOpchatList.AddWithHash(conn->mpUser, conn->mpUser->mNickHash);
@@ -1169,6 +1173,7 @@ int cDCConsole::CmdClass(istringstream &cmd_line, cConnDC *conn)
 		if (old_class < op_class) {
 			os << autosprintf(_("Temporarily changing class from %d to %d for user: %s"), old_class, new_class, nick.c_str());
 			user->mClass = (tUserCl)new_class;
+			mOwner->OnUserClassChange(user);
 
 			if ((old_class < mOwner->mC.opchat_class) && (new_class >= mOwner->mC.opchat_class)) { // opchat list
 				if (!mOwner->mOpchatList.ContainsHash(user->mNickHash))
@@ -3233,6 +3238,7 @@ bool cDCConsole::cfRegUsr::operator()()
 					}
 
 					user->mClass = tUserCl(ParClass);
+					mS->OnUserClassChange(user);
 					mS->SetUserRegInfo(user->mxConn, user->mNick); // update registration information in real time aswell
 				}
 
@@ -3290,6 +3296,8 @@ bool cDCConsole::cfRegUsr::operator()()
 						mS->mTotalShare += user->mShare;
 					}
 
+					mS->OnUserClassChange(user);
+
 					mS->SetUserRegInfo(user->mxConn, user->mNick); // update registration information in real time aswell
 				}
 
@@ -3364,6 +3372,7 @@ bool cDCConsole::cfRegUsr::operator()()
 				}
 
 				user->mClass = tUserCl(ParClass);
+				mS->OnUserClassChange(user);
 			}
 
 			field = "class";
@@ -3420,6 +3429,7 @@ bool cDCConsole::cfRegUsr::operator()()
 					if (user->mHideShare && (par == "0")) { // setting to 0
 						user->mHideShare = false;
 						mS->mTotalShare += user->mShare;
+						mS->UpdateSearchRecipient(user);
 
 						if (ostr.str().empty())
 							ostr << _("Your share is now visible.");
@@ -3427,6 +3437,7 @@ bool cDCConsole::cfRegUsr::operator()()
 					} else if (!user->mHideShare && (par != "0")) { // setting to 0, it appears that only 0 means false, anything else means true
 						user->mHideShare = true;
 						mS->mTotalShare -= user->mShare;
+						mS->UpdateSearchRecipient(user);
 
 						if (ostr.str().empty())
 							ostr << _("Your share is now hidden.");
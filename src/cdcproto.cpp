@@ -817,6 +817,7 @@ int cDCProto::DC_MyPass(cMessageDC *msg, cConnDC *conn)
 		}
 
 		conn->mpUser->mClass = tUserCl(conn->mRegInfo->getClass());
+		mS->OnUserClassChange(conn->mpUser);
 
 		if ((conn->mpUser->mClass >= mS->mC.opchat_class) && !mS->mOpchatList.ContainsHash(conn->mpUser->mNickHash)) // opchat list
 			mS->mOpchatList.AddWithHash(conn->mpUser, conn->mpUser->mNickHash);
@@ -1363,24 +1364,34 @@ int cDCProto::DC_MyINFO(cMessageDC *msg, cConnDC *conn)
 	Create_MyINFO(myinfo, nick, myinfo_desc + myinfo_tag, myinfo_speed, myinfo_email, myinfo_share, false); // dont reserve for pipe, we are not sending this
 
 	if (conn->mpUser->mInList) { // login or send to all
+		mS->UpdateSearchRecipient(conn->mpUser); // share, mode or flag may have changed
+
 		/*
 			send it to all only if
-				its not too often
-				it has changed since last time
-				send only the version that has changed only to those who want it
+				it has changed since last time, compared is the version others see, so hidden fields dont count
+				its not too often, otherwise it is queued and only latest version is sent when delay passes
 		*/
 
-		if (mS->MinDelay(conn->mpUser->mT.info, mS->mC.int_myinfo) && (StrCompare(conn->mpUser->mMyINFO, 0, conn->mpUser->mMyINFO.size(), myinfo) != 0)) {
+		if (StrCompare(conn->mpUser->mMyINFO, 0, conn->mpUser->mMyINFO.size(), myinfo) != 0) {
 #ifdef USE_BUFFER_RESERVE
 			if (conn->mpUser->mMyINFO.capacity() < myinfo.size())
 				conn->mpUser->mMyINFO.reserve(myinfo.size());
 #endif
 
 			conn->mpUser->mMyINFO = myinfo;
+			mS->mUserList.OnInfoChange(conn->mpUser);
+
+			if (!conn->mpUser->mMyINFOPending) { // already queued otherwise
+				if (mS->MinDelay(conn->mpUser->mT.info, mS->mC.int_myinfo)) {
 #ifdef USE_BUFFER_RESERVE
-			myinfo.reserve(myinfo.size() + 1); // reserve for pipe
+					myinfo.reserve(myinfo.size() + 1); // reserve for pipe
 #endif
-			mS->mUserList.SendToAll(myinfo, mS->mC.delayed_myinfo, true);
+					mS->mUserList.SendToAll(myinfo, mS->mC.delayed_myinfo, true);
+				} else {
+					conn->mpUser->mMyINFOPending = true;
+					mS->mMyINFOQueue.push_back(conn->mpUser->mNickHash);
+				}
+			}
 		}
 	} else { // user logs in for the first time
 #ifdef USE_BUFFER_RESERVE
@@ -2031,8 +2042,8 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 		return -1;
 
 	ostringstream os;
-	const string &nick = msg->ChunkString(eCH_CM_NICK); // find other user
-	cUser *other = mS->mUserList.GetUserByNick(nick);
+	const cChunkView nick = msg->ChunkView(eCH_CM_NICK); // find other user
+	cUser *other = mS->mUserList.GetUserByNick(nick.Data(), nick.Size());
 
 	if (!other || !other->mInList) {
 		/*
@@ -2053,7 +2064,7 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 					if (StrCompare(os.str(), 0, os.str().size(), ban.mReason) != 0) {
 						os.str("");
 						*//*
-						os << autosprintf(_("You're trying to connect to an offline user: %s"), nick.c_str());
+						os << autosprintf(_("You're trying to connect to an offline user: %s"), nick.AsString().c_str());
 						mS->DCPublicHS(os.str(), conn);
 						*//*
 					}
@@ -2067,14 +2078,14 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (!other->mxConn) {
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You're trying to connect a bot: %s"), nick.c_str());
+			os << autosprintf(_("You're trying to connect a bot: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
 		return -1;
 	}
 
-	if (mS->mUserList.Nick2Hash(nick) == conn->mpUser->mNickHash) {
+	if (mS->mUserList.Nick2Hash(nick.Data(), nick.Size()) == conn->mpUser->mNickHash) {
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg)
 			mS->DCPublicHS(_("You're trying to connect to yourself."), conn);
 
@@ -2126,7 +2137,7 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (((conn->mpUser->mClass + (int)mS->mC.classdif_download) < other->mClass) || ((conn->mpUser->mClass < eUC_OPERATOR) && other->mHideShare)) { // check class difference and hidden share
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2135,7 +2146,7 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (mS->mC.filter_lan_requests && (conn->mpUser->mLan != other->mLan)) { // filter lan to wan and reverse
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user because one of you is in a LAN: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user because one of you is in a LAN: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2144,7 +2155,7 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if ((other->mxConn->mFeatures & eSF_CHATONLY) && (conn->mpUser->mClass < mS->mC.chatonly_bypass_class)) { // user is here only to chat
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user because he is in chat only mode: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user because he is in chat only mode: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2224,14 +2235,14 @@ int cDCProto::DC_ConnectToMe(cMessageDC *msg, cConnDC *conn)
 			return -2;
 	#endif
 
-	string &addr = msg->ChunkString(eCH_CM_IP);
+	cChunkView addr = msg->ChunkView(eCH_CM_IP);
 
 	if (!CheckIP(conn, addr)) {
 		if (conn->Log(3))
 			conn->LogStream() << "Fixed wrong IP in $ConnectToMe: " << addr << endl;
 
 		if (mS->mC.wrongip_message) {
-			os << autosprintf(_("Replacing wrong IP address specified in your connection request with real one: %s -> %s"), addr.c_str(), conn->mAddrIP.c_str());
+			os << autosprintf(_("Replacing wrong IP address specified in your connection request with real one: %s -> %s"), addr.AsString().c_str(), conn->mAddrIP.c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2252,7 +2263,7 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 	if (CheckProtoSyntax(conn, msg))
 		return -1;
 
-	const string &mynick = msg->ChunkString(eCH_RC_NICK);
+	const cChunkView mynick = msg->ChunkView(eCH_RC_NICK);
 
 	if (CheckUserNick(conn, mynick))
 		return -1;
@@ -2261,12 +2272,12 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 		return -1;
 
 	ostringstream os;
-	const string &nick = msg->ChunkString(eCH_RC_OTHER); // find other user
-	cUser *other = mS->mUserList.GetUserByNick(nick);
+	const cChunkView nick = msg->ChunkView(eCH_RC_OTHER); // find other user
+	cUser *other = mS->mUserList.GetUserByNick(nick.Data(), nick.Size());
 
 	if (!other || !other->mInList) {
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You're trying to connect to an offline user: %s"), nick.c_str());
+			os << autosprintf(_("You're trying to connect to an offline user: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2275,14 +2286,14 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (!other->mxConn) {
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You're trying to connect to a bot: %s"), nick.c_str());
+			os << autosprintf(_("You're trying to connect to a bot: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
 		return -2;
 	}
 
-	if (mS->mUserList.Nick2Hash(nick) == conn->mpUser->mNickHash) {
+	if (mS->mUserList.Nick2Hash(nick.Data(), nick.Size()) == conn->mpUser->mNickHash) {
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg)
 			mS->DCPublicHS(_("You're trying to connect to yourself."), conn);
 
@@ -2291,7 +2302,7 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (other->mPassive && !(other->mMyFlag & eMF_NAT)) { // passive request to passive user, allow if other user supports nat connection
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user, because he is also in passive mode: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user, because he is also in passive mode: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2300,7 +2311,7 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (conn->mpUser->mHideShare) { // when my share is hidden other users cant connect to me
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user while your share is hidden, because you are in passive mode: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user while your share is hidden, because you are in passive mode: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2352,7 +2363,7 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if (((conn->mpUser->mClass + (int)mS->mC.classdif_download) < other->mClass) || ((conn->mpUser->mClass < eUC_OPERATOR) && other->mHideShare)) { // check class difference and hidden share
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2361,7 +2372,7 @@ int cDCProto::DC_RevConnectToMe(cMessageDC *msg, cConnDC *conn)
 
 	if ((other->mxConn->mFeatures & eSF_CHATONLY) && (conn->mpUser->mClass < mS->mC.chatonly_bypass_class)) { // user is here only to chat
 		if (!mS->mC.hide_msg_badctm && !conn->mpUser->mHideCtmMsg) {
-			os << autosprintf(_("You can't download from this user because he is in chat only mode: %s"), nick.c_str());
+			os << autosprintf(_("You can't download from this user because he is in chat only mode: %s"), nick.AsString().c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 
@@ -2431,31 +2442,32 @@ int cDCProto::DC_Search(cMessageDC *msg, cConnDC *conn)
 			break;
 	}
 
-	string nick, saddr, addr;
+	cChunkView nick, addr; // views into the message, nothing is copied until the search is created
+	string saddr;
 
 	if (passive) { // verify sender
-		nick = msg->ChunkString(eCH_PS_NICK);
+		nick = msg->ChunkView(eCH_PS_NICK);
 
 		if (CheckUserNick(conn, nick))
 			return -1;
 
 		saddr.append("Hub:");
-		saddr.append(nick);
+		nick.AppendTo(saddr);
 	} else {
-		const string &port = msg->ChunkString(eCH_AS_PORT);
+		const cChunkView port = msg->ChunkView(eCH_AS_PORT);
 
-		if (port.empty() || (port.size() > 5))
+		if (port.Empty() || (port.Size() > 5))
 			return -1;
 
-		unsigned int iport = StringAsLL(port);
+		unsigned int iport = port.AsLL();
 
 		if (!mS->CheckPortNumber(iport))
 			return -1;
 
-		addr = msg->ChunkString(eCH_AS_IP);
+		addr = msg->ChunkView(eCH_AS_IP);
 
 		if (CheckIP(conn, addr))
-			saddr.append(addr);
+			addr.AppendTo(saddr);
 		else
 			saddr.append(conn->mAddrIP);
 
@@ -2558,44 +2570,47 @@ int cDCProto::DC_Search(cMessageDC *msg, cConnDC *conn)
 		return -4;
 	}
 
-	string lims, spat;
+	cChunkView lims, spat;
+	string fixlims; // copy of limits, made only when search type has to be changed
 
 	if (passive) {
-		lims = msg->ChunkString(eCH_PS_SEARCHLIMITS);
-		spat = msg->ChunkString(eCH_PS_SEARCHPATTERN);
+		lims = msg->ChunkView(eCH_PS_SEARCHLIMITS);
+		spat = msg->ChunkView(eCH_PS_SEARCHPATTERN);
 	} else {
-		lims = msg->ChunkString(eCH_AS_SEARCHLIMITS);
-		spat = msg->ChunkString(eCH_AS_SEARCHPATTERN);
+		lims = msg->ChunkView(eCH_AS_SEARCHLIMITS);
+		spat = msg->ChunkView(eCH_AS_SEARCHPATTERN);
 	}
 
-	size_t limlen = lims.size();
+	size_t limlen = lims.Size();
 
 	if (limlen < 8) // check limits length
 		return -1;
 
-	size_t patlen = spat.size();
+	size_t patlen = spat.Size();
 
 	if (!patlen) // check base search length
 		return -4;
 
-	bool tth = (lims.substr(limlen - 3) == "?9?");
+	bool tth = lims.EndsWith("?9?");
+	cChunkView root; // tth without prefix
 
 	if (tth) { // check tth searches
-		bool tthpref = true;
-
-		if ((patlen < 4) || (StrCompare(spat, 0, 4, "TTH:") != 0))
-			tthpref = false;
+		bool tthpref = spat.StartsWith("TTH:");
 
 		if ((patlen != 43) || !tthpref) { // change search type
-			lims[limlen - 2] = '1';
+			lims.AppendTo(fixlims);
+			fixlims[limlen - 2] = '1';
+			lims = fixlims;
 			tth = false;
 
 			if (tthpref)
-				spat = spat.substr(4);
+				spat = spat.Sub(4);
+		} else {
+			root = spat.Sub(4);
 		}
 	}
 
-	if (!tth && (conn->mpUser->mClass < eUC_OPERATOR) && (spat.size() < mS->mC.min_search_chars)) { // check search length if not operator, only if not tth
+	if (!tth && (conn->mpUser->mClass < eUC_OPERATOR) && (spat.Size() < mS->mC.min_search_chars)) { // check search length if not operator, only if not tth
 		os << autosprintf(ngettext("Minimum search length is %d character.", "Minimum search length is %d characters.", mS->mC.min_search_chars), mS->mC.min_search_chars);
 		mS->DCPublicHS(os.str(), conn);
 		return -1;
@@ -2613,12 +2628,12 @@ int cDCProto::DC_Search(cMessageDC *msg, cConnDC *conn)
 
 	if (passive) {
 		conn->mSRCounter = 0;
-	} else if (StrCompare(addr, 0, conn->mAddrIP.size(), conn->mAddrIP) != 0) {
+	} else if (!addr.StartsWith(conn->mAddrIP)) {
 		if (conn->Log(3))
 			conn->LogStream() << "Fixed wrong IP in $Search: " << addr << endl;
 
 		if (mS->mC.wrongip_message) {
-			os << autosprintf(_("Replacing wrong IP address specified in your search request with real one: %s -> %s"), addr.c_str(), conn->mAddrIP.c_str());
+			os << autosprintf(_("Replacing wrong IP address specified in your search request with real one: %s -> %s"), addr.AsString().c_str(), conn->mAddrIP.c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 	}
@@ -2630,8 +2645,8 @@ int cDCProto::DC_Search(cMessageDC *msg, cConnDC *conn)
 	else
 		Create_Search(search, saddr, lims, spat, true); // reserve for pipe
 
-	if (mS->mC.use_search_filter && tth && (StrCompare(lims, 3, 8, "?0?9?") == 0)) { // also create short version to send to modern clients, note: limits length is checked above
-		spat = spat.substr(4);
+	if (mS->mC.use_search_filter && tth && (lims.Sub(3) == "?0?9?")) { // also create short version to send to modern clients, note: limits length is checked above
+		spat = spat.Sub(4);
 
 		if (passive) // dont reserve for pipe, buffer is copied before sending
 			Create_SP(tths, spat, nick, true/*todo: false*/);
@@ -2651,7 +2666,10 @@ int cDCProto::DC_Search(cMessageDC *msg, cConnDC *conn)
 			some users dont support tth searches
 		*/
 
-		mS->SearchToAll(conn, search, tths, passive, tth);
+		if (tth)
+			mS->TTHSearchToAll(conn, search, tths, passive, root, saddr);
+		else
+			mS->SearchToAll(conn, search, tths, passive, false);
 	} else { // send it without filter, old search engine, note: short tth search command can not be used here
 		if (passive)
 			mS->mActiveUsers.SendToAll(search, mS->mC.delayed_search, true);
@@ -2697,26 +2715,26 @@ int cDCProto::DC_SA(cMessageDC *msg, cConnDC *conn)
 		return -2;
 	}
 
-	const string &tth = msg->ChunkString(eCH_SA_TTH);
+	const cChunkView tth = msg->ChunkView(eCH_SA_TTH);
 
-	if (tth.size() != 39) // check tth size, todo: be more strict and disconnect user with message
+	if (tth.Size() != 39) // check tth size, todo: be more strict and disconnect user with message
 		return -1;
 
-	const string &port = msg->ChunkString(eCH_SA_PORT);
+	const cChunkView port = msg->ChunkView(eCH_SA_PORT);
 
-	if (port.empty() || (port.size() > 5))
+	if (port.Empty() || (port.Size() > 5))
 		return -1;
 
-	unsigned int iport = StringAsLL(port);
+	unsigned int iport = port.AsLL();
 
 	if (!mS->CheckPortNumber(iport))
 		return -1;
 
 	string saddr;
-	const string &addr = msg->ChunkString(eCH_SA_IP);
+	const cChunkView addr = msg->ChunkView(eCH_SA_IP);
 
 	if (CheckIP(conn, addr))
-		saddr.append(addr);
+		addr.AppendTo(saddr);
 	else
 		saddr.append(conn->mAddrIP);
 
@@ -2825,19 +2843,19 @@ int cDCProto::DC_SA(cMessageDC *msg, cConnDC *conn)
 
 	conn->mpUser->mSearchNumber++; // set counter last of all
 
-	if (StrCompare(addr, 0, conn->mAddrIP.size(), conn->mAddrIP) != 0) {
+	if (!addr.StartsWith(conn->mAddrIP)) {
 		if (conn->Log(3))
 			conn->LogStream() << "Fixed wrong IP in $Search: " << addr << endl;
 
 		if (mS->mC.wrongip_message) {
-			os << autosprintf(_("Replacing wrong IP address specified in your search request with real one: %s -> %s"), addr.c_str(), conn->mAddrIP.c_str());
+			os << autosprintf(_("Replacing wrong IP address specified in your search request with real one: %s -> %s"), addr.AsString().c_str(), conn->mAddrIP.c_str());
 			mS->DCPublicHS(os.str(), conn);
 		}
 	}
 
 	string tths;
 	Create_SA(tths, tth, saddr, true/*todo: false*/); // dont reserve for pipe, buffer is copied before sending
-	mS->SearchToAll(conn, search, tths, false); // can send it only using filter
+	mS->TTHSearchToAll(conn, search, tths, false, tth, saddr); // can send it only using filter
 	return 0;
 }
 
@@ -2876,12 +2894,12 @@ int cDCProto::DC_SP(cMessageDC *msg, cConnDC *conn)
 		return -2;
 	}
 
-	const string &tth = msg->ChunkString(eCH_SP_TTH);
+	const cChunkView tth = msg->ChunkView(eCH_SP_TTH);
 
-	if (tth.size() != 39) // check tth size, todo: be more strict and disconnect user with message
+	if (tth.Size() != 39) // check tth size, todo: be more strict and disconnect user with message
 		return -1;
 
-	const string &nick = msg->ChunkString(eCH_SP_NICK);
+	const cChunkView nick = msg->ChunkView(eCH_SP_NICK);
 
 	if (CheckUserNick(conn, nick)) // verify sender
 		return -1;
@@ -2994,7 +3012,7 @@ int cDCProto::DC_SP(cMessageDC *msg, cConnDC *conn)
 	conn->mSRCounter = 0;
 	string tths;
 	Create_SP(tths, tth, nick, true/*todo: false*/); // dont reserve for pipe, buffer is copied before sending
-	mS->SearchToAll(conn, search, tths, true); // can send it only using filter
+	mS->TTHSearchToAll(conn, search, tths, true, tth, mEmpty); // can send it only using filter
 	return 0;
 }
 
@@ -3006,7 +3024,7 @@ int cDCProto::DC_SR(cMessageDC *msg, cConnDC *conn)
 	if (CheckProtoSyntax(conn, msg))
 		return -1;
 
-	const string &from = msg->ChunkString(eCH_SR_FROM);
+	const cChunkView from = msg->ChunkView(eCH_SR_FROM);
 
 	if (CheckUserNick(conn, from))
 		return -1;
@@ -3025,7 +3043,8 @@ int cDCProto::DC_SR(cMessageDC *msg, cConnDC *conn)
 		return -2;
 	}
 
-	cUser *other = mS->mUserList.GetUserByNick(msg->ChunkString(eCH_SR_TO)); // find other user
+	const cChunkView to = msg->ChunkView(eCH_SR_TO);
+	cUser *other = mS->mUserList.GetUserByNick(to.Data(), to.Size()); // find other user
 
 	if (!other || !other->mxConn || !other->mInList)
 		return -1; // silent filter
@@ -3043,6 +3062,9 @@ int cDCProto::DC_SR(cMessageDC *msg, cConnDC *conn)
 	sr.reserve(msg->mChunks[eCH_SR_TO].first/* - 1 + 1*/); // first use, reserve for pipe
 #endif
 	sr.assign(msg->mStr, 0, msg->mChunks[eCH_SR_TO].first - 1); // cut the end
+
+	if (mS->mC.tth_search_window) // results to merged passive searches
+		RouteMergedSR(sr, to);
 	other->mxConn->Send(sr, true, !mS->mC.delayed_search); // part of search, must be delayed too
 	return 0;
 }
@@ -3921,13 +3943,13 @@ bool cDCProto::CheckProtoLen(cConnDC *conn, cMessageDC *msg)
 	return true;
 }
 
-bool cDCProto::CheckUserNick(cConnDC *conn, const string &nick)
+bool cDCProto::CheckUserNick(cConnDC *conn, const cChunkView &nick)
 {
-	if (mS->mUserList.Nick2Hash(nick) == conn->mpUser->mNickHash)
+	if (mS->mUserList.Nick2Hash(nick.Data(), nick.Size()) == conn->mpUser->mNickHash)
 		return false;
 
 	ostringstream os;
-	os << autosprintf(_("Nick spoofing attempt detected from your client: %s"), nick.c_str());
+	os << autosprintf(_("Nick spoofing attempt detected from your client: %s"), nick.AsString().c_str());
 
 	if (conn->Log(1))
 		conn->LogStream() << os.str() << endl;
@@ -3958,10 +3980,59 @@ bool cDCProto::FindInSupports(const string &list, const string &flag)
 	return false;
 }
 
+bool cDCProto::SendZipped(cConnDC *conn, cSendSegment *seg, const size_t size)
+{
+	if (!seg)
+		return false;
+
+	conn->SendShared(seg, true, true); // already compressed, same data for every user until list changes
+	mS->mProtoSaved[0] += size - seg->mData.size(); // add difference to saved upload statistics
+	return true;
+}
+
+void cDCProto::RouteMergedSR(string &sr, const cChunkView &to)
+{
+	if (mS->mTTHSearches.empty())
+		return;
+
+	const size_t pos = sr.find("\x05TTH:");
+
+	if ((pos == string::npos) || (sr.size() < (pos + 5 + 39))) // not a file result
+		return;
+
+	string key;
+#ifdef USE_BUFFER_RESERVE
+	key.reserve(1 + 39);
+#endif
+	key.append(1, 'P');
+	key.append(sr, pos + 5, 39);
+	cServerDC::tTTHSearchMap::iterator it = mS->mTTHSearches.find(key);
+
+	if ((it == mS->mTTHSearches.end()) || it->second.mMerged.empty() || !(to == cChunkView(it->second.mNick))) // not an answer to merged search
+		return;
+
+	cUser *user;
+
+	for (vector<string>::iterator nick = it->second.mMerged.begin(); nick != it->second.mMerged.end(); ++nick) {
+		user = mS->mUserList.GetUserByNick(*nick);
+
+		if (!user || !user->mxConn || !user->mInList) // user has left
+			continue;
+
+		if (mS->mC.max_passive_sr && (user->mxConn->mSRCounter++ >= mS->mC.max_passive_sr)) // same limit as for his own results
+			continue;
+
+		user->mxConn->Send(sr, true, !mS->mC.delayed_search); // part of search, must be delayed too
+	}
+}
+
 int cDCProto::NickList(cConnDC *conn)
 {
 	//try {
 		string _str;
+		cSendSegment *zip = NULL; // compressed list snapshots for zlib users
+		size_t size = 0;
+		const bool zlib = (conn->mZLibFlag && !mS->mC.disable_zlib && !mS->mC.zlib_stream && !conn->mpZStream); // snapshots are separate blocks, they can not be put in a stream
 
 		/*
 		if (conn->GetLSFlag(eLS_LOGIN_DONE) != eLS_LOGIN_DONE)
@@ -3972,24 +4043,45 @@ int cDCProto::NickList(cConnDC *conn)
 			if (conn->Log(3))
 				conn->LogStream() << "Sending MyINFO list" << endl;
 
-			mS->mUserList.GetInfoList(_str, true); // reserve for pipe
-			conn->Send(_str, false); // pipe was already added by list generator
+			if (zlib)
+				zip = mS->mUserList.GetZippedInfoList(mS->mZLib, mS->mC.zlib_compress_level, mS->mC.zlib_min_len, size);
+
+			if (!SendZipped(conn, zip, size)) {
+				mS->mUserList.GetInfoList(_str, true); // reserve for pipe
+				conn->Send(_str, false); // pipe was already added by list generator
+			}
 
 		} else if (conn->mFeatures & eSF_NOGETINFO) {
 			if (conn->Log(3))
 				conn->LogStream() << "Sending MyINFO list" << endl;
 
-			mS->mUserList.GetNickList(_str, true); // reserve for pipe
-			conn->Send(_str, true);
-			mS->mUserList.GetInfoList(_str, true); // reserve for pipe
-			conn->Send(_str, false); // pipe was already added by list generator
+			if (zlib)
+				zip = mS->mUserList.GetZippedNickList(mS->mZLib, mS->mC.zlib_compress_level, mS->mC.zlib_min_len, size);
+
+			if (!SendZipped(conn, zip, size)) {
+				mS->mUserList.GetNickList(_str, true); // reserve for pipe
+				conn->Send(_str, true);
+			}
+
+			if (zlib)
+				zip = mS->mUserList.GetZippedInfoList(mS->mZLib, mS->mC.zlib_compress_level, mS->mC.zlib_min_len, size);
+
+			if (!SendZipped(conn, zip, size)) {
+				mS->mUserList.GetInfoList(_str, true); // reserve for pipe
+				conn->Send(_str, false); // pipe was already added by list generator
+			}
 
 		} else {
 			if (conn->Log(3))
 				conn->LogStream() << "Sending Nicklist" << endl;
 
-			mS->mUserList.GetNickList(_str, true); // reserve for pipe
-			conn->Send(_str, true);
+			if (zlib)
+				zip = mS->mUserList.GetZippedNickList(mS->mZLib, mS->mC.zlib_compress_level, mS->mC.zlib_min_len, size);
+
+			if (!SendZipped(conn, zip, size)) {
+				mS->mUserList.GetNickList(_str, true); // reserve for pipe
+				conn->Send(_str, true);
+			}
 		}
 
 		if (mS->mOpList.Size()) { // send $OpList
@@ -4004,8 +4096,13 @@ int cDCProto::NickList(cConnDC *conn)
 
 		if (mS->mC.send_user_ip && conn->mpUser && (conn->mFeatures & eSF_USERIP2)) { // send $UserIP
 			if (conn->mpUser->mClass >= mS->mC.user_ip_class) { // full list
-				mS->mUserList.GetIPList(_str, true); // reserve for pipe
-				conn->Send(_str, true);
+				if (zlib)
+					zip = mS->mUserList.GetZippedIPList(mS->mZLib, mS->mC.zlib_compress_level, mS->mC.zlib_min_len, size);
+
+				if (!SendZipped(conn, zip, size)) {
+					mS->mUserList.GetIPList(_str, true); // reserve for pipe
+					conn->Send(_str, true);
+				}
 
 			} else { // own ip only
 				mS->mP.Create_UserIP(_str, conn->mpUser->mNick, conn->AddrIP(), true); // reserve for pipe
@@ -4078,12 +4175,12 @@ int cDCProto::ParseForCommands(string &text, cConnDC *conn, int pm)
 	return 0;
 }
 
-bool cDCProto::CheckIP(cConnDC *conn, const string &ip)
+bool cDCProto::CheckIP(cConnDC *conn, const cChunkView &ip)
 {
-	if (StrCompare(ip, 0, conn->mAddrIP.size(), conn->mAddrIP) == 0)
+	if (ip.StartsWith(conn->mAddrIP))
 		return true;
 
-	if (conn->mRegInfo && conn->mRegInfo->mAlternateIP.size() && (StrCompare(ip, 0, conn->mRegInfo->mAlternateIP.size(), conn->mRegInfo->mAlternateIP) == 0))
+	if (conn->mRegInfo && conn->mRegInfo->mAlternateIP.size() && ip.StartsWith(conn->mRegInfo->mAlternateIP))
 		return true;
 
 	return false;
@@ -4460,54 +4557,54 @@ void cDCProto::Create_ForceMove(string &dest, const string &addr, const bool cle
 	dest.append(addr);
 }
 
-void cDCProto::Create_ConnectToMe(string &dest, const string &nick, const string &addr, const string &port, const string &extra, const bool pipe)
+void cDCProto::Create_ConnectToMe(string &dest, const cChunkView &nick, const cChunkView &addr, const string &port, const string &extra, const bool pipe)
 {
 	if (dest.size())
 		dest.clear();
 
 #ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (13 + nick.size() + 1 + addr.size() + 1 + port.size() + extra.size() + (pipe ? 1 : 0)))
-		dest.reserve(13 + nick.size() + 1 + addr.size() + 1 + port.size() + extra.size() + (pipe ? 1 : 0));
+	if (dest.capacity() < (13 + nick.Size() + 1 + addr.Size() + 1 + port.size() + extra.size() + (pipe ? 1 : 0)))
+		dest.reserve(13 + nick.Size() + 1 + addr.Size() + 1 + port.size() + extra.size() + (pipe ? 1 : 0));
 #endif
 
 	dest.append("$ConnectToMe ");
-	dest.append(nick);
+	nick.AppendTo(dest);
 	dest.append(1, ' ');
-	dest.append(addr);
+	addr.AppendTo(dest);
 	dest.append(1, ':');
 	dest.append(port);
 	dest.append(extra);
 }
 
-void cDCProto::Create_Search(string &dest, const string &addr, const string &lims, const string &spat, const bool pipe)
+void cDCProto::Create_Search(string &dest, const cChunkView &addr, const cChunkView &lims, const cChunkView &spat, const bool pipe)
 {
 	if (dest.size())
 		dest.clear();
 
 #ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (8 + addr.size() + 1 + lims.size() + spat.size() + (pipe ? 1 : 0)))
-		dest.reserve(8 + addr.size() + 1 + lims.size() + spat.size() + (pipe ? 1 : 0));
+	if (dest.capacity() < (8 + addr.Size() + 1 + lims.Size() + spat.Size() + (pipe ? 1 : 0)))
+		dest.reserve(8 + addr.Size() + 1 + lims.Size() + spat.Size() + (pipe ? 1 : 0));
 #endif
 
 	dest.append("$Search ");
-	dest.append(addr);
+	addr.AppendTo(dest);
 	dest.append(1, ' ');
-	dest.append(lims);
-	dest.append(spat);
+	lims.AppendTo(dest);
+	spat.AppendTo(dest);
 }
 
-void cDCProto::Create_Search(string &dest, const string &addr, const string &tth, const bool pas, const bool pipe)
+void cDCProto::Create_Search(string &dest, const cChunkView &addr, const cChunkView &tth, const bool pas, const bool pipe)
 {
 	if (dest.size())
 		dest.clear();
 
 #ifdef USE_BUFFER_RESERVE
 	if (pas) {
-		if (dest.capacity() < (8 + 4 + addr.size() + 13 + tth.size() + (pipe ? 1 : 0)))
-			dest.reserve(8 + 4 + addr.size() + 13 + tth.size() + (pipe ? 1 : 0));
+		if (dest.capacity() < (8 + 4 + addr.Size() + 13 + tth.Size() + (pipe ? 1 : 0)))
+			dest.reserve(8 + 4 + addr.Size() + 13 + tth.Size() + (pipe ? 1 : 0));
 	} else {
-		if (dest.capacity() < (8 + addr.size() + 13 + tth.size() + (pipe ? 1 : 0)))
-			dest.reserve(8 + addr.size() + 13 + tth.size() + (pipe ? 1 : 0));
+		if (dest.capacity() < (8 + addr.Size() + 13 + tth.Size() + (pipe ? 1 : 0)))
+			dest.reserve(8 + addr.Size() + 13 + tth.Size() + (pipe ? 1 : 0));
 	}
 #endif
 
@@ -4516,41 +4613,41 @@ void cDCProto::Create_Search(string &dest, const string &addr, const string &tth
 	if (pas)
 		dest.append("Hub:");
 
-	dest.append(addr);
+	addr.AppendTo(dest);
 	dest.append(" F?T?0?9?TTH:"); // note: taken from dc++ behaviour but nmdc specification says following: is_max_size is F if size_restricted is F
-	dest.append(tth);
+	tth.AppendTo(dest);
 }
 
-void cDCProto::Create_SA(string &dest, const string &tth, const string &addr, const bool pipe)
+void cDCProto::Create_SA(string &dest, const cChunkView &tth, const cChunkView &addr, const bool pipe)
 {
 	if (dest.size())
 		dest.clear();
 
 #ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (4 + tth.size() + 1 + addr.size() + (pipe ? 1 : 0)))
-		dest.reserve(4 + tth.size() + 1 + addr.size() + (pipe ? 1 : 0));
+	if (dest.capacity() < (4 + tth.Size() + 1 + addr.Size() + (pipe ? 1 : 0)))
+		dest.reserve(4 + tth.Size() + 1 + addr.Size() + (pipe ? 1 : 0));
 #endif
 
 	dest.append("$SA ");
-	dest.append(tth);
+	tth.AppendTo(dest);
 	dest.append(1, ' ');
-	dest.append(addr);
+	addr.AppendTo(dest);
 }
 
-void cDCProto::Create_SP(string &dest, const string &tth, const string &nick, const bool pipe)
+void cDCProto::Create_SP(string &dest, const cChunkView &tth, const cChunkView &nick, const bool pipe)
 {
 	if (dest.size())
 		dest.clear();
 
 #ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (4 + tth.size() + 1 + nick.size() + (pipe ? 1 : 0)))
-		dest.reserve(4 + tth.size() + 1 + nick.size() + (pipe ? 1 : 0));
+	if (dest.capacity() < (4 + tth.Size() + 1 + nick.Size() + (pipe ? 1 : 0)))
+		dest.reserve(4 + tth.Size() + 1 + nick.Size() + (pipe ? 1 : 0));
 #endif
 
 	dest.append("$SP ");
-	dest.append(tth);
+	tth.AppendTo(dest);
 	dest.append(1, ' ');
-	dest.append(nick);
+	nick.AppendTo(dest);
 }
 
 void cDCProto::Create_UserIP(string &dest, const string &list, const bool pipe)
@@ -36,6 +36,7 @@ namespace nVerliHub {
 
 	namespace nSocket {
 		class cConnDC;
+		class cSendSegment;
 		class cServerDC;
 	};
 
@@ -89,6 +90,22 @@ class cDCProto : public cProtocol
 	*/
 	int NickList(nSocket::cConnDC *);
 
+	/**
+	* Send compressed list snapshot to zlib user.
+	* @param conn User connection.
+	* @param seg Compressed list or NULL.
+	* @param size Uncompressed list size.
+	* @return False if there is no snapshot and list must be sent as usual.
+	*/
+	bool SendZipped(nSocket::cConnDC *conn, nSocket::cSendSegment *seg, const size_t size);
+
+	/**
+	* Copy passive search result to users whose search was merged into the one it answers.
+	* @param sr Result without target nick.
+	* @param to Target nick.
+	*/
+	void RouteMergedSR(string &sr, const cChunkView &to);
+
 	/*
 	* Check if the message is a command and pass it to the console.
 	* msg = The message.
@@ -230,11 +247,11 @@ protected:
 	static void Create_FailOver(string &dest, const string &addr, const bool pipe);
 	static void Create_ForceMove(string &dest, const string &addr, const bool clear, const bool pipe);
 	static void Create_HubTopic(string &dest, const string &topic, const bool pipe);
-	static void Create_ConnectToMe(string &dest, const string &nick, const string &addr, const string &port, const string &extra, const bool pipe);
-	static void Create_Search(string &dest, const string &addr, const string &lims, const string &spat, const bool pipe);
-	static void Create_Search(string &dest, const string &addr, const string &tth, const bool pas, const bool pipe);
-	static void Create_SA(string &dest, const string &tth, const string &addr, const bool pipe);
-	static void Create_SP(string &dest, const string &tth, const string &nick, const bool pipe);
+	static void Create_ConnectToMe(string &dest, const cChunkView &nick, const cChunkView &addr, const string &port, const string &extra, const bool pipe);
+	static void Create_Search(string &dest, const cChunkView &addr, const cChunkView &lims, const cChunkView &spat, const bool pipe);
+	static void Create_Search(string &dest, const cChunkView &addr, const cChunkView &tth, const bool pas, const bool pipe);
+	static void Create_SA(string &dest, const cChunkView &tth, const cChunkView &addr, const bool pipe);
+	static void Create_SP(string &dest, const cChunkView &tth, const cChunkView &nick, const bool pipe);
 	static void Create_UserIP(string &dest, const string &list, const bool pipe);
 	static void Create_UserIP(string &dest, const string &nick, const string &addr, const bool pipe);
 	static void Create_GetPass(string &dest, const bool pipe);
@@ -321,7 +338,7 @@ protected:
 	bool CheckUserRights(nSocket::cConnDC *conn, cMessageDC *msg, bool cond);
 	bool CheckProtoSyntax(nSocket::cConnDC *conn, cMessageDC *msg);
 	bool CheckProtoLen(nSocket::cConnDC *conn, cMessageDC *msg);
-	bool CheckUserNick(nSocket::cConnDC *conn, const string &nick);
+	bool CheckUserNick(nSocket::cConnDC *conn, const cChunkView &nick);
 	bool FindInSupports(const string &list, const string &flag);
 
 	/**
@@ -364,7 +381,7 @@ protected:
 
 	static void UnEscapeChars(const string &, string &, bool WithDCN = false);
 	static void UnEscapeChars(const string &, char *, unsigned int &len, bool WithDCN = false);
-	static bool CheckIP(nSocket::cConnDC *conn, const string &ip);
+	static bool CheckIP(nSocket::cConnDC *conn, const cChunkView &ip);
 
 	// Message kick regex
 	nUtils::cPCRE mKickChatPattern;
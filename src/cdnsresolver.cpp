@@ -0,0 +1,243 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "cdnsresolver.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
+#include <string.h>
+
+// seconds to keep addresses without name
+#define DNS_NEG_TTL 300
+
+namespace nVerliHub {
+	namespace nSocket {
+
+cDNSThread::cDNSThread(cDNSResolver *owner):
+	mOwner(owner)
+{}
+
+cDNSThread::~cDNSThread()
+{
+	Stop(true);
+}
+
+bool cDNSThread::HasSomethingToDo()
+{
+	return mOwner->Wait();
+}
+
+void cDNSThread::DoSomething()
+{
+	mOwner->Work();
+}
+
+cDNSResolver::cDNSResolver(unsigned int threads, cWakeUp *wake, tResolveFunc func):
+	mTTL(3600),
+	mNegTTL(DNS_NEG_TTL),
+	mHits(0),
+	mLookups(0),
+	mPending(0),
+	mFunc(func ? func : Resolve),
+	mWake(wake),
+	mFinished(0)
+{
+	pthread_mutex_init(&mMutex, NULL);
+	pthread_cond_init(&mCond, NULL);
+
+	if (!threads)
+		threads = 1;
+
+	cDNSThread *th;
+
+	for (unsigned int i = 0; i < threads; i++) {
+		th = new cDNSThread(this);
+
+		if (th->Start() == 0)
+			mThreads.push_back(th);
+		else
+			delete th;
+	}
+
+	if (mThreads.empty())
+		throw "Unable to start DNS threads";
+}
+
+cDNSResolver::~cDNSResolver()
+{
+	pthread_mutex_lock(&mMutex);
+	mQueue.clear();
+	pthread_cond_broadcast(&mCond);
+	pthread_mutex_unlock(&mMutex);
+
+	for (vector<cDNSThread*>::iterator it = mThreads.begin(); it != mThreads.end(); ++it)
+		delete (*it); // waits for the thread, lookup in progress may take a while
+
+	mThreads.clear();
+	pthread_cond_destroy(&mCond);
+	pthread_mutex_destroy(&mMutex);
+}
+
+bool cDNSResolver::Find(unsigned long ip, string &host, long now)
+{
+	tCache::iterator it = mCache.find(ip);
+
+	if ((it == mCache.end()) || it->second.mRunning || (it->second.mExpires <= now))
+		return false;
+
+	host = it->second.mHost;
+	mHits++;
+	return true;
+}
+
+void cDNSResolver::Request(unsigned long ip)
+{
+	sEntry &entry = mCache[ip];
+
+	if (entry.mRunning) // result will serve all waiting connections
+		return;
+
+	entry.mRunning = true;
+	mPending++;
+	mLookups++;
+	pthread_mutex_lock(&mMutex);
+	mQueue.push_back(ip);
+	pthread_cond_signal(&mCond);
+	pthread_mutex_unlock(&mMutex);
+}
+
+void cDNSResolver::Collect(vector<sResult> &done, long now)
+{
+	if (!mFinished)
+		return;
+
+	pthread_mutex_lock(&mMutex);
+	done.swap(mDone);
+	mDone.clear();
+	mFinished = 0;
+	pthread_mutex_unlock(&mMutex);
+
+	tCache::iterator entry;
+	unsigned int ttl;
+
+	for (vector<sResult>::iterator it = done.begin(); it != done.end(); ++it) {
+		entry = mCache.find(it->mIP);
+
+		if (entry == mCache.end()) // purged while running, should not happen
+			continue;
+
+		if (entry->second.mRunning) {
+			entry->second.mRunning = false;
+			mPending--;
+		}
+
+		ttl = (it->mHost.size() ? mTTL : mNegTTL);
+
+		if (!ttl) { // caching is disabled, result is only passed to waiting connections
+			mCache.erase(entry);
+			continue;
+		}
+
+		entry->second.mHost = it->mHost;
+		entry->second.mExpires = now + ttl;
+	}
+}
+
+void cDNSResolver::Purge(long now)
+{
+	for (tCache::iterator it = mCache.begin(); it != mCache.end();) {
+		if (!it->second.mRunning && (it->second.mExpires <= now))
+			mCache.erase(it++);
+		else
+			++it;
+	}
+}
+
+bool cDNSResolver::Wait()
+{
+	bool res;
+	pthread_mutex_lock(&mMutex);
+
+	if (mQueue.empty()) { // short timeout, so stop request is noticed soon
+		struct timeval now;
+		struct timespec until;
+		gettimeofday(&now, NULL);
+		until.tv_sec = now.tv_sec;
+		until.tv_nsec = (now.tv_usec * 1000) + 100000000;
+
+		if (until.tv_nsec >= 1000000000) {
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000;
+		}
+
+		pthread_cond_timedwait(&mCond, &mMutex, &until);
+	}
+
+	res = !mQueue.empty();
+	pthread_mutex_unlock(&mMutex);
+	return res;
+}
+
+void cDNSResolver::Work()
+{
+	sResult res;
+	pthread_mutex_lock(&mMutex);
+
+	if (mQueue.empty()) { // taken by another thread
+		pthread_mutex_unlock(&mMutex);
+		return;
+	}
+
+	res.mIP = mQueue.front();
+	mQueue.pop_front();
+	pthread_mutex_unlock(&mMutex);
+
+	if (!mFunc(res.mIP, res.mHost))
+		res.mHost.clear();
+
+	pthread_mutex_lock(&mMutex);
+	mDone.push_back(res);
+	mFinished = mDone.size();
+	pthread_mutex_unlock(&mMutex);
+
+	if (mWake)
+		mWake->Wake();
+}
+
+bool cDNSResolver::Resolve(unsigned long ip, string &host)
+{
+	struct sockaddr_in addr;
+	char name[NI_MAXHOST];
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(ip);
+
+	if (getnameinfo((struct sockaddr*)&addr, sizeof(addr), name, sizeof(name), NULL, 0, NI_NAMEREQD) != 0)
+		return false;
+
+	host = name;
+	return true;
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
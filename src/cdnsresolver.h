@@ -0,0 +1,199 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCDNSRESOLVER_H
+#define NSOCKETCDNSRESOLVER_H
+
+#include "cthread.h"
+#include "cwakeup.h"
+#include <pthread.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+using std::string;
+using std::vector;
+using std::deque;
+using std::map;
+
+// number of worker threads started by server
+#define DNS_THREADS 4
+
+namespace nVerliHub {
+	namespace nSocket {
+		class cDNSResolver;
+
+/// Worker thread of DNS resolver.
+class cDNSThread : public nThread::cThread
+{
+public:
+	cDNSThread(cDNSResolver *owner);
+	virtual ~cDNSThread();
+
+	/// Wait a while for a request.
+	virtual bool HasSomethingToDo();
+
+	/// Resolve one request.
+	virtual void DoSomething();
+
+private:
+	cDNSResolver *mOwner;
+};
+
+/**
+* Reverse DNS resolver that does not block main loop.
+*
+* Requests are resolved by a small pool of threads with getnameinfo, results are kept in a cache keyed by address for limited time,
+* failed lookups are cached too, but for shorter time. Threads wake up main loop when they finish a request.
+* Cache and request methods are called from main thread only.
+*/
+class cDNSResolver
+{
+public:
+	/**
+	* Function that resolves an address, it is called from worker threads.
+	* @param ip Numeric address, see cBanList::Ip2Num().
+	* @param host Set to host name.
+	* @return False if address has no name.
+	*/
+	typedef bool (*tResolveFunc)(unsigned long ip, string &host);
+
+	/// Finished lookup.
+	struct sResult
+	{
+		unsigned long mIP;
+		string mHost;
+	};
+
+	/**
+	* @param threads Number of worker threads.
+	* @param wake Woken up when a lookup finishes, may be NULL.
+	* @param func Resolving function, NULL means Resolve().
+	*/
+	cDNSResolver(unsigned int threads, cWakeUp *wake, tResolveFunc func = NULL);
+	~cDNSResolver();
+
+	/**
+	* Look for address in cache.
+	* @param ip Numeric address, see cBanList::Ip2Num().
+	* @param host Set to cached host name, empty when address has no name.
+	* @param now Current time in seconds.
+	* @return True if cached result is valid.
+	*/
+	bool Find(unsigned long ip, string &host, long now);
+
+	/**
+	* Queue a lookup unless one is already running for the same address.
+	* @param ip Numeric address, see cBanList::Ip2Num().
+	*/
+	void Request(unsigned long ip);
+
+	/**
+	* Store finished lookups in cache and return them.
+	* Waiting connections must be served from returned results, a result with zero time to live is not cached at all.
+	* @param done Filled with finished lookups.
+	* @param now Current time in seconds.
+	*/
+	void Collect(vector<sResult> &done, long now);
+
+	/// Remove expired entries from cache.
+	void Purge(long now);
+
+	/// Return true if there may be finished lookups to collect.
+	bool HasResults() const
+	{
+		return mFinished != 0;
+	}
+
+	/**
+	* Resolve an address with getnameinfo, blocks until the answer comes.
+	* @param ip Numeric address, see cBanList::Ip2Num().
+	* @param host Set to host name.
+	* @return False if address has no name.
+	*/
+	static bool Resolve(unsigned long ip, string &host);
+
+	/// Seconds to keep resolved names, zero disables caching.
+	unsigned int mTTL;
+
+	/// Seconds to keep addresses without name.
+	unsigned int mNegTTL;
+
+	/// Number of lookups answered from cache.
+	unsigned long mHits;
+
+	/// Number of lookups passed to threads.
+	unsigned long mLookups;
+
+	/// Number of cached addresses.
+	size_t Size() const
+	{
+		return mCache.size();
+	}
+
+	/// Number of running lookups.
+	size_t Pending() const
+	{
+		return mPending;
+	}
+
+private:
+	friend class cDNSThread;
+
+	/// Wait for a request, called from worker thread.
+	bool Wait();
+
+	/// Resolve a queued request, called from worker thread.
+	void Work();
+
+	struct sEntry
+	{
+		string mHost; // empty when address has no name
+		long mExpires;
+		bool mRunning; // lookup was passed to threads
+
+		sEntry():
+			mExpires(0),
+			mRunning(false)
+		{}
+	};
+
+	typedef map<unsigned long, sEntry> tCache;
+	tCache mCache;
+	size_t mPending;
+
+	tResolveFunc mFunc;
+	cWakeUp *mWake;
+	vector<cDNSThread*> mThreads;
+
+	// shared with worker threads
+	pthread_mutex_t mMutex;
+	pthread_cond_t mCond;
+	deque<unsigned long> mQueue;
+	vector<sResult> mDone;
+	std::atomic<unsigned int> mFinished; // number of results in mDone, checked without lock
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
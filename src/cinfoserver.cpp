@@ -23,6 +23,7 @@
 #include "cserverdc.h"
 #include "casyncconn.h"
 #include "cbanlist.h"
+#include "cmessagedc.h"
 
 #if defined HAVE_LINUX
 	#include <unistd.h>
@@ -237,12 +238,15 @@ void cInfoServer::ProtocolInfo(ostream &os)
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Upload saved with zLib: %s / %d / %s / %s"), convertByte(mServer->mProtoSaved[0]).c_str(), mServer->mC.zlib_compress_level, convertByte(mServer->mZLib->GetInBufLen()).c_str(), convertByte(mServer->mZLib->GetOutBufLen()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("Upload saved with TTHS: %s"), convertByte(mServer->mProtoSaved[1]).c_str()) << "\r\n";
+	os << " [*] " << autosprintf(_("Upload saved with merged TTH searches: %s / %d"), convertByte(mServer->mProtoSaved[2]).c_str(), mServer->mC.tth_search_window) << "\r\n";
+	os << " [*] " << autosprintf(_("Shared zLib broadcasts: %lu compressed / %lu reused"), mServer->mZipCacheMisses, mServer->mZipCacheHits) << "\r\n";
 }
 
 void cInfoServer::BufferInfo(ostream &os)
 {
 	unsigned __int64 total_buf_size = 0, total_buf_cap = 0, total_flush_size = 0, total_flush_cap = 0;
 	unsigned int total_bufs = 0;
+	unsigned long total_segs = 0;
 	cAsyncConn *conn;
 
 	for (cUserCollection::iterator it = mServer->mUserList.begin(); it != mServer->mUserList.end(); ++it) {
@@ -251,6 +255,7 @@ void cInfoServer::BufferInfo(ostream &os)
 		if (conn && conn->ok) {
 			total_buf_size += conn->GetBufferSize();
 			total_buf_cap += conn->GetBufferCapacity();
+			total_segs += conn->GetBufferSegments();
 			total_flush_size += conn->GetFlushSize();
 			total_flush_cap += conn->GetFlushCapacity();
 			total_bufs++;
@@ -262,35 +267,49 @@ void cInfoServer::BufferInfo(ostream &os)
 	os << " [*] " << autosprintf(_("Socket counter: %lu"), cAsyncConn::sSocketCounter) << "\r\n";
 	os << " [*] " << autosprintf(_("Connection list size: %d"), mServer->GetConnListSize()) << "\r\n";
 	os << " [*] " << autosprintf(_("Connection chooser list size: %d"), mServer->GetConnChooserSize()) << "\r\n";
+
+	if (mServer->GetAcceptThreads()) {
+		unsigned long accepted, dropped;
+		mServer->GetAcceptCounts(accepted, dropped);
+		os << " [*] " << autosprintf(_("Accept threads: %u / %lu accepted / %lu dropped"), mServer->GetAcceptThreads(), accepted, dropped) << "\r\n";
+	}
+
+	if (mServer->mResolver)
+		os << " [*] " << autosprintf(_("DNS cache: %d hosts / %lu hits / %lu lookups / %d running"), (int)mServer->mResolver->Size(), mServer->mResolver->mHits, mServer->mResolver->mLookups, (int)mServer->mResolver->Pending()) << "\r\n";
+
+#if USE_IO_URING
+	if (mServer->mIOUring)
+		os << " [*] " << autosprintf(_("io_uring calls: %lu / %lu receives / %lu sends"), mServer->mIOUring->mEnters, mServer->mIOUring->mRecvs, mServer->mIOUring->mSends) << "\r\n";
+#endif
+
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("User upload buffers: %d / %s / %s"), total_bufs, convertByte(total_buf_size).c_str(), convertByte(total_buf_cap).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("User upload caches: %d / %s / %s"), total_bufs, convertByte(total_flush_size).c_str(), convertByte(total_flush_cap).c_str()) << "\r\n";
+	os << " [*] " << autosprintf(_("Upload segments: %lu / %lu queued / %lu reused"), cSendSegment::sCount, total_segs, cSendSegment::sReused) << "\r\n";
+	os << " [*] " << autosprintf(_("Upload segment pool: %d / %s"), (int)cSendSegment::PoolSize(), convertByte(cSendSegment::PoolCapacity()).c_str()) << "\r\n";
+	os << " [*] " << autosprintf(_("Queued messages: %lu control / %lu chat / %lu info / %lu search"), cSendQueue::sQueued[eTC_CONTROL], cSendQueue::sQueued[eTC_CHAT], cSendQueue::sQueued[eTC_INFO], cSendQueue::sQueued[eTC_SEARCH]) << "\r\n";
+	os << " [*] " << autosprintf(_("Dropped searches: %lu / %s"), cSendQueue::sDropped[eTC_SEARCH], convertByte(cSendQueue::sDroppedBytes[eTC_SEARCH]).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("User list size: %d / %d"), mServer->mUserList.Size(), mServer->mUserList.Capacity()) << "\r\n";
-	os << " [*] " << autosprintf(_("User list upload cache: %s / %s"), convertByte(mServer->mUserList.GetCacheSize()).c_str(), convertByte(mServer->mUserList.GetCacheCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("User list nick list: %s / %s"), convertByte(mServer->mUserList.GetNickListSize()).c_str(), convertByte(mServer->mUserList.GetNickListCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("User list MyINFO list: %s / %s"), convertByte(mServer->mUserList.GetInfoListSize()).c_str(), convertByte(mServer->mUserList.GetInfoListCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("User list IP list: %s / %s"), convertByte(mServer->mUserList.GetIPListSize()).c_str(), convertByte(mServer->mUserList.GetIPListCapacity()).c_str()) << "\r\n";
+	os << " [*] " << autosprintf(_("User list rebuilds: %lu full / %lu compacted"), mServer->mUserList.GetListRemakes(), mServer->mUserList.GetListCompacts()) << "\r\n";
+	os << " [*] " << autosprintf(_("User list compressions: %lu"), mServer->mUserList.GetListZips()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Active user list size: %d / %d"), mServer->mActiveUsers.Size(), mServer->mActiveUsers.Capacity()) << "\r\n";
-	os << " [*] " << autosprintf(_("Active user list upload cache: %s / %s"), convertByte(mServer->mActiveUsers.GetCacheSize()).c_str(), convertByte(mServer->mActiveUsers.GetCacheCapacity()).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Passive user list size: %d / %d"), mServer->mPassiveUsers.Size(), mServer->mPassiveUsers.Capacity()) << "\r\n";
-	os << " [*] " << autosprintf(_("Passive user list upload cache: %s / %s"), convertByte(mServer->mPassiveUsers.GetCacheSize()).c_str(), convertByte(mServer->mPassiveUsers.GetCacheCapacity()).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Chat user list size: %d / %d"), mServer->mChatUsers.Size(), mServer->mChatUsers.Capacity()) << "\r\n";
-	os << " [*] " << autosprintf(_("Chat user list upload cache: %s / %s"), convertByte(mServer->mChatUsers.GetCacheSize()).c_str(), convertByte(mServer->mChatUsers.GetCacheCapacity()).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Operator list size: %d / %d"), mServer->mOpList.Size(), mServer->mOpList.Capacity()) << "\r\n";
-	//os << " [*] " << autosprintf(_("Operator list upload cache: %s / %s"), convertByte(mServer->mOpList.GetCacheSize()).c_str(), convertByte(mServer->mOpList.GetCacheCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("Operator list nick list: %s / %s"), convertByte(mServer->mOpList.GetNickListSize()).c_str(), convertByte(mServer->mOpList.GetNickListCapacity()).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Operator chat list size: %d / %d"), mServer->mOpchatList.Size(), mServer->mOpchatList.Capacity()) << "\r\n";
-	os << " [*] " << autosprintf(_("Operator chat list upload cache: %s / %s"), convertByte(mServer->mOpchatList.GetCacheSize()).c_str(), convertByte(mServer->mOpchatList.GetCacheCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("Operator chat list nick list: %s / %s"), convertByte(mServer->mOpchatList.GetNickListSize()).c_str(), convertByte(mServer->mOpchatList.GetNickListCapacity()).c_str()) << "\r\n";
 	os << "\r\n";
 	os << " [*] " << autosprintf(_("Bot list size: %d / %d"), mServer->mRobotList.Size(), mServer->mRobotList.Capacity()) << "\r\n";
-	//os << " [*] " << autosprintf(_("Bot list upload cache: %s / %s"), convertByte(mServer->mRobotList.GetCacheSize()).c_str(), convertByte(mServer->mRobotList.GetCacheCapacity()).c_str()) << "\r\n";
 	os << " [*] " << autosprintf(_("Bot list nick list: %s / %s"), convertByte(mServer->mRobotList.GetNickListSize()).c_str(), convertByte(mServer->mRobotList.GetNickListCapacity()).c_str()) << "\r\n";
 }
 
@@ -389,6 +408,9 @@ void cInfoServer::SystemInfo(ostream &os)
 
 		os << " [*] " << autosprintf(_("Virtual RAM usage: %s"), convertByte(size_vm * 1024).c_str()) << "\r\n";
 		os << " [*] " << autosprintf(_("Resident RAM usage: %s"), convertByte(size_res * 1024).c_str()) << "\r\n\r\n";
+		os << " [*] " << autosprintf(_("Connection objects: %lu / %lu peak / %lu reused / %lu pooled"), tObjPool<cConnDC>::sCount, tObjPool<cConnDC>::sPeak, tObjPool<cConnDC>::sReused, tObjPool<cConnDC>::sPooled) << "\r\n";
+		os << " [*] " << autosprintf(_("User objects: %lu / %lu peak / %lu reused / %lu pooled"), tObjPool<cUser>::sCount, tObjPool<cUser>::sPeak, tObjPool<cUser>::sReused, tObjPool<cUser>::sPooled) << "\r\n";
+		os << " [*] " << autosprintf(_("Parser objects: %lu / %lu peak / %lu reused / %lu pooled"), tObjPool<cMessageDC>::sCount, tObjPool<cMessageDC>::sPeak, tObjPool<cMessageDC>::sReused, tObjPool<cMessageDC>::sPooled) << "\r\n\r\n";
 
 		os << " [*] " << autosprintf(_("CPU cores: %d"), num_cpu) << "\r\n";
 		os << " [*] " << autosprintf(_("CPU usage: %.2f%%"), perc_cpu) << "\r\n";
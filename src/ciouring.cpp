@@ -0,0 +1,560 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "ciouring.h"
+
+#if USE_IO_URING
+
+#include "casyncconn.h"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
+// number of provided receive buffers, must be power of two
+#define IOURING_BUF_NUM 1024
+
+// size of single receive buffer
+#define IOURING_BUF_SIZE 4096
+
+// buffer group used for receiving
+#define IOURING_BUF_GROUP 0
+
+// user data of the test request, values up to this one are not requests of connections
+#define IOURING_PROBE 1
+
+// user data of a request is its connection state with one of these bits set for sending
+#define IOURING_SEND 1
+#define IOURING_POLL 2
+
+namespace nVerliHub {
+	namespace nSocket {
+
+cIOUring::cIOUring():
+	mEnters(0),
+	mRecvs(0),
+	mSends(0),
+	mFD(-1),
+	mSQRing(MAP_FAILED),
+	mSQRingSize(0),
+	mSQEs((struct io_uring_sqe*)MAP_FAILED),
+	mSQEsSize(0),
+	mSQHead(NULL),
+	mSQTail(NULL),
+	mSQMask(NULL),
+	mSQArray(NULL),
+	mCQHead(NULL),
+	mCQTail(NULL),
+	mCQMask(NULL),
+	mCQEs(NULL),
+	mSQEntries(0),
+	mSQLocalTail(0),
+	mToSubmit(0),
+	mBufRing((struct io_uring_buf*)MAP_FAILED),
+	mBufRingSize(0),
+	mBufs(NULL)
+{}
+
+cIOUring::~cIOUring()
+{
+	if (mFD >= 0)
+		::close(mFD); // kernel cancels all requests
+
+	if (mSQEs != MAP_FAILED)
+		munmap(mSQEs, mSQEsSize);
+
+	if (mSQRing != MAP_FAILED)
+		munmap(mSQRing, mSQRingSize);
+
+	if (mBufRing != MAP_FAILED)
+		munmap(mBufRing, mBufRingSize);
+
+	if (mBufs)
+		delete [] mBufs;
+}
+
+bool cIOUring::Init(unsigned int entries)
+{
+	if (mFD >= 0)
+		return true;
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	mFD = syscall(__NR_io_uring_setup, entries, &params);
+
+	if (mFD < 0)
+		return false;
+
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP))
+		return false;
+
+	mSQRingSize = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+	size_t cq_size = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+
+	if (cq_size > mSQRingSize) // both rings share one mapping
+		mSQRingSize = cq_size;
+
+	mSQRing = mmap(NULL, mSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQ_RING);
+
+	if (mSQRing == MAP_FAILED)
+		return false;
+
+	mSQEsSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	mSQEs = (struct io_uring_sqe*)mmap(NULL, mSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQES);
+
+	if (mSQEs == MAP_FAILED)
+		return false;
+
+	char *ring = (char*)mSQRing;
+	mSQHead = (unsigned*)(ring + params.sq_off.head);
+	mSQTail = (unsigned*)(ring + params.sq_off.tail);
+	mSQMask = (unsigned*)(ring + params.sq_off.ring_mask);
+	mSQArray = (unsigned*)(ring + params.sq_off.array);
+	mCQHead = (unsigned*)(ring + params.cq_off.head);
+	mCQTail = (unsigned*)(ring + params.cq_off.tail);
+	mCQMask = (unsigned*)(ring + params.cq_off.ring_mask);
+	mCQEs = (struct io_uring_cqe*)(ring + params.cq_off.cqes);
+	mSQEntries = params.sq_entries;
+	mSQLocalTail = *mSQTail;
+
+	mBufRingSize = IOURING_BUF_NUM * sizeof(struct io_uring_buf);
+	mBufRing = (struct io_uring_buf*)mmap(NULL, mBufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (mBufRing == MAP_FAILED)
+		return false;
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (unsigned long)mBufRing;
+	reg.ring_entries = IOURING_BUF_NUM;
+	reg.bgid = IOURING_BUF_GROUP;
+
+	if (syscall(__NR_io_uring_register, mFD, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) // requires linux 5.19
+		return false;
+
+	mBufs = new char[IOURING_BUF_NUM * IOURING_BUF_SIZE];
+
+	for (unsigned int id = 0; id < IOURING_BUF_NUM; ++id)
+		PutBuffer(id);
+
+	return Probe();
+}
+
+bool cIOUring::Notify(int fd)
+{
+	if (fd < 0)
+		return false;
+
+	return (syscall(__NR_io_uring_register, mFD, IORING_REGISTER_EVENTFD, &fd, 1) == 0);
+}
+
+bool cIOUring::Probe()
+{
+	int pair[2];
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+		return false;
+
+	bool res = false;
+	struct io_uring_sqe *sqe = GetSQE();
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = pair[0];
+	sqe->ioprio = IORING_RECV_MULTISHOT; // requires linux 6.0
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = IOURING_BUF_GROUP;
+	sqe->user_data = IOURING_PROBE;
+
+	if ((::write(pair[1], "|", 1) == 1) && (Enter(mToSubmit, IORING_ENTER_GETEVENTS, 1) >= 0)) {
+		unsigned head = *mCQHead;
+
+		if (head != __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE)) {
+			const struct io_uring_cqe *cqe = &mCQEs[head & *mCQMask];
+			res = ((cqe->res == 1) && (cqe->flags & IORING_CQE_F_MORE));
+
+			if (cqe->flags & IORING_CQE_F_BUFFER)
+				PutBuffer(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+			__atomic_store_n(mCQHead, head + 1, __ATOMIC_RELEASE);
+		}
+	}
+
+	sqe = GetSQE(); // stop the test request
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = IOURING_PROBE;
+	Enter(mToSubmit, IORING_ENTER_GETEVENTS, 1);
+	__atomic_store_n(mCQHead, __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+	::close(pair[0]);
+	::close(pair[1]);
+	return res;
+}
+
+int cIOUring::Enter(unsigned int submit, unsigned int flags, unsigned int wait)
+{
+	__atomic_store_n(mSQTail, mSQLocalTail, __ATOMIC_RELEASE);
+	int res = syscall(__NR_io_uring_enter, mFD, submit, wait, flags, NULL, 0);
+	mEnters++;
+
+	if (res > 0)
+		mToSubmit -= ((unsigned int)res < mToSubmit) ? res : mToSubmit;
+
+	return res;
+}
+
+bool cIOUring::Reserve(unsigned int count)
+{
+	if ((mSQLocalTail - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE) + count) <= mSQEntries)
+		return true;
+
+	Enter(mToSubmit, 0, 0); // queue is full, submit what we have
+	return ((mSQLocalTail - __atomic_load_n(mSQHead, __ATOMIC_ACQUIRE) + count) <= mSQEntries);
+}
+
+struct io_uring_sqe* cIOUring::GetSQE()
+{
+	if (!Reserve(1))
+		return NULL;
+
+	unsigned idx = mSQLocalTail & *mSQMask;
+	struct io_uring_sqe *sqe = &mSQEs[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	mSQArray[idx] = idx;
+	mSQLocalTail++;
+	mToSubmit++;
+	return sqe;
+}
+
+void cIOUring::PutBuffer(unsigned int id)
+{
+	/*
+		ring tail overlays reserved field of the first entry
+		note: bufs member of io_uring_buf_ring has wrong offset when compiled as c++ with some kernel headers, so ring is indexed directly
+	*/
+	unsigned short tail = mBufRing[0].resv;
+	struct io_uring_buf *buf = &mBufRing[tail & (IOURING_BUF_NUM - 1)];
+	buf->addr = (unsigned long)(mBufs + (id * IOURING_BUF_SIZE));
+	buf->len = IOURING_BUF_SIZE;
+	buf->bid = id;
+	__atomic_store_n(&mBufRing[0].resv, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+void cIOUring::Add(cAsyncConn *conn)
+{
+	if (!conn || conn->mpIOUring)
+		return;
+
+	sIOUringConn *state = new sIOUringConn;
+	memset(state, 0, sizeof(*state));
+	state->mConn = conn;
+	state->mInput = true;
+	conn->mpIOUring = state;
+	ArmRecv(state);
+}
+
+bool cIOUring::Del(cAsyncConn *conn)
+{
+	if (!conn || !conn->mpIOUring)
+		return true;
+
+	sIOUringConn *state = conn->mpIOUring;
+	bool res = true;
+
+	if (!Reserve((state->mRecv ? 1 : 0) + (state->mSend ? 2 : 0))) { // running requests keep the socket open, end them by shutdown when they cant be cancelled
+		::shutdown((tSocket)(*conn), SHUT_RDWR);
+		res = false;
+
+	} else {
+		if (state->mRecv)
+			Cancel((unsigned long)state);
+
+		if (state->mSend) { // linked poll first, otherwise send is started when it gets cancelled
+			Cancel((unsigned long)state | IOURING_POLL);
+			Cancel((unsigned long)state | IOURING_SEND);
+		}
+	}
+
+	if (state->mQueued)
+		mSendList[state->mSendPos] = NULL;
+
+	if (state->mReady)
+		mReady[state->mReadyPos] = NULL;
+
+	if (mToSubmit)
+		Enter(mToSubmit, 0, 0);
+
+	conn->mpIOUring = NULL;
+	state->mConn = NULL;
+
+	if (!state->mRecv && !state->mSend) // otherwise deleted when last request finishes
+		delete state;
+
+	return res;
+}
+
+void cIOUring::Input(cAsyncConn *conn, bool on)
+{
+	sIOUringConn *state;
+
+	if (!conn || !(state = conn->mpIOUring) || (state->mInput == on))
+		return;
+
+	state->mInput = on;
+
+	if (on) {
+		if (!state->mRecv && !state->mError)
+			ArmRecv(state);
+
+		if (state->mRead || state->mError) // data received before input was blocked
+			MarkReady(state);
+
+	} else if (state->mRecv) { // rearmed on completion if input gets enabled again
+		Cancel((unsigned long)state);
+	}
+}
+
+void cIOUring::Ready(cAsyncConn *conn)
+{
+	if (conn && conn->mpIOUring)
+		MarkReady(conn->mpIOUring);
+}
+
+void cIOUring::Send(cAsyncConn *conn)
+{
+	sIOUringConn *state;
+
+	if (!conn || !(state = conn->mpIOUring) || state->mQueued)
+		return;
+
+	state->mQueued = true;
+	state->mSendPos = mSendList.size();
+	mSendList.push_back(state);
+}
+
+void cIOUring::ArmRecv(sIOUringConn *state)
+{
+	struct io_uring_sqe *sqe = GetSQE();
+
+	if (!sqe) { // try again on next input change
+		state->mInput = false;
+		return;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = (tSocket)(*state->mConn);
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = IOURING_BUF_GROUP;
+	sqe->user_data = (unsigned long)state;
+	state->mRecv = true;
+}
+
+bool cIOUring::Cancel(unsigned long data)
+{
+	struct io_uring_sqe *sqe = GetSQE();
+
+	if (!sqe)
+		return false;
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = data;
+	return true;
+}
+
+bool cIOUring::StartSend(sIOUringConn *state)
+{
+	cSendQueue &queue = state->mConn->mBufSend;
+
+	if (queue.Empty())
+		return true;
+
+	if (!Reserve(state->mWait ? 2 : 1)) // linked requests must be queued together, queue must not be submitted between them
+		return false;
+
+	struct io_uring_sqe *sqe;
+
+	if (state->mWait) { // socket was full, send only after it becomes writable
+		sqe = GetSQE();
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = (tSocket)(*state->mConn);
+		sqe->poll32_events = POLLOUT;
+		sqe->flags = IOSQE_IO_LINK;
+		sqe->user_data = ((unsigned long)state | IOURING_POLL);
+	}
+
+	sIOUringSend &op = state->mSendOp;
+	op.mCount = queue.Gather(op.mIOV, op.mSegs, SEND_QUEUE_IOV);
+	op.mLen = 0;
+	queue.Lock(op.mCount); // dont let output shedding remove data that kernel is sending
+
+	for (size_t pos = 0; pos < op.mCount; ++pos) {
+		op.mSegs[pos]->Ref(); // data must live until kernel is done with it
+		op.mLen += op.mIOV[pos].iov_len;
+	}
+
+	memset(&op.mMsg, 0, sizeof(op.mMsg));
+	op.mMsg.msg_iov = op.mIOV;
+	op.mMsg.msg_iovlen = op.mCount;
+	sqe = GetSQE();
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = (tSocket)(*state->mConn);
+	sqe->addr = (unsigned long)&op.mMsg;
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = ((unsigned long)state | IOURING_SEND);
+	state->mSend = true;
+	return true;
+}
+
+void cIOUring::MarkReady(sIOUringConn *state)
+{
+	if (state->mReady)
+		return;
+
+	state->mReady = true;
+	state->mReadyPos = mReady.size();
+	mReady.push_back(state);
+}
+
+void cIOUring::OnRecv(sIOUringConn *state, const struct io_uring_cqe *cqe)
+{
+	const bool alive = state->mConn;
+	const int res = cqe->res;
+
+	if (cqe->flags & IORING_CQE_F_BUFFER) {
+		const unsigned int id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+		if (alive && (res > 0)) {
+			state->mConn->PutInput(mBufs + (id * IOURING_BUF_SIZE), res);
+			state->mRead += res;
+			mRecvs++;
+
+			if (state->mInput)
+				MarkReady(state);
+		}
+
+		PutBuffer(id);
+	}
+
+	if (alive && (res <= 0) && (res != -ENOBUFS) && (res != -ECANCELED)) { // closed by other side or failed
+		state->mError = (res ? -res : -1);
+		MarkReady(state);
+	}
+
+	if (!(cqe->flags & IORING_CQE_F_MORE)) { // request is finished
+		state->mRecv = false;
+
+		if (!alive) {
+			if (!state->mSend)
+				delete state;
+
+		} else if (state->mInput && !state->mError) { // stopped because buffers ran out or input was enabled again
+			ArmRecv(state);
+		}
+	}
+}
+
+void cIOUring::OnSend(sIOUringConn *state, int res)
+{
+	sIOUringSend &op = state->mSendOp;
+
+	for (size_t pos = 0; pos < op.mCount; ++pos)
+		op.mSegs[pos]->UnRef();
+
+	state->mSend = false;
+
+	if (!state->mConn) { // connection is gone
+		if (!state->mRecv)
+			delete state;
+
+		return;
+	}
+
+	state->mConn->mBufSend.Lock(0);
+	state->mWait = ((res == -EAGAIN) || ((res >= 0) && ((size_t)res < op.mLen)));
+	mSends++;
+	state->mConn->OnIOUringSent((res == -EAGAIN) ? 0 : res); // this queues next send if there is more data
+}
+
+void cIOUring::Reap(vector<cAsyncConn*> &ready)
+{
+	unsigned head = *mCQHead, tail = __atomic_load_n(mCQTail, __ATOMIC_ACQUIRE);
+	const struct io_uring_cqe *cqe;
+
+	for (; head != tail; ++head) {
+		cqe = &mCQEs[head & *mCQMask];
+		if ((cqe->user_data <= IOURING_PROBE) || (cqe->user_data & IOURING_POLL)) // cancel, linked poll or test request
+			continue;
+
+		if (cqe->user_data & IOURING_SEND)
+			OnSend((sIOUringConn*)(unsigned long)(cqe->user_data & ~(unsigned long long)IOURING_SEND), cqe->res);
+		else
+			OnRecv((sIOUringConn*)(unsigned long)cqe->user_data, cqe);
+	}
+
+	__atomic_store_n(mCQHead, head, __ATOMIC_RELEASE);
+
+	for (vector<sIOUringConn*>::iterator it = mReady.begin(); it != mReady.end(); ++it) {
+		if (*it) {
+			(*it)->mReady = false;
+			ready.push_back((*it)->mConn);
+		}
+	}
+
+	mReady.clear();
+}
+
+int cIOUring::Submit()
+{
+	size_t left = 0;
+
+	for (size_t pos = 0; pos < mSendList.size(); ++pos) {
+		sIOUringConn *state = mSendList[pos];
+
+		if (!state)
+			continue;
+
+		if (state->mSend || StartSend(state)) { // otherwise it is sent again when current request finishes
+			state->mQueued = false;
+		} else { // submission queue is full, keep it for next step
+			state->mSendPos = left;
+			mSendList[left++] = state;
+		}
+	}
+
+	mSendList.resize(left);
+
+	if (!mToSubmit)
+		return 0;
+
+	return Enter(mToSubmit, IORING_ENTER_GETEVENTS, 0);
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
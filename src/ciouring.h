@@ -0,0 +1,195 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCIOURING_H
+#define NSOCKETCIOURING_H
+
+#ifdef HAVE_CONFIG_H
+	#include <config.h>
+#endif
+
+#if defined(USE_IO_URING) && HAVE_LINUX_IO_URING_H
+	#undef USE_IO_URING
+	#define USE_IO_URING 1
+#else
+	#undef USE_IO_URING
+	#define USE_IO_URING 0
+#endif
+
+#if USE_IO_URING
+
+#include "cconnbase.h"
+#include "csendqueue.h"
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+using std::vector;
+
+// size of submission queue, completion queue is twice as big
+#define IOURING_ENTRIES 4096
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf;
+
+namespace nVerliHub {
+	namespace nSocket {
+		class cAsyncConn;
+
+/// Send request of a connection, at most one is in progress.
+struct sIOUringSend
+{
+	size_t mCount; // used entries of arrays below
+	size_t mLen; // bytes to send
+	struct msghdr mMsg;
+	struct iovec mIOV[SEND_QUEUE_IOV];
+	cSendSegment *mSegs[SEND_QUEUE_IOV]; // referenced until send finishes
+};
+
+/// State of a connection handled by io_uring engine.
+struct sIOUringConn
+{
+	cAsyncConn *mConn; // NULL when connection is gone but its requests are still running
+	size_t mRead; // bytes received since last ReadAll
+	size_t mSendPos; // position in list of connections to send
+	size_t mReadyPos; // position in list of connections with input
+	int mError; // receive error, -1 when connection was closed by other side
+	bool mRecv; // multishot receive is armed
+	bool mSend; // send in progress
+	bool mInput; // reading is wanted
+	bool mReady; // already in list of connections with input
+	bool mQueued; // already in list of connections to send
+	bool mWait; // last send was short, wait until socket is writable
+	sIOUringSend mSendOp;
+};
+
+/**
+* Socket I/O engine based on io_uring.
+*
+* Client connections are read by multishot receive requests that take memory from a shared ring of provided buffers,
+* so no receive call is made per readable socket. Writes are only queued during main loop step
+* and all connections are sent by single submission at its end.
+* Listening sockets and connection closing are still handled by connection chooser.
+*/
+class cIOUring
+{
+public:
+	cIOUring();
+	~cIOUring();
+
+	/**
+	* Create the ring and register receive buffers.
+	* @param entries Size of submission queue.
+	* @return False if kernel does not support required features.
+	*/
+	bool Init(unsigned int entries);
+
+	/**
+	* Let kernel signal given eventfd whenever a request completes.
+	* @param fd The eventfd, ignored when negative.
+	* @return False on failure.
+	*/
+	bool Notify(int fd);
+
+	/// Return true if there are connections to report or sends to submit, so main loop must not wait.
+	bool Pending() const
+	{
+		return !mReady.empty() || !mSendList.empty();
+	}
+
+	/// Start handling a connection, reading starts immediately.
+	void Add(cAsyncConn *conn);
+
+	/**
+	* Stop handling a connection, must be called before its socket is closed.
+	* @return False if receive could not be cancelled, socket is shut down instead so it still gets closed.
+	*/
+	bool Del(cAsyncConn *conn);
+
+	/// Enable or disable reading from connection, used to block input when output buffer is full.
+	void Input(cAsyncConn *conn, bool on);
+
+	/// Report connection by next Reap() even without new input, used to process an error after received data.
+	void Ready(cAsyncConn *conn);
+
+	/// Send output buffer of connection on next Submit().
+	void Send(cAsyncConn *conn);
+
+	/**
+	* Process completed requests.
+	* @param ready Filled with connections that have new input or input error.
+	*/
+	void Reap(vector<cAsyncConn*> &ready);
+
+	/**
+	* Pass all queued requests to kernel.
+	* @return Number of submitted requests.
+	*/
+	int Submit();
+
+	/// Number of calls to kernel.
+	unsigned long mEnters;
+
+	/// Number of received chunks.
+	unsigned long mRecvs;
+
+	/// Number of finished sends.
+	unsigned long mSends;
+
+private:
+	bool Probe();
+	int Enter(unsigned int submit, unsigned int flags, unsigned int wait);
+	bool Reserve(unsigned int count);
+	struct io_uring_sqe* GetSQE();
+	void PutBuffer(unsigned int id);
+	void ArmRecv(sIOUringConn *state);
+	bool Cancel(unsigned long data);
+	bool StartSend(sIOUringConn *state);
+	void MarkReady(sIOUringConn *state);
+	void OnRecv(sIOUringConn *state, const struct io_uring_cqe *cqe);
+	void OnSend(sIOUringConn *state, int res);
+
+	int mFD;
+	void *mSQRing;
+	size_t mSQRingSize;
+	struct io_uring_sqe *mSQEs;
+	size_t mSQEsSize;
+	unsigned *mSQHead, *mSQTail, *mSQMask, *mSQArray, *mCQHead, *mCQTail, *mCQMask;
+	struct io_uring_cqe *mCQEs;
+	unsigned int mSQEntries;
+	unsigned int mSQLocalTail; // queued but not yet visible to kernel
+	unsigned int mToSubmit;
+
+	struct io_uring_buf *mBufRing; // ring of provided receive buffers
+	size_t mBufRingSize;
+	char *mBufs;
+
+	vector<sIOUringConn*> mSendList; // connections to send on next Submit()
+	vector<sIOUringConn*> mReady; // connections with new input
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
+
+#endif
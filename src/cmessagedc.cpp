@@ -81,10 +81,23 @@ cMessageDC::cMessageDC():
 cMessageDC::~cMessageDC()
 {}
 
+/*
+	test one candidate of command dispatch in Parse
+*/
+
+static inline bool IsCommand(const string &str, tDCMsg cmd, int &found)
+{
+	if (!sDC_Commands[cmd].AreYou(str))
+		return false;
+
+	found = cmd;
+	return true;
+}
+
 /*
 	parses the string and sets the state variables
-		this function call too many comparisons, its to optimize by a tree
-		attention: AreYou returns true if the first part matches, some messages may be confused
+		command is chosen by first characters after dollar, then only the few candidates that share them are compared
+		candidates are tried in same order as in sDC_Commands, so result is the same as when whole list is searched
 */
 
 int cMessageDC::Parse()
@@ -103,15 +116,95 @@ int cMessageDC::Parse()
 		return eDC_CHAT;
 	}
 
-	for (unsigned int i = 0; i < eDC_CHAT; i++) { // other commands, note: here we dont check for eDC_UNKNOWN and eDC_CHAT anymore
-		if (sDC_Commands[i].AreYou(mStr)) {
-			mType = tDCMsg(i);
-			mKWSize = sDC_Commands[i].mBaseLength;
-			mLen = mStr.size();
-			break;
+	int found = eDC_UNKNOWN;
+
+	if ((mStr[0] == '$') && (mStr.size() > 1)) { // note: character after end of string is null
+		switch (mStr[1]) {
+			case 'C':
+				IsCommand(mStr, eDC_CONNECTTOME, found);
+				break;
+			case 'R':
+				IsCommand(mStr, eDC_RCONNECTTOME, found);
+				break;
+			case 'S':
+				switch (mStr[2]) {
+					case 'R':
+						IsCommand(mStr, eDC_SR, found);
+						break;
+					case 'e':
+						IsCommand(mStr, eDC_SEARCH_PAS, found) || IsCommand(mStr, eDC_SEARCH, found) || IsCommand(mStr, eDCO_SETTOPIC, found);
+						break;
+					case 'A':
+						IsCommand(mStr, eDC_TTHS, found);
+						break;
+					case 'P':
+						IsCommand(mStr, eDC_TTHS_PAS, found);
+						break;
+					case 'u':
+						IsCommand(mStr, eDC_SUPPORTS, found);
+						break;
+				}
+
+				break;
+			case 'M':
+				switch (mStr[2]) {
+					case 'y':
+						IsCommand(mStr, eDC_MYINFO, found) || IsCommand(mStr, eDC_MYHUBURL, found) || IsCommand(mStr, eDC_MYPASS, found) || IsCommand(mStr, eDCC_MYIP, found) || IsCommand(mStr, eDCC_MYNICK, found);
+						break;
+					case 'u':
+						IsCommand(mStr, eDC_MCONNECTTOME, found) || IsCommand(mStr, eDC_MSEARCH_PAS, found) || IsCommand(mStr, eDC_MSEARCH, found);
+						break;
+					case 'C':
+						IsCommand(mStr, eDC_MCTO, found);
+						break;
+				}
+
+				break;
+			case 'E':
+				IsCommand(mStr, eDC_EXTJSON, found);
+				break;
+			case 'K':
+				IsCommand(mStr, eDC_KEY, found) || IsCommand(mStr, eDCO_KICK, found);
+				break;
+			case 'V':
+				IsCommand(mStr, eDC_VALIDATENICK, found) || IsCommand(mStr, eDC_VERSION, found);
+				break;
+			case 'G':
+				IsCommand(mStr, eDC_GETNICKLIST, found) || IsCommand(mStr, eDC_GETINFO, found) || IsCommand(mStr, eDCO_GETBANLIST, found) || IsCommand(mStr, eDCO_GETTOPIC, found);
+				break;
+			case 'T':
+				IsCommand(mStr, eDC_TO, found) || IsCommand(mStr, eDCO_TBAN, found);
+				break;
+			case 'B':
+				IsCommand(mStr, eDCB_BOTINFO, found) || IsCommand(mStr, eDCO_BAN, found);
+				break;
+			case 'U':
+				IsCommand(mStr, eDCO_USERIP, found) || IsCommand(mStr, eDCO_UNBAN, found);
+				break;
+			case 'O':
+				IsCommand(mStr, eDCO_OPFORCEMOVE, found);
+				break;
+			case 'Q':
+				IsCommand(mStr, eDC_QUIT, found);
+				break;
+			case 'W':
+				IsCommand(mStr, eDCO_WHOIP, found);
+				break;
+			case 'L':
+				IsCommand(mStr, eDCC_LOCK, found);
+				break;
+			case 'I':
+				IsCommand(mStr, eDC_IN, found);
+				break;
 		}
 	}
 
+	if (found != eDC_UNKNOWN) {
+		mType = tDCMsg(found);
+		mKWSize = sDC_Commands[found].mBaseLength;
+		mLen = mStr.size();
+	}
+
 	if (mType == eMSG_UNPARSED)
 		mType = eDC_UNKNOWN;
 
@@ -27,6 +27,7 @@
 
 #include "cobj.h"
 #include "cprotocol.h"
+#include "tobjpool.h"
 namespace nVerliHub {
 	namespace nEnums {
 		typedef enum // these constants correspond to sDC_Commands in .cpp file, note: they are ordered by frequency of usage for best performance
@@ -131,6 +132,17 @@ class cMessageDC: public cMessageParser
 	public:
 		cMessageDC();
 		virtual ~cMessageDC();
+
+		// memory of parsers is reused by new connections
+		static void* operator new(size_t size)
+		{
+			return nUtils::tObjPool<cMessageDC>::Alloc(size);
+		}
+
+		static void operator delete(void *ptr, size_t size)
+		{
+			nUtils::tObjPool<cMessageDC>::Free(ptr, size);
+		}
 		// parses the string and sets the state variables
 		virtual int Parse(); // override
 		// splits message to its important parts and stores their info in the chunkset mChunks
@@ -20,6 +20,8 @@
 
 #include "cprotocol.h"
 #include "stringutils.h"
+#include <cstdlib>
+#include <cstring>
 
 namespace nVerliHub {
 	using namespace nUtils;
@@ -27,6 +29,57 @@ namespace nVerliHub {
 
 	namespace nProtocol {
 
+cChunkView cChunkView::Sub(size_t pos, size_t len) const
+{
+	if (pos > mSize)
+		pos = mSize;
+
+	if (len > (mSize - pos))
+		len = mSize - pos;
+
+	return cChunkView(mData + pos, len);
+}
+
+bool cChunkView::StartsWith(const cChunkView &str) const
+{
+	return (mSize >= str.mSize) && !memcmp(mData, str.mData, str.mSize);
+}
+
+bool cChunkView::StartsWith(const char *str) const
+{
+	return StartsWith(cChunkView(str, strlen(str)));
+}
+
+bool cChunkView::EndsWith(const char *str) const
+{
+	const size_t len = strlen(str);
+	return (mSize >= len) && !memcmp(mData + mSize - len, str, len);
+}
+
+bool cChunkView::operator==(const cChunkView &str) const
+{
+	return (mSize == str.mSize) && !memcmp(mData, str.mData, mSize);
+}
+
+bool cChunkView::operator==(const char *str) const
+{
+	return *this == cChunkView(str, strlen(str));
+}
+
+__int64 cChunkView::AsLL() const
+{
+	char buf[32]; // longer numbers do not fit anyway
+	const size_t len = ((mSize < sizeof(buf)) ? mSize : (sizeof(buf) - 1));
+	memcpy(buf, mData, len);
+	buf[len] = '\0';
+	return strtoll(buf, NULL, 10);
+}
+
+ostream& operator<<(ostream &os, const cChunkView &str)
+{
+	return os.write(str.Data(), str.Size());
+}
+
 cProtocol::cProtocol():
 	cObj("cProtocol")
 {}
@@ -73,7 +126,9 @@ void cMessageParser::ReInit()
 	mError = false;
 	mModified = false;
 	mStr.resize(0);
-	mStr.reserve(512); // todo: do we really need this big reserve? some commands are alot smaller
+
+	if (mStr.capacity() < 512) // note: reserving less than capacity would shrink the string and reallocate on every message
+		mStr.reserve(512);
 	mType = eMSG_UNPARSED;
 	mKWSize = 0;
 }
@@ -123,6 +178,26 @@ string &cMessageParser::ChunkString(unsigned int n)
 	return mChStrings[n];
 }
 
+// return a view of the n'th chunk, same rules as in ChunkString but nothing is copied
+cChunkView cMessageParser::ChunkView(unsigned int n) const
+{
+	if (!n)
+		return cChunkView(mStr);
+
+	if (n >= mChunks.size())
+		return cChunkView();
+
+	if (mChStrMap & (1 << n)) // chunk string was already made and might have been modified by its user
+		return cChunkView(mChStrings[n]);
+
+	const tChunk &chu = mChunks[n];
+
+	if ((chu.first >= 0) && (chu.second >= 0) && ((unsigned int)chu.first <= mStr.length()) && ((unsigned int)chu.second <= mStr.length()))
+		return cChunkView(mStr).Sub(chu.first, chu.second);
+
+	return cChunkView();
+}
+
 // splits message into two chunks by a delimiter and stores them in the chunklist
 bool cMessageParser::SplitOnTwo(size_t start, const string &lim, int cn1, int cn2, size_t len, bool left)
 {
@@ -154,20 +229,19 @@ bool cMessageParser::SplitOnTwo(size_t start, const char lim, int cn1, int cn2,
 	if (!len)
 		len = mLen;
 
-	unsigned long i;
+	if (start >= mStr.size())
+		return false;
 
-	if (left) {
-		i = mStr.find_first_of(lim, start);
+	if (len > (mStr.size() - start)) // only scan inside of the chunk
+		len = mStr.size() - start;
 
-		if ((i == mStr.npos) || ((i - start) >= len))
-			return false;
-	} else {
-		i = mStr.find_last_of(lim, (start + len) - 1);
+	const char *buf = mStr.data() + start;
+	const char *pos = (left ? FindChar(buf, len, lim) : FindCharLast(buf, len, lim));
 
-		if ((i == mStr.npos) || (i < start))
-			return false;
-	}
+	if (!pos)
+		return false;
 
+	unsigned long i = start + (pos - buf);
 	SetChunk(cn1, start, i - start);
 	SetChunk(cn2, i + 1, mLen - i - 1);
 	return true;
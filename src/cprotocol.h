@@ -34,6 +34,77 @@ namespace nVerliHub {
  	};
 
 	namespace nProtocol {
+/**
+* Read only view of a part of a string, usually a message chunk
+* it does not own the data and is only valid until the viewed string is modified
+*/
+class cChunkView
+{
+	public:
+		cChunkView():
+			mData(""),
+			mSize(0)
+		{}
+
+		cChunkView(const char *data, size_t size):
+			mData(data),
+			mSize(size)
+		{}
+
+		cChunkView(const string &str):
+			mData(str.data()),
+			mSize(str.size())
+		{}
+
+		const char* Data() const
+		{
+			return mData;
+		}
+
+		size_t Size() const
+		{
+			return mSize;
+		}
+
+		bool Empty() const
+		{
+			return !mSize;
+		}
+
+		char operator[](size_t n) const
+		{
+			return mData[n];
+		}
+
+		/** part of the view starting at pos with at most len characters */
+		cChunkView Sub(size_t pos, size_t len = string::npos) const;
+		bool StartsWith(const cChunkView &str) const;
+		bool StartsWith(const char *str) const;
+		bool EndsWith(const char *str) const;
+		bool operator==(const cChunkView &str) const;
+		bool operator==(const char *str) const;
+
+		/** copy the viewed data, use only where it has to be stored */
+		string AsString() const
+		{
+			return string(mData, mSize);
+		}
+
+		void AppendTo(string &dest) const
+		{
+			dest.append(mData, mSize);
+		}
+
+		/** same as StringAsLL but without copying to a string */
+		__int64 AsLL() const;
+
+	private:
+		const char *mData;
+		size_t mSize;
+};
+
+ostream& operator<<(ostream &os, const cChunkView &str);
+
 class cMessageParser : public cObj
 {
 	public:
@@ -49,6 +120,9 @@ class cMessageParser : public cObj
 		virtual void ReInit();
 		/** return the n'th chunk (as splited by SplitChunks) function */
 		virtual string &ChunkString(unsigned int n);
+		/** return a view of the n'th chunk without copying it, prefer it where the chunk is not stored
+		  * the view becomes invalid when mStr is modified, for example by ApplyChunk */
+		cChunkView ChunkView(unsigned int n) const;
 
 		/** apply the chunkstring ito the main string */
 		void ApplyChunk(unsigned int n);
@@ -0,0 +1,132 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "creadbuffer.h"
+#include "stringutils.h"
+#include <string.h>
+
+// initial size of a read, doubled every time a read fills the free space
+#define READ_BUF_CHUNK		4096
+
+// buffers bigger than this are shrunk before they are returned to the pool
+#define READ_BUF_KEEP		65536
+
+// maximum number of buffers kept in the pool
+#define READ_BUF_POOL		2048
+
+namespace nVerliHub {
+	namespace nSocket {
+
+vector<cReadBuffer*> cReadBuffer::msPool;
+unsigned long cReadBuffer::sCount = 0;
+
+cReadBuffer::cReadBuffer():
+	mChunk(READ_BUF_CHUNK),
+	mStart(0),
+	mEnd(0),
+	mScan(0)
+{
+	mData.resize(READ_BUF_CHUNK);
+	sCount++;
+}
+
+cReadBuffer::~cReadBuffer()
+{
+	sCount--;
+}
+
+char* cReadBuffer::WritePtr(size_t &len)
+{
+	if ((mData.size() - mEnd) < len) {
+		if (mStart) { // move unfinished line to the front
+			if (mEnd > mStart)
+				memmove(&mData[0], &mData[mStart], mEnd - mStart);
+
+			mEnd -= mStart;
+			mStart = 0;
+		}
+
+		if ((mData.size() - mEnd) < len)
+			mData.resize(mEnd + len);
+	}
+
+	len = mData.size() - mEnd;
+	return &mData[mEnd];
+}
+
+void cReadBuffer::Written(size_t len)
+{
+	mEnd += len;
+}
+
+bool cReadBuffer::NextLine(char sep, const char *&line, size_t &len)
+{
+	const char *buf = &mData[0] + mStart, *pos;
+
+	if (!(pos = nUtils::FindChar(buf + mScan, mEnd - mStart - mScan, sep))) {
+		mScan = mEnd - mStart;
+		return false;
+	}
+
+	line = buf;
+	len = pos - buf;
+	mStart += len + 1;
+	mScan = 0;
+
+	if (mStart >= mEnd) { // everything consumed, start from the beginning
+		mStart = 0;
+		mEnd = 0;
+	}
+
+	return true;
+}
+
+cReadBuffer* cReadBuffer::Get()
+{
+	if (msPool.empty())
+		return new cReadBuffer;
+
+	cReadBuffer *buf = msPool.back();
+	msPool.pop_back();
+	return buf;
+}
+
+void cReadBuffer::Put(cReadBuffer *buf)
+{
+	if (!buf)
+		return;
+
+	if (msPool.size() >= READ_BUF_POOL) {
+		delete buf;
+		return;
+	}
+
+	buf->mStart = buf->mEnd = buf->mScan = 0;
+
+	if (buf->mData.size() > READ_BUF_KEEP) { // dont keep memory of a single big burst
+		vector<char>(READ_BUF_CHUNK).swap(buf->mData);
+		buf->mChunk = READ_BUF_CHUNK;
+	}
+
+	msPool.push_back(buf);
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
@@ -0,0 +1,116 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCREADBUFFER_H
+#define NSOCKETCREADBUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+namespace nVerliHub {
+	namespace nSocket {
+
+/**
+* Input buffer of a single connection.
+*
+* Data is received at the end of the buffer and complete lines are taken from the front without copying,
+* unfinished line stays in the buffer until rest of it arrives, it is moved to the front only when there is no room left at the end.
+* Buffers are taken from a shared pool when connection has something to read and are returned to it once all lines are consumed,
+* so idle connections hold no input memory.
+*/
+class cReadBuffer
+{
+public:
+	cReadBuffer();
+	~cReadBuffer();
+
+	/**
+	* Return pointer to free space at the end of the buffer.
+	* The buffer is compacted or grown when there is less room than requested.
+	* @param len Wanted free space, set to actual free space on return.
+	* @return Pointer to write to.
+	*/
+	char* WritePtr(size_t &len);
+
+	/**
+	* Mark given amount of bytes as written after WritePtr() call.
+	* @param len Number of written bytes.
+	*/
+	void Written(size_t len);
+
+	/**
+	* Find next complete line.
+	* @param sep Line separator.
+	* @param line Pointer to the first character of the line, valid until next WritePtr() call.
+	* @param len Length of the line without separator.
+	* @return True if complete line was found.
+	*/
+	bool NextLine(char sep, const char *&line, size_t &len);
+
+	/// Number of buffered bytes that are not consumed yet.
+	size_t Pending() const
+	{
+		return mEnd - mStart;
+	}
+
+	/// True if all buffered data was already searched for a line separator.
+	bool Scanned() const
+	{
+		return (mStart + mScan) >= mEnd;
+	}
+
+	size_t Capacity() const
+	{
+		return mData.size();
+	}
+
+	/// Size of next read, it grows when reads keep filling it up.
+	size_t mChunk;
+
+	/// Take a buffer from the pool or create a new one.
+	static cReadBuffer* Get();
+
+	/// Return a buffer to the pool.
+	static void Put(cReadBuffer *buf);
+
+	/// Number of buffers in the pool.
+	static size_t PoolSize()
+	{
+		return msPool.size();
+	}
+
+	/// Number of existing buffers.
+	static unsigned long sCount;
+
+private:
+	vector<char> mData;
+	size_t mStart; // first unconsumed byte
+	size_t mEnd; // end of received data
+	size_t mScan; // bytes after mStart known not to contain separator
+
+	static vector<cReadBuffer*> msPool;
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
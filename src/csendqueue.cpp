@@ -0,0 +1,323 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifdef HAVE_CONFIG_H
+	#include <config.h>
+#endif
+
+#include "csendqueue.h"
+
+#if HAVE_ERRNO_H
+	#include <errno.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <string.h>
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
+// segments with more memory than this are shrunk before they are returned to the pool
+#define SEND_SEG_KEEP 16384
+
+// maximum number of segments kept in the pool
+#define SEND_SEG_POOL 4096
+
+// number of consumed items at front of a queue that is compacted even when it is not empty
+#define SEND_QUEUE_COMPACT 64
+
+namespace nVerliHub {
+	namespace nSocket {
+
+vector<cSendSegment*> cSendSegment::msPool;
+unsigned long cSendSegment::sCount = 0;
+unsigned long cSendSegment::sReused = 0;
+unsigned long cSendQueue::sQueued[eTC_COUNT] = {0};
+unsigned long cSendQueue::sDropped[eTC_COUNT] = {0};
+unsigned long long cSendQueue::sDroppedBytes[eTC_COUNT] = {0};
+
+cSendSegment::cSendSegment():
+	mRefs(1)
+{
+	sCount++;
+}
+
+cSendSegment::~cSendSegment()
+{
+	sCount--;
+}
+
+cSendSegment* cSendSegment::New()
+{
+	if (msPool.empty())
+		return new cSendSegment;
+
+	cSendSegment *seg = msPool.back();
+	msPool.pop_back();
+	seg->mRefs = 1;
+	sReused++;
+	return seg;
+}
+
+void cSendSegment::Release(cSendSegment *seg)
+{
+	if (msPool.size() >= SEND_SEG_POOL) {
+		delete seg;
+		return;
+	}
+
+	seg->mData.clear(); // memory is kept for next user
+
+	if (seg->mData.capacity() > SEND_SEG_KEEP) // dont keep memory of a single big message
+		string().swap(seg->mData);
+
+	msPool.push_back(seg);
+}
+
+size_t cSendSegment::PoolCapacity()
+{
+	size_t cap = 0;
+
+	for (vector<cSendSegment*>::const_iterator it = msPool.begin(); it != msPool.end(); ++it)
+		cap += (*it)->mData.capacity();
+
+	return cap;
+}
+
+cSendQueue::cSendQueue():
+	mHead(0),
+	mSize(0),
+	mLocked(0)
+{}
+
+cSendQueue::~cSendQueue()
+{
+	Clear();
+}
+
+void cSendQueue::Push(cSendSegment *seg, unsigned int cls)
+{
+	if (cls >= eTC_COUNT)
+		cls = eTC_CONTROL;
+
+	mItems.push_back(sItem(seg, cls));
+	mSize += seg->mData.size();
+	sQueued[cls]++;
+}
+
+void cSendQueue::Append(cSendSegment *seg, unsigned int cls)
+{
+	if (!seg || seg->mData.empty())
+		return;
+
+	seg->Ref();
+	Push(seg, cls);
+}
+
+void cSendQueue::Append(const char *data, size_t len, unsigned int cls)
+{
+	if (!len)
+		return;
+
+	cSendSegment *seg = cSendSegment::New();
+	seg->mData.assign(data, len);
+	Push(seg, cls); // queue keeps the reference from creation
+}
+
+void cSendQueue::Swap(string &data, unsigned int cls)
+{
+	if (data.empty())
+		return;
+
+	cSendSegment *seg = cSendSegment::New();
+	seg->mData.swap(data); // string gets memory of the recycled segment, so next append does not allocate
+	Push(seg, cls);
+}
+
+size_t cSendQueue::Drop(unsigned int cls)
+{
+	size_t keep = mLocked, len, freed = 0;
+
+	if (!keep && (mHead < mItems.size()) && mItems[mHead].mOff) // client already has beginning of it
+		keep = 1;
+
+	if (keep >= Count())
+		return 0;
+
+	tItems::iterator to = mItems.begin() + mHead + keep;
+
+	for (tItems::iterator it = to; it != mItems.end(); ++it) {
+		if (it->mClass >= cls) {
+			len = it->mSeg->mData.size();
+			freed += len;
+			sDropped[it->mClass]++;
+			sDroppedBytes[it->mClass] += len;
+			it->mSeg->UnRef();
+		} else {
+			*to++ = *it; // keep order of remaining data
+		}
+	}
+
+	mItems.erase(to, mItems.end());
+
+	if (mHead == mItems.size()) {
+		mItems.clear();
+		mHead = 0;
+	}
+
+	mSize -= freed;
+	return freed;
+}
+
+unsigned int cSendQueue::Classify(const char *data, size_t len)
+{
+	if (!len)
+		return eTC_CONTROL;
+
+	switch (data[0]) {
+		case '<': // main chat
+			return eTC_CHAT;
+		case '$':
+			break;
+		default:
+			return eTC_CONTROL;
+	}
+
+	if ((len > 3) && (data[1] == 'S')) {
+		if ((data[2] == 'R') && (data[3] == ' ')) // search result
+			return eTC_SEARCH;
+
+		if ((len > 7) && !strncmp(data + 2, "earch ", 6))
+			return eTC_SEARCH;
+
+		if (((data[2] == 'A') || (data[2] == 'P')) && (data[3] == ' ')) // short tth search
+			return eTC_SEARCH;
+
+		return eTC_CONTROL;
+	}
+
+	if ((len > 4) && !strncmp(data + 1, "To: ", 4)) // private message
+		return eTC_CHAT;
+
+	if (((len > 7) && !strncmp(data + 1, "MyINFO ", 7)) || ((len > 5) && !strncmp(data + 1, "Quit ", 5)) || ((len > 7) && !strncmp(data + 1, "UserIP ", 7)) || ((len > 8) && !strncmp(data + 1, "MyFlags ", 8)))
+		return eTC_INFO;
+
+	return eTC_CONTROL;
+}
+
+size_t cSendQueue::Gather(struct iovec *iov, cSendSegment **seg, size_t max) const
+{
+	size_t count = 0;
+
+	for (tItems::const_iterator it = mItems.begin() + mHead; (it != mItems.end()) && (count < max); ++it, ++count) {
+		iov[count].iov_base = (void*)(it->mSeg->mData.data() + it->mOff);
+		iov[count].iov_len = it->mSeg->mData.size() - it->mOff;
+
+		if (seg)
+			seg[count] = it->mSeg;
+	}
+
+	return count;
+}
+
+int cSendQueue::Send(tSocket sock, size_t &len)
+{
+	struct iovec iov[SEND_QUEUE_IOV];
+	struct msghdr msg;
+	size_t total = 0;
+	ssize_t n;
+
+	while (mSize) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = Gather(iov, NULL, SEND_QUEUE_IOV);
+		n = sendmsg(sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+
+		if (n == -1)
+			break;
+
+		Consume(n);
+		total += n;
+	}
+
+	len = total; // number of bytes actually sent
+	return (mSize ? -1 : 0);
+}
+
+void cSendQueue::Consume(size_t len)
+{
+	size_t left;
+
+	while (len && (mHead < mItems.size())) {
+		sItem &item = mItems[mHead];
+		left = item.mSeg->mData.size() - item.mOff;
+
+		if (len < left) { // partially sent, remember where to continue
+			item.mOff += len;
+			mSize -= len;
+			return;
+		}
+
+		len -= left;
+		mSize -= left;
+		item.mSeg->UnRef();
+		mHead++;
+
+		if (mLocked)
+			mLocked--;
+	}
+
+	if (mHead == mItems.size()) { // everything sent, start from beginning again, memory is kept
+		mItems.clear();
+		mHead = 0;
+	} else if ((mHead >= SEND_QUEUE_COMPACT) && ((mHead * 2) >= mItems.size())) { // slow reader, dont let sent items pile up
+		mItems.erase(mItems.begin(), mItems.begin() + mHead);
+		mHead = 0;
+	}
+}
+
+void cSendQueue::Clear()
+{
+	for (tItems::iterator it = mItems.begin() + mHead; it != mItems.end(); ++it)
+		it->mSeg->UnRef();
+
+	mItems.clear();
+	mHead = 0;
+	mSize = 0;
+	mLocked = 0;
+}
+
+size_t cSendQueue::Capacity() const
+{
+	size_t cap = 0;
+
+	for (tItems::const_iterator it = mItems.begin() + mHead; it != mItems.end(); ++it) {
+		if (!it->mSeg->IsShared())
+			cap += it->mSeg->mData.capacity();
+	}
+
+	return cap;
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
@@ -0,0 +1,232 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCSENDQUEUE_H
+#define NSOCKETCSENDQUEUE_H
+
+#include "cconnbase.h"
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+struct iovec;
+
+// maximum number of segments written by single call
+#define SEND_QUEUE_IOV 64
+
+namespace nVerliHub {
+	namespace nSocket {
+
+/// Traffic classes of outgoing data, from most to least important.
+enum tTrafficClass
+{
+	eTC_CONTROL, // login, redirects and everything not listed below
+	eTC_CHAT, // main chat and private messages
+	eTC_INFO, // user list updates
+	eTC_SEARCH, // searches and results, dropped first when output buffer is full
+	eTC_COUNT
+};
+
+/**
+* Reference counted piece of outgoing data.
+*
+* A broadcast is written into a single segment that is then queued by every recipient,
+* data must not be modified once the segment is queued anywhere.
+* Released segments are kept in a pool together with their memory and reused by next New() call.
+*/
+class cSendSegment
+{
+public:
+	/// Take a segment from the pool or create new one, caller owns the only reference.
+	static cSendSegment* New();
+
+	void Ref()
+	{
+		mRefs++;
+	}
+
+	/// Drop a reference, segment goes back to the pool when last one is gone.
+	void UnRef()
+	{
+		if (!--mRefs)
+			Release(this);
+	}
+
+	bool IsShared() const
+	{
+		return mRefs > 1;
+	}
+
+	/// Segment data.
+	string mData;
+
+	/// Number of existing segments, including pooled ones.
+	static unsigned long sCount;
+
+	/// Number of segments taken from the pool instead of being created.
+	static unsigned long sReused;
+
+	/// Number of segments in the pool.
+	static size_t PoolSize()
+	{
+		return msPool.size();
+	}
+
+	/// Memory held by pooled segments.
+	static size_t PoolCapacity();
+
+private:
+	cSendSegment();
+	~cSendSegment();
+	cSendSegment(const cSendSegment &);
+	cSendSegment &operator=(const cSendSegment &);
+
+	static void Release(cSendSegment *seg);
+
+	unsigned int mRefs;
+	static vector<cSendSegment*> msPool;
+};
+
+/**
+* Output queue of a connection.
+*
+* Holds references to segments in order they must be sent and an offset into the first one,
+* so partially sent data is never moved, whole queue is written with a single gathering call.
+* Items are kept in a vector that is only rewound when it is emptied or mostly consumed,
+* so its memory is reused and steady traffic does not allocate.
+*/
+class cSendQueue
+{
+public:
+	cSendQueue();
+	~cSendQueue();
+
+	/// Queue a segment, queue takes its own reference.
+	void Append(cSendSegment *seg, unsigned int cls);
+
+	/// Queue a private copy of given data.
+	void Append(const char *data, size_t len, unsigned int cls);
+
+	/// Move content of given string to the queue without copying it, string is left empty.
+	void Swap(string &data, unsigned int cls);
+
+	/**
+	* Remove queued data of given class and less important classes.
+	* Partially sent data and data passed to kernel is kept.
+	* @param cls Most important class to remove.
+	* @return Number of removed bytes.
+	*/
+	size_t Drop(unsigned int cls);
+
+	/// Protect given number of items at front of the queue from Drop(), used while kernel sends them.
+	void Lock(size_t count)
+	{
+		mLocked = count;
+	}
+
+	/**
+	* Return traffic class of protocol data by its command.
+	* @param data Data, only the first command is checked.
+	* @param len Length of data.
+	* @return One of tTrafficClass values.
+	*/
+	static unsigned int Classify(const char *data, size_t len);
+
+	/// Number of queued messages per traffic class.
+	static unsigned long sQueued[eTC_COUNT];
+
+	/// Number of messages dropped per traffic class.
+	static unsigned long sDropped[eTC_COUNT];
+
+	/// Number of bytes dropped per traffic class.
+	static unsigned long long sDroppedBytes[eTC_COUNT];
+
+	/**
+	* Send as much queued data as possible.
+	* @param sock Socket to write to.
+	* @param len Set to number of sent bytes.
+	* @return Zero when everything was sent or -1 when socket would block or failed, see errno.
+	*/
+	int Send(tSocket sock, size_t &len);
+
+	/**
+	* Describe queued data for a gathering write.
+	* @param iov Filled with pointers to unsent data.
+	* @param seg If not NULL, filled with segments the data belongs to.
+	* @param max Size of given arrays.
+	* @return Number of filled entries.
+	*/
+	size_t Gather(struct iovec *iov, cSendSegment **seg, size_t max) const;
+
+	/// Remove given amount of sent bytes from front of the queue.
+	void Consume(size_t len);
+
+	/// Drop all queued data.
+	void Clear();
+
+	/// Number of bytes waiting to be sent.
+	size_t Size() const
+	{
+		return mSize;
+	}
+
+	bool Empty() const
+	{
+		return !mSize;
+	}
+
+	/// Memory held by segments that are not shared with other connections.
+	size_t Capacity() const;
+
+	/// Number of queued segments.
+	size_t Count() const
+	{
+		return mItems.size() - mHead;
+	}
+
+protected:
+	struct sItem
+	{
+		cSendSegment *mSeg;
+		size_t mOff; // sent part of segment, non zero only for first item
+		unsigned int mClass;
+
+		sItem(cSendSegment *seg, unsigned int cls):
+			mSeg(seg),
+			mOff(0),
+			mClass(cls)
+		{}
+	};
+
+	void Push(cSendSegment *seg, unsigned int cls);
+
+	typedef vector<sItem> tItems;
+	tItems mItems;
+	size_t mHead; // first unsent item, items before it are already consumed
+	size_t mSize;
+	size_t mLocked; // items passed to kernel
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
@@ -43,6 +43,7 @@
 #include "cthreadwork.h"
 #include "stringutils.h"
 #include "cconntypes.h"
+#include "cvartemplate.h"
 #include "cdcconsole.h"
 #include "ctriggers.h"
 #include "i18n.h"
@@ -82,6 +83,8 @@ cServerDC::cServerDC(string CfgBase, const string &ExecPath):
 	mPassiveUsers(false, false, false),
 	mChatUsers(false, false, false),
 	mRobotList(true, false, false),
+	mZipCacheHits(0),
+	mZipCacheMisses(0),
 	mReloadNow(false),
 	mUserCountTot(0),
 	mTotalShare(0),
@@ -305,6 +308,8 @@ cServerDC::~cServerDC()
 		mCo = NULL;
 	}
 
+	ClearZipCache();
+
 	if (mZLib) {
 		delete mZLib;
 		mZLib = NULL;
@@ -324,7 +329,12 @@ int cServerDC::StartListening(int OverrideDefaultPort)
 	while(i) {
 		i = 0;
 		is >> i;
-		if (i) cAsyncSocketServer::Listen(i/*, false*/);
+		if (i) {
+			if (mAcceptThreadNum)
+				ListenThreaded(i);
+			else
+				cAsyncSocketServer::Listen(i/*, false*/);
+		}
 	}
 	return _result;
 }
@@ -498,6 +508,8 @@ bool cServerDC::AddToList(cUser *user)
 	user->mInList = true;
 
 	if (user->mxConn) { // dont add bots to these lists
+		UpdateSearchRecipient(user);
+
 		if (user->mPassive)
 			mPassiveUsers.AddWithHash(user, user->mNickHash);
 		else
@@ -533,6 +545,11 @@ bool cServerDC::AddToList(cUser *user)
 
 bool cServerDC::RemoveNick(cUser *user)
 {
+	if (user->mSearchKey >= 0) { // user is going away in any case, dont leave it in search index
+		mSearchIndex[user->mSearchKey].Remove(user);
+		user->mSearchKey = -1;
+	}
+
 	if (mUserList.ContainsHash(user->mNickHash)) {
 		#ifndef WITHOUT_PLUGINS
 			if (user->mxConn && user->mxConn->GetLSFlag(eLS_LOGIN_DONE) && user->mInList)
@@ -710,47 +727,26 @@ int cServerDC::SendToAllWithNick(const string &start, const string &end, int cm,
 
 int cServerDC::SendToAllWithNickVars(const string &start, const string &end, int cm, int cM)
 {
-	string temp, tend;
+	cVarTemplate tpl(end); // parse variables once
+	string temp;
 	cConnDC *conn;
 	tCLIt it;
 	int tot = 0;
-	size_t pos;
 
 	for (it = mConnList.begin(); it != mConnList.end(); it++) {
 		conn = (cConnDC*)(*it);
 
 		if (conn && conn->ok && conn->mpUser && conn->mpUser->mInList && (conn->mpUser->mClass >= cm) && (conn->mpUser->mClass <= cM)) {
-			tend = end;
-			ReplaceVarInString(tend, "NICK", tend, conn->mpUser->mNick); // replace variables
-			ReplaceVarInString(tend, "CLASS", tend, conn->mpUser->mClass);
-			pos = tend.find("%[C");
-
-			if (pos != tend.npos) { // only if found
-				if (tend.find("%[CC]", pos) != tend.npos) {
-					temp = conn->GetGeoCC(); // country code
-					ReplaceVarInString(tend, "CC", tend, temp);
-				}
-
-				if (tend.find("%[CN]", pos) != tend.npos) {
-					temp = conn->GetGeoCN(); // country name
-					ReplaceVarInString(tend, "CN", tend, temp);
-				}
-
-				if (tend.find("%[CITY]", pos) != tend.npos) {
-					temp = conn->GetGeoCI(); // city name
-					ReplaceVarInString(tend, "CITY", tend, temp);
-				}
-			}
-
-			ReplaceVarInString(tend, "IP", tend, conn->AddrIP());
-			ReplaceVarInString(tend, "HOST", tend, conn->AddrHost());
+			temp.clear(); // buffer is reused for all users
 
 #ifdef USE_BUFFER_RESERVE
 			if (temp.capacity() < (start.size() + conn->mpUser->mNick.size() + end.size() + 1)) // reserve for pipe
 				temp.reserve(start.size() + conn->mpUser->mNick.size() + end.size() + 1);
 #endif
 
-			temp = start + conn->mpUser->mNick + tend; // finalize
+			temp.append(start);
+			temp.append(conn->mpUser->mNick);
+			RenderUserVars(tpl, conn, temp);
 			conn->Send(temp, true); // pipe is added by default for safety
 			tot++;
 		}
@@ -761,47 +757,25 @@ int cServerDC::SendToAllWithNickVars(const string &start, const string &end, int
 
 int cServerDC::SendToAllNoNickVars(const string &msg, int cm, int cM)
 {
-	string temp, tmsg;
+	cVarTemplate tpl(msg); // parse variables once
+	string temp;
 	cConnDC *conn;
 	tCLIt it;
 	int tot = 0;
-	size_t pos;
 
 	for (it = mConnList.begin(); it != mConnList.end(); it++) {
 		conn = (cConnDC*)(*it);
 
 		if (conn && conn->ok && conn->mpUser && conn->mpUser->mInList && (conn->mpUser->mClass >= cm) && (conn->mpUser->mClass <= cM)) {
-			tmsg = msg;
-			ReplaceVarInString(tmsg, "NICK", tmsg, conn->mpUser->mNick); // replace variables
-			ReplaceVarInString(tmsg, "CLASS", tmsg, conn->mpUser->mClass);
-			pos = tmsg.find("%[C");
-
-			if (pos != tmsg.npos) { // only if found
-				if (tmsg.find("%[CC]", pos) != tmsg.npos) {
-					temp = conn->GetGeoCC(); // country code
-					ReplaceVarInString(tmsg, "CC", tmsg, temp);
-				}
-
-				if (tmsg.find("%[CN]", pos) != tmsg.npos) {
-					temp = conn->GetGeoCN(); // country name
-					ReplaceVarInString(tmsg, "CN", tmsg, temp);
-				}
-
-				if (tmsg.find("%[CITY]", pos) != tmsg.npos) {
-					temp = conn->GetGeoCI(); // city name
-					ReplaceVarInString(tmsg, "CITY", tmsg, temp);
-				}
-			}
-
-			ReplaceVarInString(tmsg, "IP", tmsg, conn->AddrIP());
-			ReplaceVarInString(tmsg, "HOST", tmsg, conn->AddrHost());
+			temp.clear(); // buffer is reused for all users
 
 #ifdef USE_BUFFER_RESERVE
-			if (tmsg.capacity() < (tmsg.size() + 1)) // reserve for pipe
-				tmsg.reserve(tmsg.size() + 1);
+			if (temp.capacity() < (msg.size() + 1)) // reserve for pipe
+				temp.reserve(msg.size() + 1);
 #endif
 
-			conn->Send(tmsg, true); // pipe is added by default for safety
+			RenderUserVars(tpl, conn, temp);
+			conn->Send(temp, true); // pipe is added by default for safety
 			tot++;
 		}
 	}
@@ -809,6 +783,44 @@ int cServerDC::SendToAllNoNickVars(const string &msg, int cm, int cM)
 	return tot;
 }
 
+void cServerDC::RenderUserVars(const cVarTemplate &tpl, cConnDC *conn, string &dest, const string *cc)
+{
+	const string *values[cVarTemplate::eVAR_COUNT];
+	string uclass, ucc, ucn, uci;
+	values[cVarTemplate::eVAR_NICK] = &conn->mpUser->mNick;
+	values[cVarTemplate::eVAR_IP] = &conn->AddrIP();
+	values[cVarTemplate::eVAR_CLASS] = NULL;
+	values[cVarTemplate::eVAR_CC] = cc;
+	values[cVarTemplate::eVAR_CN] = NULL;
+	values[cVarTemplate::eVAR_CITY] = NULL;
+	values[cVarTemplate::eVAR_HOST] = NULL;
+
+	if (tpl.Uses(cVarTemplate::eVAR_CLASS)) {
+		uclass = StringFrom(conn->mpUser->mClass);
+		values[cVarTemplate::eVAR_CLASS] = &uclass;
+	}
+
+	if (!cc && tpl.Uses(cVarTemplate::eVAR_CC)) {
+		ucc = conn->GetGeoCC(); // country code
+		values[cVarTemplate::eVAR_CC] = &ucc;
+	}
+
+	if (tpl.Uses(cVarTemplate::eVAR_CN)) {
+		ucn = conn->GetGeoCN(); // country name
+		values[cVarTemplate::eVAR_CN] = &ucn;
+	}
+
+	if (tpl.Uses(cVarTemplate::eVAR_CITY)) {
+		uci = conn->GetGeoCI(); // city name
+		values[cVarTemplate::eVAR_CITY] = &uci;
+	}
+
+	if (tpl.Uses(cVarTemplate::eVAR_HOST))
+		values[cVarTemplate::eVAR_HOST] = &conn->AddrHost();
+
+	tpl.Render(dest, values);
+}
+
 int cServerDC::SendToAllWithNickCC(const string &start, const string &end, int cm, int cM, const string &cc_zone)
 {
 	string str;
@@ -840,48 +852,29 @@ int cServerDC::SendToAllWithNickCC(const string &start, const string &end, int c
 
 int cServerDC::SendToAllWithNickCCVars(const string &start, const string &end, int cm, int cM, const string &cc_zone)
 {
-	string str, tend;
+	cVarTemplate tpl(end); // parse variables once
+	string str, ucc;
 	cConnDC *conn;
 	tCLIt it;
 	int tot = 0;
-	size_t pos;
 
 	for (it = mConnList.begin(); it != mConnList.end(); it++) {
 		conn = (cConnDC*)(*it);
 
 		if (conn && conn->ok && conn->mpUser && conn->mpUser->mInList && (conn->mpUser->mClass >= cm) && (conn->mpUser->mClass <= cM)) {
-			str = conn->GetGeoCC(); // country code
-
-			if (cc_zone.find(str) != cc_zone.npos) {
-				tend = end;
-				ReplaceVarInString(tend, "NICK", tend, conn->mpUser->mNick); // replace variables
-				ReplaceVarInString(tend, "CLASS", tend, conn->mpUser->mClass);
-				pos = tend.find("%[C");
-
-				if (pos != tend.npos) { // only if found
-					if (tend.find("%[CC]", pos) != tend.npos)
-						ReplaceVarInString(tend, "CC", tend, str);
-
-					if (tend.find("%[CN]", pos) != tend.npos) {
-						str = conn->GetGeoCN(); // country name
-						ReplaceVarInString(tend, "CN", tend, str);
-					}
-
-					if (tend.find("%[CITY]", pos) != tend.npos) {
-						str = conn->GetGeoCI(); // city name
-						ReplaceVarInString(tend, "CITY", tend, str);
-					}
-				}
+			ucc = conn->GetGeoCC(); // country code
 
-				ReplaceVarInString(tend, "IP", tend, conn->AddrIP());
-				ReplaceVarInString(tend, "HOST", tend, conn->AddrHost());
+			if (cc_zone.find(ucc) != cc_zone.npos) {
+				str.clear(); // buffer is reused for all users
 
 #ifdef USE_BUFFER_RESERVE
-				if (str.capacity() < (start.size() + conn->mpUser->mNick.size() + tend.size() + 1)) // reserve for pipe
-					str.reserve(start.size() + conn->mpUser->mNick.size() + tend.size() + 1);
+				if (str.capacity() < (start.size() + conn->mpUser->mNick.size() + end.size() + 1)) // reserve for pipe
+					str.reserve(start.size() + conn->mpUser->mNick.size() + end.size() + 1);
 #endif
 
-				str = start + conn->mpUser->mNick + tend; // finalize
+				str.append(start);
+				str.append(conn->mpUser->mNick);
+				RenderUserVars(tpl, conn, str, &ucc);
 				conn->Send(str, true); // pipe is added by default for safety
 				tot++;
 			}
@@ -891,162 +884,141 @@ int cServerDC::SendToAllWithNickCCVars(const string &start, const string &end, i
 	return tot;
 }
 
-unsigned int cServerDC::SearchToAll(cConnDC *conn, string &data, string &tths, bool passive, bool tth)
+unsigned int cServerDC::SearchToAll(cConnDC *conn, string &data, string &tths, bool passive, bool tth, unsigned __int64 *sent)
 {
 	cConnDC *other;
-	tCLIt i;
+	cUser *user;
+	vector<cUserBase*>::iterator i;
 	unsigned int count = 0;
+	unsigned __int64 bytes = 0;
 	size_t saved = 0, len_data = data.size(), len_tths = tths.size();
-#ifdef USE_BUFFER_RESERVE
-	string _tths, _data;
-	_tths.reserve(tths.size() + 1); // first use, reserve for pipe
-	_tths = tths;
-	_data.reserve(data.size() + 1);
-	_data = data;
-#endif
+	cSendSegment *seg_data = cSendSegment::New(), *seg_tths = cSendSegment::New(); // one copy of each message shared by all users
+	AppendReservePlusPipe(seg_data->mData, data, true);
+	data.erase(len_data, 1);
 
-	if (len_tths)
+	if (len_tths) {
 		saved = len_data - len_tths;
+		AppendReservePlusPipe(seg_tths->mData, tths, true);
+		tths.erase(len_tths, 1);
+	}
 
-	if (passive) { // passive search
-		for (i = mConnList.begin(); i != mConnList.end(); i++) {
-			other = (cConnDC*)(*i);
+	/*
+		index holds only users with share that are not pingers or here only to chat
+		bits of search key selected by mask must be equal to need
+	*/
+	int key, mask = 0, need = 0;
 
-			if (!other || !other->ok || !other->mpUser || !other->mpUser->mInList) // base condition
-				continue;
+	if (passive) // passive request to passive user, allow if other user supports nat connection
+		mask |= eSK_PASSIVE;
 
-			if (other->mpUser->mPassive && !(other->mpUser->mMyFlag & eMF_NAT)) // passive request to passive user, allow if other user supports nat connection
-				continue;
+	if (tth) { // dont send to user without tth search support
+		mask |= eSK_TTH;
+		need |= eSK_TTH;
+	}
 
-			if (tth && !(other->mFeatures & eSF_TTHSEARCH)) // dont send to user without tth search support
-				continue;
+	if (!passive && mC.filter_lan_requests) { // filter lan to wan and reverse
+		mask |= eSK_LAN;
 
-			if (other->mFeatures & eSF_CHATONLY) // dont send to user who is here only to chat
-				continue;
+		if (conn->mpUser->mLan)
+			need |= eSK_LAN;
+	}
 
-			if (other->mpUser->mShare <= 0) // dont send to user without share
-				continue;
+	for (key = 0; key < eSK_COUNT; key++) {
+		if ((key & mask) != need)
+			continue;
 
-			if (other->mpUser->mHideShare) // dont send to user with hidden share
-				continue;
+		for (i = mSearchIndex[key].mUsers.begin(); i != mSearchIndex[key].mUsers.end(); ++i) {
+			user = (cUser*)(*i);
+			other = user->mxConn;
 
-			if (other->mpUser->mClass < eUC_NORMUSER) // dont send to pinger
+			if (!other || !other->ok || !user->mInList) // base condition
 				continue;
 
-			if (other->mpUser->mNickHash == conn->mpUser->mNickHash) // dont send to self
+			if (user->mNickHash == conn->mpUser->mNickHash) // dont send to self
 				continue;
 
 			if (tth && len_tths && (other->mFeatures & eSF_TTHS)) {
 				mProtoSaved[1] += saved; // add saved upload with tths
-#ifdef USE_BUFFER_RESERVE
-				other->Send(_tths, true, !mC.delayed_search);
-#else
-				other->Send(tths, true, !mC.delayed_search);
-#endif
+				other->SendShared(seg_tths, !mC.delayed_search);
+				bytes += seg_tths->mData.size();
 			} else {
-#ifdef USE_BUFFER_RESERVE
-				other->Send(_data, true, !mC.delayed_search);
-#else
-				other->Send(data, true, !mC.delayed_search);
-#endif
+				other->SendShared(seg_data, !mC.delayed_search);
+				bytes += seg_data->mData.size();
 			}
 
 			count++;
 		}
+	}
 
-	} else { // active search
-		if (mC.filter_lan_requests) { // filter lan requests
-			for (i = mConnList.begin(); i != mConnList.end(); i++) {
-				other = (cConnDC*)(*i);
-
-				if (!other || !other->ok || !other->mpUser || !other->mpUser->mInList) // base condition
-					continue;
-
-				if (tth && !(other->mFeatures & eSF_TTHSEARCH)) // dont send to user without tth search support
-					continue;
-
-				if (other->mFeatures & eSF_CHATONLY) // dont send to user who is here only to chat
-					continue;
-
-				if (other->mpUser->mShare <= 0) // dont send to user without share
-					continue;
-
-				if (other->mpUser->mHideShare) // dont send to user with hidden share
-					continue;
+	seg_data->UnRef();
+	seg_tths->UnRef();
 
-				if (other->mpUser->mClass < eUC_NORMUSER) // dont send to pinger
-					continue;
+	if (sent)
+		*sent = bytes;
 
-				if (other->mpUser->mNickHash == conn->mpUser->mNickHash) // dont send to self
-					continue;
+	return count;
+}
 
-				if (conn->mpUser->mLan != other->mpUser->mLan) // filter lan to wan and reverse
-					continue;
+unsigned int cServerDC::TTHSearchToAll(cConnDC *conn, string &data, string &tths, bool passive, const cChunkView &root, const string &addr)
+{
+	if (!mC.tth_search_window)
+		return SearchToAll(conn, data, tths, passive, true);
 
-				if (tth && len_tths && (other->mFeatures & eSF_TTHS)) {
-					mProtoSaved[1] += saved; // add saved upload with tths
-#ifdef USE_BUFFER_RESERVE
-					other->Send(_tths, true, !mC.delayed_search);
-#else
-					other->Send(tths, true, !mC.delayed_search);
-#endif
-				} else {
+	string key;
 #ifdef USE_BUFFER_RESERVE
-					other->Send(_data, true, !mC.delayed_search);
-#else
-					other->Send(data, true, !mC.delayed_search);
+	key.reserve(1 + root.Size() + addr.size());
 #endif
-				}
+	key.append(1, (passive ? 'P' : 'A'));
+	root.AppendTo(key);
 
-				count++;
-			}
+	if (!passive) // active results go straight to searcher, so only his own search can be dropped
+		key.append(addr);
+
+	const __int64 now = mTime.MiliSec();
+	tTTHSearchMap::iterator it = mTTHSearches.find(key);
 
-		} else { // dont filter lan requests
-			for (i = mConnList.begin(); i != mConnList.end(); i++) {
-				other = (cConnDC*)(*i);
+	if ((it != mTTHSearches.end()) && ((now - it->second.mTime) < ((__int64)mC.tth_search_window * 1000))) { // sent moments ago
+		sTTHSearch &item = it->second;
 
-				if (!other || !other->ok || !other->mpUser || !other->mpUser->mInList) // base condition
-					continue;
+		if (passive && (item.mNick != conn->mpUser->mNick) && (find(item.mMerged.begin(), item.mMerged.end(), conn->mpUser->mNick) == item.mMerged.end()))
+			item.mMerged.push_back(conn->mpUser->mNick);
 
-				if (tth && !(other->mFeatures & eSF_TTHSEARCH)) // dont send to user without tth search support
-					continue;
+		mProtoSaved[2] += item.mBytes; // add saved upload with merged tth searches
+		return 0;
+	}
 
-				if (other->mFeatures & eSF_CHATONLY) // dont send to user who is here only to chat
-					continue;
+	unsigned __int64 bytes = 0;
+	const unsigned int count = SearchToAll(conn, data, tths, passive, true, &bytes);
+	sTTHSearch &item = mTTHSearches[key]; // an older entry keeps its merged users, they still wait for results
+	item.mTime = now;
+	item.mBytes = bytes;
 
-				if (other->mpUser->mShare <= 0) // dont send to user without share
-					continue;
+	if (passive) {
+		item.mNick = conn->mpUser->mNick;
+		vector<string>::iterator self = find(item.mMerged.begin(), item.mMerged.end(), item.mNick);
 
-				if (other->mpUser->mHideShare) // dont send to user with hidden share
-					continue;
+		if (self != item.mMerged.end())
+			item.mMerged.erase(self);
+	}
 
-				if (other->mpUser->mClass < eUC_NORMUSER) // dont send to pinger
-					continue;
+	return count;
+}
 
-				if (other->mpUser->mNickHash == conn->mpUser->mNickHash) // dont send to self
-					continue;
+void cServerDC::PurgeTTHSearches()
+{
+	if (mTTHSearches.empty())
+		return;
 
-				if (tth && len_tths && (other->mFeatures & eSF_TTHS)) {
-					mProtoSaved[1] += saved; // add saved upload with tths
-#ifdef USE_BUFFER_RESERVE
-					other->Send(_tths, true, !mC.delayed_search);
-#else
-					other->Send(tths, true, !mC.delayed_search);
-#endif
-				} else {
-#ifdef USE_BUFFER_RESERVE
-					other->Send(_data, true, !mC.delayed_search);
-#else
-					other->Send(data, true, !mC.delayed_search);
-#endif
-				}
+	const __int64 keep = (__int64)mC.tth_search_window * 2000; // merged users get results for at least one more window
+	const __int64 now = mTime.MiliSec();
+	tTTHSearchMap::iterator it = mTTHSearches.begin();
 
-				count++;
-			}
-		}
+	while (it != mTTHSearches.end()) {
+		if ((now - it->second.mTime) >= keep)
+			it = mTTHSearches.erase(it);
+		else
+			++it;
 	}
-
-	return count;
 }
 
 unsigned int cServerDC::CollectExtJSON(string &dest, cConnDC *conn)
@@ -1515,6 +1487,140 @@ bool cServerDC::MinDelay(cTime &then, unsigned int min, bool update)
 	return false;
 }
 
+void cServerDC::FlushMyINFOQueue()
+{
+	if (mMyINFOQueue.empty())
+		return;
+
+	vector<tUserHash>::iterator it, keep = mMyINFOQueue.begin();
+	cUser *user;
+	string data;
+
+	for (it = mMyINFOQueue.begin(); it != mMyINFOQueue.end(); ++it) {
+		user = mUserList.GetUserByHash(*it);
+
+		if (!user || !user->mMyINFOPending) // user has left or was already sent
+			continue;
+
+		if (!MinDelay(user->mT.info, mC.int_myinfo)) { // too early, keep waiting
+			*keep++ = *it;
+			continue;
+		}
+
+		user->mMyINFOPending = false;
+#ifdef USE_BUFFER_RESERVE
+		if (data.capacity() < (user->mMyINFO.size() + 1))
+			data.reserve(user->mMyINFO.size() + 1); // reserve for pipe
+#endif
+		data = user->mMyINFO; // only latest version is sent
+		mUserList.SendToAll(data, true, true); // cache it, all queued users go out in one write
+	}
+
+	mMyINFOQueue.erase(keep, mMyINFOQueue.end());
+}
+
+cSendSegment* cServerDC::GetZippedSegment(cSendSegment *seg)
+{
+	vector<tZipCacheItem>::reverse_iterator it;
+
+	for (it = mZipCache.rbegin(); it != mZipCache.rend(); ++it) { // latest broadcast is usually the one asked for
+		if (it->first == seg) {
+			mZipCacheHits++;
+			return it->second;
+		}
+	}
+
+	mZipCacheMisses++;
+	cSendSegment *zip = NULL;
+	const size_t size = seg->mData.size();
+
+	if (size && (seg->mData[size - 1] == '|')) { // client fails to decompress data without ending pipe
+		size_t zip_size = 0;
+		int err = 0;
+		const char *zip_buf = mZLib->Compress(seg->mData.data(), size, zip_size, err, mC.zlib_compress_level);
+
+		if (zip_buf && zip_size) { // otherwise compression is larger than data or failed
+			zip = cSendSegment::New();
+			zip->mData.assign(zip_buf, zip_size);
+		}
+	}
+
+	seg->Ref(); // keep address of source segment until cache is cleared
+	mZipCache.push_back(tZipCacheItem(seg, zip)); // remember failures too, dont try again for every user
+	return zip;
+}
+
+void cServerDC::OnUserClassChange(cUser *user)
+{
+	UpdateSearchRecipient(user);
+	mUserList.OnClassChange(user);
+	mOpList.OnClassChange(user);
+	mOpchatList.OnClassChange(user);
+	mActiveUsers.OnClassChange(user);
+	mPassiveUsers.OnClassChange(user);
+	mChatUsers.OnClassChange(user);
+	mRobotList.OnClassChange(user);
+}
+
+int cServerDC::SearchKey(cUser *user) const
+{
+	if (!user->mxConn || !user->mInList) // real users in list
+		return -1;
+
+	if (user->mxConn->mFeatures & eSF_CHATONLY) // here only to chat
+		return -1;
+
+	if ((user->mShare <= 0) || user->mHideShare) // no share or hidden share
+		return -1;
+
+	if (user->mClass < eUC_NORMUSER) // pinger
+		return -1;
+
+	int key = 0;
+
+	if (user->mPassive && !(user->mMyFlag & eMF_NAT))
+		key |= eSK_PASSIVE;
+
+	if (user->mxConn->mFeatures & eSF_TTHSEARCH)
+		key |= eSK_TTH;
+
+	if (user->mLan)
+		key |= eSK_LAN;
+
+	return key;
+}
+
+void cServerDC::UpdateSearchRecipient(cUser *user)
+{
+	if (!user)
+		return;
+
+	const int key = SearchKey(user);
+
+	if (key == user->mSearchKey)
+		return;
+
+	if (user->mSearchKey >= 0)
+		mSearchIndex[user->mSearchKey].Remove(user);
+
+	if (key >= 0)
+		mSearchIndex[key].Add(user);
+
+	user->mSearchKey = key;
+}
+
+void cServerDC::ClearZipCache()
+{
+	for (vector<tZipCacheItem>::iterator it = mZipCache.begin(); it != mZipCache.end(); ++it) {
+		it->first->UnRef();
+
+		if (it->second)
+			it->second->UnRef(); // users who still have it queued keep their reference
+	}
+
+	mZipCache.clear();
+}
+
 bool cServerDC::MinDelayMS(cTime &then, unsigned long min, bool update)
 {
 	/*
@@ -1826,7 +1932,10 @@ tVAL_NICK cServerDC::ValidateNick(cConnDC *conn, const string &nick, string &mor
 
 int cServerDC::OnTimer(const cTime &now)
 {
+	FlushMyINFOQueue();
 	mUserList.FlushCache();
+	ClearZipCache(); // flushes above may still use compressed broadcasts
+	PurgeTTHSearches();
 	//mOpList.FlushCache(); // we are not sending anything to operators, only nicks are used
 	mOpchatList.FlushCache();
 	mActiveUsers.FlushCache();
@@ -3074,6 +3183,7 @@ int cServerDC::SetConfig(const char *conf, const char *var, const char *val, str
 
 				} else if (svar == "hub_security_desc") {
 					mP.Create_MyINFO(mHubSec->mMyINFO, mHubSec->mNick, val_new + tag, flag, mail, shar, false); // send new myinfo, dont reserve for pipe, we are not sending this
+					mUserList.OnInfoChange(mHubSec);
 #ifdef USE_BUFFER_RESERVE
 					data.reserve(mHubSec->mMyINFO.size() + 1); // first use, reserve for pipe
 #endif
@@ -3083,6 +3193,7 @@ int cServerDC::SetConfig(const char *conf, const char *var, const char *val, str
 				} else if (svar == "opchat_desc") {
 					if (mOpChat) {
 						mP.Create_MyINFO(mOpChat->mMyINFO, mOpChat->mNick, val_new + tag, flag, mail, shar, false); // send new myinfo, dont reserve for pipe, we are not sending this
+						mUserList.OnInfoChange(mOpChat);
 #ifdef USE_BUFFER_RESERVE
 						data.reserve(mOpChat->mMyINFO.size() + 1); // first use, reserve for pipe
 #endif
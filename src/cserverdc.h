@@ -180,6 +180,10 @@ namespace nVerliHub {
 		class cDCConnFactory;
 	};
 
+	namespace nUtils {
+		class cVarTemplate;
+	};
+
 	//using namespace nConfig;
 	using namespace nUtils;
 	using namespace nProtocol;
@@ -517,7 +521,62 @@ class cServerDC : public cAsyncSocketServer
 				tth: tth search flag
 				return: send count
 		*/
-		unsigned int SearchToAll(cConnDC *conn, string &data, string &tths, bool passive, bool tth = true);
+		unsigned int SearchToAll(cConnDC *conn, string &data, string &tths, bool passive, bool tth = true, unsigned __int64 *sent = NULL);
+
+		/*
+			send tth search to all unless same root was sent within tth_search_window
+			repeated active search from same address is dropped, its results already go there
+			passive search of another user is merged, results to first searcher are copied to him
+				conn: sender connection
+				data: long search command
+				tths: short tth search command
+				passive: search mode flag
+				root: tth root without prefix
+				addr: address of active searcher
+				return: send count, zero when search was merged or dropped
+		*/
+		unsigned int TTHSearchToAll(cConnDC *conn, string &data, string &tths, bool passive, const cChunkView &root, const string &addr);
+
+		/*
+			forget tth searches whose results are no longer routed
+		*/
+		void PurgeTTHSearches();
+
+		/*
+			compressed copy of broadcast segment for zlib users whose flush buffer holds nothing else
+			segment is compressed once and cached until next timer, so all recipients share the same block
+				seg: broadcast segment ending with pipe
+				return: compressed segment or null if compression does not pay off
+		*/
+		cSendSegment* GetZippedSegment(cSendSegment *seg);
+
+		/*
+			move user to new class in recipient indexes of all lists, call after changing class of logged in user
+				user: user whose class was changed
+		*/
+		void OnUserClassChange(cUser *user);
+
+		/*
+			move user to right bucket of search recipient index, call after anything that SearchKey depends on has changed
+				user: user to update
+		*/
+		void UpdateSearchRecipient(cUser *user);
+
+		/*
+			search recipient bucket of user
+				user: user to check
+				return: bucket or -1 if user should not receive searches
+		*/
+		int SearchKey(cUser *user) const;
+
+		/*
+			append template rendered with variables of user, geo lookups are done only for variables in template
+				tpl: compiled template
+				conn: recipient connection with user
+				dest: buffer to append to
+				cc: country code if already known
+		*/
+		void RenderUserVars(const cVarTemplate &tpl, cConnDC *conn, string &dest, const string *cc = NULL);
 
 		/*
 			ExtJSON collector
@@ -649,6 +708,43 @@ class cServerDC : public cAsyncSocketServer
 		cUserCollection mPassiveUsers; // passive users
 		cUserCollection mChatUsers; // users who receive main chat
 		cUserCollection mRobotList; // bot list
+		vector<tUserHash> mMyINFOQueue; // users whose changed myinfo waits for next broadcast
+
+		// broadcasts compressed during current timer period, source segment is referenced so its address can not be reused before cache is cleared
+		typedef pair<cSendSegment*, cSendSegment*> tZipCacheItem;
+		vector<tZipCacheItem> mZipCache;
+		unsigned long mZipCacheHits;
+		unsigned long mZipCacheMisses;
+
+		/*
+			users who receive searches, bucketed by the conditions that select them
+			a search walks only buckets it can reach, see SearchKey
+		*/
+		enum {
+			eSK_PASSIVE = 1, // passive without nat, cant receive passive searches
+			eSK_TTH = 2, // supports tth search
+			eSK_LAN = 4, // lan user
+			eSK_COUNT = 8
+		};
+
+		cUserCollection::sUserBucket mSearchIndex[eSK_COUNT];
+
+		// tth search sent to all during last tth_search_window seconds
+		struct sTTHSearch
+		{
+			__int64 mTime; // miliseconds of last broadcast
+			unsigned __int64 mBytes; // bytes sent by last broadcast
+			string mNick; // nick that passive results are addressed to, empty for active search
+			vector<string> mMerged; // passive searchers who get copies of results to above nick
+
+			sTTHSearch():
+				mTime(0),
+				mBytes(0)
+			{}
+		};
+
+		typedef unordered_map<string, sTTHSearch> tTTHSearchMap;
+		tTTHSearchMap mTTHSearches; // key is mode, root and address of active searcher
 
 		// prevent stack trace on core dump
 		static bool mStackTrace;
@@ -770,6 +866,17 @@ protected: // Protected methods
 	*/
 	bool MinDelayMS(cTime &then, unsigned long min, bool update = false);
 
+	/**
+	* Broadcast latest MyINFO of queued users whose int_myinfo delay has passed.
+	* Messages are cached and written with next flush of user list.
+	*/
+	void FlushMyINFOQueue();
+
+	/**
+	* Drop broadcasts compressed during last timer period.
+	*/
+	void ClearZipCache();
+
 	/**
 	* This method is triggered when there is a new incoming connection.
 	*
@@ -806,8 +913,8 @@ public:
 
 	// protocol total download = 0 and upload = 1
 	unsigned __int64 mProtoTotal[2];
-	// saved upload data with zlib = 0 and tths = 1
-	unsigned __int64 mProtoSaved[2];
+	// saved upload data with zlib = 0, tths = 1 and merged tth searches = 2
+	unsigned __int64 mProtoSaved[3];
 
 	// Usercount of zones (CC and IP-range zones)
 	unsigned int mUserCount[USER_ZONES + 1];
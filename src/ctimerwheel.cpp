@@ -0,0 +1,102 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "ctimerwheel.h"
+#include "casyncconn.h"
+
+namespace nVerliHub {
+	namespace nSocket {
+
+cTimerWheel::cTimerWheel(unsigned int slots):
+	mSlots(slots ? slots : 1),
+	mLast(0),
+	mSize(0)
+{}
+
+cTimerWheel::~cTimerWheel()
+{}
+
+void cTimerWheel::Schedule(cAsyncConn *conn, long due)
+{
+	if (!conn)
+		return;
+
+	if (due <= mLast) // already passed, visit on next expiration
+		due = mLast + 1;
+
+	if (conn->mTimerDue) {
+		if (conn->mTimerDue <= due) // keep earlier deadline
+			return;
+
+		Cancel(conn);
+	}
+
+	tSlot &slot = mSlots[due % mSlots.size()];
+	conn->mTimerDue = due;
+	conn->mTimerIt = slot.insert(slot.end(), conn);
+	mSize++;
+}
+
+void cTimerWheel::Cancel(cAsyncConn *conn)
+{
+	if (!conn || !conn->mTimerDue)
+		return;
+
+	mSlots[conn->mTimerDue % mSlots.size()].erase(conn->mTimerIt);
+	conn->mTimerDue = 0;
+	mSize--;
+}
+
+void cTimerWheel::Expire(long now, vector<cAsyncConn*> &expired)
+{
+	expired.clear();
+
+	if (!mLast) // first call, visit all slots
+		mLast = now - mSlots.size();
+
+	if (now <= mLast)
+		return;
+
+	long from = mLast + 1;
+
+	if ((now - from) >= (long)mSlots.size()) // visit every slot only once
+		from = now - mSlots.size() + 1;
+
+	for (long sec = from; sec <= now; ++sec) {
+		tSlot &slot = mSlots[sec % mSlots.size()];
+		tSlot::iterator it = slot.begin();
+
+		while (it != slot.end()) {
+			if ((*it)->mTimerDue <= now) {
+				(*it)->mTimerDue = 0;
+				expired.push_back(*it);
+				it = slot.erase(it);
+				mSize--;
+			} else { // deadline in one of next turns
+				++it;
+			}
+		}
+	}
+
+	mLast = now;
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
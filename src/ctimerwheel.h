@@ -0,0 +1,81 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCTIMERWHEEL_H
+#define NSOCKETCTIMERWHEEL_H
+
+#include <list>
+#include <vector>
+
+using std::list;
+using std::vector;
+
+namespace nVerliHub {
+	namespace nSocket {
+		class cAsyncConn;
+
+/**
+* Hashed timer wheel with one second resolution for connection deadlines.
+*
+* Every connection has at most one deadline, it is stored in slot given by deadline modulo number of slots,
+* so scheduling and cancelling are constant time and only slots passed since last call are visited on expiration.
+* Deadlines further than one turn of the wheel stay in their slot until their time comes.
+*/
+class cTimerWheel
+{
+public:
+	cTimerWheel(unsigned int slots = 512);
+	~cTimerWheel();
+
+	/**
+	* Make sure connection is visited not later than given time.
+	* Earlier deadline that is already set is kept.
+	* @param conn The connection.
+	* @param due Deadline in seconds, zero or past time means next expiration.
+	*/
+	void Schedule(cAsyncConn *conn, long due);
+
+	/// Remove deadline of given connection.
+	void Cancel(cAsyncConn *conn);
+
+	/**
+	* Collect connections whose deadline has passed, they are removed from the wheel.
+	* @param now Current time in seconds.
+	* @param expired Filled with expired connections.
+	*/
+	void Expire(long now, vector<cAsyncConn*> &expired);
+
+	/// Number of scheduled connections.
+	unsigned long Size() const
+	{
+		return mSize;
+	}
+
+private:
+	typedef list<cAsyncConn*> tSlot;
+	vector<tSlot> mSlots;
+	long mLast; // last expired second
+	unsigned long mSize;
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
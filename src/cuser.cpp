@@ -62,6 +62,9 @@ bool cUserBase::HasFeature(unsigned feature)
 void cUserBase::Send(string &data, bool, bool)
 {}
 
+void cUserBase::SendShared(nSocket::cSendSegment *seg, bool)
+{}
+
 cUser::cUser(const string &nick):
 	cUserBase(nick),
 	mxConn(NULL),
@@ -96,6 +99,8 @@ cUser::cUser(const string &nick):
 	mHideChat = false;
 	mHideCtmMsg = false;
 	mSetPass = false;
+	mMyINFOPending = false;
+	mSearchKey = -1;
 	mPassive = true;
 	mLan = false;
 	memset(mFloodHashes, 0, sizeof(mFloodHashes));
@@ -117,6 +122,11 @@ void cUser::Send(string &data, bool pipe, bool flush)
 	mxConn->Send(data, pipe, flush);
 }
 
+void cUser::SendShared(nSocket::cSendSegment *seg, bool flush)
+{
+	mxConn->SendShared(seg, flush);
+}
+
 /** return true if user needs a password and the password is correct */
 bool cUser::CheckPwd(const string &pwd)
 {
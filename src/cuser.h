@@ -27,6 +27,7 @@
 #include "cfreqlimiter.h"
 #include "cpenaltylist.h"
 #include "ctime.h"
+#include "tobjpool.h"
 
 using namespace std;
 
@@ -129,12 +130,13 @@ public:
 	virtual bool CanSend();
 	virtual bool HasFeature(unsigned feature);
 	virtual void Send(string &data, bool pipe, bool flush = true);
+	virtual void SendShared(nSocket::cSendSegment *seg, bool flush = true);
 public:
 	// users myinfo parts
 	string mNick;
 
-	// store user nick hash and use it as much as possible instead of nick
-	typedef unsigned long tHashType;
+	// store user nick hash and use it as much as possible instead of nick, same type as in user collection
+	typedef unsigned long long tHashType;
 	tHashType mNickHash;
 
 	/*
@@ -168,9 +170,21 @@ public:
 	virtual ~cUser()
 	{}
 
+	// memory of users who left is reused by new ones, robots are allocated normally
+	static void* operator new(size_t size)
+	{
+		return nUtils::tObjPool<cUser>::Alloc(size);
+	}
+
+	static void operator delete(void *ptr, size_t size)
+	{
+		nUtils::tObjPool<cUser>::Free(ptr, size);
+	}
+
 	virtual bool CanSend();
 	virtual bool HasFeature(unsigned feature);
 	virtual void Send(string &data, bool pipe, bool flush = true);
+	virtual void SendShared(nSocket::cSendSegment *seg, bool flush = true);
 
 	/** check for the right to ... */
 	inline int HaveRightTo(unsigned int mask){ return mRights & mask; }
@@ -268,6 +282,10 @@ public:
 	bool mHideCtmMsg;
 	// set password request flag
 	bool mSetPass;
+	// changed myinfo waits in server queue for next broadcast
+	bool mMyINFOPending;
+	// bucket of search recipient index in server, -1 when user does not receive searches
+	int mSearchKey;
 	/** class protection against kicking */
 	int mProtectFrom;
 	/* Numeber of searches */
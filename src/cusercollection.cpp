@@ -19,18 +19,22 @@
 */
 
 #include <algorithm>
+#include <string.h>
 #include "cuser.h"
 #include "cusercollection.h"
+#include "czlib.h"
 
 using namespace std;
 
 namespace nVerliHub {
 	using namespace nUtils;
+	using namespace nEnums;
+	using nSocket::cSendSegment;
 
 void cUserCollection::ufSend::operator()(cUserBase *user)
 {
 	if (user && user->CanSend())
-		user->Send(mData, false, !mCache); // no pipe
+		user->SendShared(mSeg, !mCache); // segment already contains pipe
 }
 
 void cUserCollection::ufSendWithNick::operator()(cUserBase *user)
@@ -48,26 +52,27 @@ void cUserCollection::ufSendWithNick::operator()(cUserBase *user)
 void cUserCollection::ufSendWithClass::operator()(cUserBase *user)
 {
 	if (user && user->CanSend() && (user->mClass <= mMaxClass) && (user->mClass >= mMinClass))
-		user->Send(mData, false, !mCache); // no pipe
+		user->SendShared(mSeg, !mCache); // segment already contains pipe
 }
 
 void cUserCollection::ufSendWithFeature::operator()(cUserBase *user)
 {
 	if (user && user->CanSend() && user->HasFeature(mFeature))
-		user->Send(mData, false, !mCache); // no pipe
+		user->SendShared(mSeg, !mCache); // segment already contains pipe
 }
 
 void cUserCollection::ufSendWithClassFeature::operator()(cUserBase *user)
 {
 	if (user && user->CanSend() && (user->mClass <= mMaxClass) && (user->mClass >= mMinClass) && user->HasFeature(mFeature))
-		user->Send(mData, false, !mCache); // no pipe
+		user->SendShared(mSeg, !mCache); // segment already contains pipe
 }
 
 cUserCollection::cUserCollection(const bool keep_nick, const bool keep_info, const bool keep_ip):
-	tHashArray<cUserBase*>(512), // todo: why so large array for small hubs? can we make it smaller? how is it extended?
+	tDenseHashArray<cUserBase*>(64), // grows with number of users
 	mNickListMaker(mNickList),
 	mInfoListMaker(mInfoList),
 	mIPListMaker(mIPList),
+	mClassIndexed(false),
 	mKeepNickList(keep_nick),
 	mKeepInfoList(keep_info),
 	mKeepIPList(keep_ip),
@@ -151,70 +156,215 @@ bool cUserCollection::Remove(cUserBase *user)
 	return false;
 }
 
+void cUserCollection::ufDoNickList::Remove(cUserBase *user)
+{
+	unordered_map<cUserBase*, size_t>::iterator it = mSlotIndex.find(user);
+
+	if (it == mSlotIndex.end())
+		return;
+
+	sSlot &slot = mSlots[it->second];
+	mDead += slot.mLen;
+	slot.mLen = 0;
+	mSlotIndex.erase(it);
+	mGen++;
+
+	if ((mDead * 4) > mList.size()) // compact when a quarter of list is removed entries
+		Compact();
+}
+
+void cUserCollection::ufDoNickList::Compact()
+{
+	if (mSlots.empty())
+		return;
+
+	size_t pos = mSlots.front().mPos, keep = 0;
+	char *data = &mList[0];
+
+	for (vector<sSlot>::iterator it = mSlots.begin(); it != mSlots.end(); ++it) {
+		if (!it->mLen)
+			continue;
+
+		if (it->mPos != pos)
+			memmove(data + pos, data + it->mPos, it->mLen);
+
+		it->mPos = pos;
+		pos += it->mLen;
+		mSlotIndex[it->mUser] = keep;
+		mSlots[keep++] = *it;
+	}
+
+	mSlots.resize(keep, sSlot(NULL, 0, 0));
+	mList.resize(pos);
+	mDead = 0;
+	mCompacts++;
+}
+
+void cUserCollection::ufDoNickList::CopyList(string &dest, const bool pipe)
+{
+#ifdef USE_BUFFER_RESERVE
+	if (dest.capacity() < (mList.size() - mDead + (pipe ? 1 : 0)))
+		dest.reserve((mList.size() - mDead + (pipe ? 1 : 0)));
+#endif
+
+	if (!mDead) {
+		dest = mList;
+		return;
+	}
+
+	size_t start = mSlots.front().mPos, end = start; // copy runs of entries between removed ones
+	dest.assign(mList, 0, start);
+
+	for (vector<sSlot>::const_iterator it = mSlots.begin(); it != mSlots.end(); ++it) {
+		if (!it->mLen)
+			continue;
+
+		if (it->mPos != end) {
+			dest.append(mList, start, end - start);
+			start = it->mPos;
+		}
+
+		end = it->mPos + it->mLen;
+	}
+
+	dest.append(mList, start, end - start);
+}
+
+cSendSegment* cUserCollection::ufDoNickList::Zipped(cZLib *zlib, const int level, const size_t min_len, const bool pipe, size_t &size)
+{
+	size = mList.size() - mDead + (pipe ? 1 : 0);
+
+	if (!zlib || (size < min_len))
+		return NULL;
+
+	if ((mZippedGen == mGen) && (mZippedLevel == level)) // list has not changed since, may be NULL if it did not compress
+		return mZipped;
+
+	if (mZipped) {
+		mZipped->UnRef(); // users who still have it queued keep their reference
+		mZipped = NULL;
+	}
+
+	string list;
+	CopyList(list, pipe);
+
+	if (pipe)
+		list.append(1, '|');
+
+	size_t zip_size = 0;
+	int err = 0;
+	const char *zip = zlib->Compress(list.data(), list.size(), zip_size, err, level);
+
+	if (zip && zip_size) {
+		mZipped = cSendSegment::New();
+		mZipped->mData.assign(zip, zip_size);
+	}
+
+	mZippedGen = mGen;
+	mZippedLevel = level;
+	mZips++;
+	return mZipped;
+}
+
+void cUserCollection::RemakeList(ufDoNickList &maker)
+{
+	maker.Clear();
+
+	for (iterator it = begin(); it != end(); ++it)
+		maker(*it);
+
+	maker.mRemakes++;
+}
+
 void cUserCollection::GetNickList(string &dest, const bool pipe)
 {
 	if (mRemakeNextNickList && mKeepNickList) {
-		mNickListMaker.Clear();
-		for_each(begin(), end(), mNickListMaker);
+		RemakeList(mNickListMaker);
 		mRemakeNextNickList = false;
 	}
 
-#ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (mNickList.size() + (pipe ? 1 : 0)))
-		dest.reserve((mNickList.size() + (pipe ? 1 : 0)));
-#endif
+	mNickListMaker.CopyList(dest, pipe);
+}
+
+cSendSegment* cUserCollection::GetZippedNickList(cZLib *zlib, const int level, const size_t min_len, size_t &size)
+{
+	size = 0;
+
+	if (!mKeepNickList)
+		return NULL;
+
+	if (mRemakeNextNickList) {
+		RemakeList(mNickListMaker);
+		mRemakeNextNickList = false;
+	}
 
-	dest = mNickList;
+	return mNickListMaker.Zipped(zlib, level, min_len, true, size);
 }
 
 void cUserCollection::GetInfoList(string &dest, const bool pipe)
 {
 	if (mRemakeNextInfoList && mKeepInfoList) {
-		mInfoListMaker.Clear();
-		for_each(begin(), end(), mInfoListMaker);
+		RemakeList(mInfoListMaker);
 		mRemakeNextInfoList = false;
 	}
 
-#ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (mInfoList.size() + (pipe ? 1 : 0)))
-		dest.reserve((mInfoList.size() + (pipe ? 1 : 0)));
-#endif
+	mInfoListMaker.CopyList(dest, pipe);
+}
+
+cSendSegment* cUserCollection::GetZippedInfoList(cZLib *zlib, const int level, const size_t min_len, size_t &size)
+{
+	size = 0;
+
+	if (!mKeepInfoList)
+		return NULL;
+
+	if (mRemakeNextInfoList) {
+		RemakeList(mInfoListMaker);
+		mRemakeNextInfoList = false;
+	}
 
-	dest = mInfoList;
+	return mInfoListMaker.Zipped(zlib, level, min_len, false, size);
 }
 
 void cUserCollection::GetIPList(string &dest, const bool pipe)
 {
 	if (mRemakeNextIPList && mKeepIPList) {
-		mIPListMaker.Clear();
-		for_each(begin(), end(), mIPListMaker);
+		RemakeList(mIPListMaker);
 		mRemakeNextIPList = false;
 	}
 
-#ifdef USE_BUFFER_RESERVE
-	if (dest.capacity() < (mIPList.size() + (pipe ? 1 : 0)))
-		dest.reserve((mIPList.size() + (pipe ? 1 : 0)));
-#endif
+	mIPListMaker.CopyList(dest, pipe);
+}
+
+cSendSegment* cUserCollection::GetZippedIPList(cZLib *zlib, const int level, const size_t min_len, size_t &size)
+{
+	size = 0;
+
+	if (!mKeepIPList)
+		return NULL;
 
-	dest = mIPList;
+	if (mRemakeNextIPList) {
+		RemakeList(mIPListMaker);
+		mRemakeNextIPList = false;
+	}
+
+	return mIPListMaker.Zipped(zlib, level, min_len, true, size);
 }
 
 void cUserCollection::SendToAll(string &data, const bool cache, const bool pipe)
 {
-	AppendReservePlusPipe(mSendAllCache, data, pipe);
+	cSendSegment *seg = cSendSegment::New(); // one copy of data shared by all users
+	AppendReservePlusPipe(seg->mData, data, pipe);
 
 	if (Log(4))
 		LogStream() << "Start SendToAll" << endl;
 
-	for_each(this->begin(), this->end(), ufSend(mSendAllCache, cache));
+	for_each(this->begin(), this->end(), ufSend(seg, cache));
 
 	if (Log(4))
 		LogStream() << "Stop SendToAll" << endl;
 
-	if (mSendAllCache.size())
-		mSendAllCache.clear();
-
-	ShrinkStringToFit(mSendAllCache);
+	seg->UnRef(); // users that did not send everything keep their own reference
 
 	if (pipe)
 		data.erase(data.size() - 1, 1);
@@ -227,20 +377,24 @@ void cUserCollection::SendToAllWithNick(string &start, string &end)
 
 void cUserCollection::SendToAllWithClass(string &data, const int min_class, const int max_class, const bool cache, const bool pipe)
 {
-	AppendReservePlusPipe(mSendAllCache, data, pipe);
+	cSendSegment *seg = cSendSegment::New(); // one copy of data shared by all users
+	AppendReservePlusPipe(seg->mData, data, pipe);
 
 	if (Log(4))
 		LogStream() << "Start SendToAllWithClass" << endl;
 
-	for_each(this->begin(), this->end(), ufSendWithClass(mSendAllCache, min_class, max_class, cache));
+	if (min_class <= max_class) {
+		BuildClassIndex();
+		const ufSendWithClass send(seg, min_class, max_class, cache); // still checks class, edge buckets hold classes out of range
+
+		for (unsigned i = ClassBucket(min_class); i <= ClassBucket(max_class); i++)
+			for_each(mClassIndex[i].mUsers.begin(), mClassIndex[i].mUsers.end(), send);
+	}
 
 	if (Log(4))
 		LogStream() << "Stop SendToAllWithClass" << endl;
 
-	if (mSendAllCache.size())
-		mSendAllCache.clear();
-
-	ShrinkStringToFit(mSendAllCache);
+	seg->UnRef(); // users that did not send everything keep their own reference
 
 	if (pipe)
 		data.erase(data.size() - 1, 1);
@@ -248,20 +402,19 @@ void cUserCollection::SendToAllWithClass(string &data, const int min_class, cons
 
 void cUserCollection::SendToAllWithFeature(string &data, const unsigned feature, const bool cache, const bool pipe)
 {
-	AppendReservePlusPipe(mSendAllCache, data, pipe);
+	cSendSegment *seg = cSendSegment::New(); // one copy of data shared by all users
+	AppendReservePlusPipe(seg->mData, data, pipe);
 
 	if (Log(4))
 		LogStream() << "Start SendToAllWithFeature" << endl;
 
-	for_each(this->begin(), this->end(), ufSendWithFeature(mSendAllCache, feature, cache));
+	sUserBucket &bucket = GetFeatureBucket(feature);
+	for_each(bucket.mUsers.begin(), bucket.mUsers.end(), ufSendWithFeature(seg, feature, cache));
 
 	if (Log(4))
 		LogStream() << "Stop SendToAllWithFeature" << endl;
 
-	if (mSendAllCache.size())
-		mSendAllCache.clear();
-
-	ShrinkStringToFit(mSendAllCache);
+	seg->UnRef(); // users that did not send everything keep their own reference
 
 	if (pipe)
 		data.erase(data.size() - 1, 1);
@@ -269,35 +422,152 @@ void cUserCollection::SendToAllWithFeature(string &data, const unsigned feature,
 
 void cUserCollection::SendToAllWithClassFeature(string &data, const int min_class, const int max_class, const unsigned feature, const bool cache, const bool pipe)
 {
-	AppendReservePlusPipe(mSendAllCache, data, pipe);
+	cSendSegment *seg = cSendSegment::New(); // one copy of data shared by all users
+	AppendReservePlusPipe(seg->mData, data, pipe);
 
 	if (Log(4))
 		LogStream() << "Start SendToAllWithClassFeature" << endl;
 
-	for_each(this->begin(), this->end(), ufSendWithClassFeature(mSendAllCache, min_class, max_class, feature, cache));
+	if (min_class <= max_class) {
+		BuildClassIndex();
+		sUserBucket &bucket = GetFeatureBucket(feature);
+		const ufSendWithClassFeature send(seg, min_class, max_class, feature, cache);
+		const unsigned first = ClassBucket(min_class), last = ClassBucket(max_class);
+		size_t count = 0;
+
+		for (unsigned i = first; i <= last; i++)
+			count += mClassIndex[i].mUsers.size();
+
+		if (bucket.mUsers.size() <= count) { // walk the smaller set, functor checks the other condition
+			for_each(bucket.mUsers.begin(), bucket.mUsers.end(), send);
+		} else {
+			for (unsigned i = first; i <= last; i++)
+				for_each(mClassIndex[i].mUsers.begin(), mClassIndex[i].mUsers.end(), send);
+		}
+	}
 
 	if (Log(4))
 		LogStream() << "Stop SendToAllWithClassFeature" << endl;
 
-	if (mSendAllCache.size())
-		mSendAllCache.clear();
-
-	ShrinkStringToFit(mSendAllCache);
+	seg->UnRef(); // users that did not send everything keep their own reference
 
 	if (pipe)
 		data.erase(data.size() - 1, 1);
 }
 
+void cUserCollection::sUserBucket::Add(cUserBase *user)
+{
+	if (mPos.insert(make_pair(user, mUsers.size())).second)
+		mUsers.push_back(user);
+}
+
+bool cUserCollection::sUserBucket::Remove(cUserBase *user)
+{
+	unordered_map<cUserBase*, size_t>::iterator it = mPos.find(user);
+
+	if (it == mPos.end())
+		return false;
+
+	const size_t pos = it->second;
+	mPos.erase(it);
+
+	if ((pos + 1) < mUsers.size()) { // move last user into the gap
+		mUsers[pos] = mUsers.back();
+		mPos[mUsers[pos]] = pos;
+	}
+
+	mUsers.pop_back();
+	return true;
+}
+
+unsigned cUserCollection::ClassBucket(const int cls)
+{
+	if (cls <= eUC_PINGER)
+		return 0;
+
+	if (cls >= eUC_MASTER)
+		return USER_CLASS_BUCKETS - 1;
+
+	return cls - eUC_PINGER;
+}
+
+cUserCollection::sUserBucket& cUserCollection::GetFeatureBucket(const unsigned feature)
+{
+	unordered_map<unsigned, sUserBucket>::iterator it = mFeatureIndex.find(feature);
+
+	if (it != mFeatureIndex.end())
+		return it->second;
+
+	sUserBucket &bucket = mFeatureIndex[feature];
+
+	for (iterator user = this->begin(); user != this->end(); ++user) {
+		if ((*user)->HasFeature(feature))
+			bucket.Add(*user);
+	}
+
+	return bucket;
+}
+
+void cUserCollection::BuildClassIndex()
+{
+	if (mClassIndexed)
+		return;
+
+	for (iterator user = this->begin(); user != this->end(); ++user)
+		mClassIndex[ClassBucket((*user)->mClass)].Add(*user);
+
+	mClassIndexed = true;
+}
+
+void cUserCollection::IndexAdd(cUserBase *user)
+{
+	if (mClassIndexed)
+		mClassIndex[ClassBucket(user->mClass)].Add(user);
+
+	for (unordered_map<unsigned, sUserBucket>::iterator it = mFeatureIndex.begin(); it != mFeatureIndex.end(); ++it) {
+		if (user->HasFeature(it->first))
+			it->second.Add(user);
+	}
+}
+
+void cUserCollection::IndexRemove(cUserBase *user)
+{
+	if (mClassIndexed && !mClassIndex[ClassBucket(user->mClass)].Remove(user)) { // class was changed without notification
+		for (unsigned i = 0; i < USER_CLASS_BUCKETS; i++) {
+			if (mClassIndex[i].Remove(user))
+				break;
+		}
+	}
+
+	for (unordered_map<unsigned, sUserBucket>::iterator it = mFeatureIndex.begin(); it != mFeatureIndex.end(); ++it)
+		it->second.Remove(user);
+}
+
+void cUserCollection::OnClassChange(cUserBase *user)
+{
+	if (!mClassIndexed || !user)
+		return;
+
+	const unsigned bucket = ClassBucket(user->mClass);
+
+	for (unsigned i = 0; i < USER_CLASS_BUCKETS; i++) {
+		if ((i != bucket) && mClassIndex[i].Remove(user)) { // only users of this collection are moved
+			mClassIndex[bucket].Add(user);
+			break;
+		}
+	}
+}
+
 /*
 void cUserCollection::FlushForUser(cUserBase *user)
 {
-	ufSend(mSendAllCache, false).operator()(user); // mSendAllCache is empty here, thats what we want
+	ufSend(NULL, false).operator()(user); // no segment, only flush
 }
 */
 
 void cUserCollection::FlushCache()
 {
-	SendToAll(mSendAllCache, false, false); // mSendAllCache is empty here, thats what we want
+	for_each(this->begin(), this->end(), ufSend(NULL, false)); // no segment, only flush
 }
 
 int cUserCollection::StrLog(ostream &os, const int level) // todo: need this?
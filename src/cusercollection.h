@@ -37,34 +37,48 @@ namespace std {
 */
 
 #include <string>
+#include <vector>
+#include <cctype>
 #include <functional>
+#include <unordered_map>
 #include "thasharray.h"
+#include "tdensehasharray.h"
 #include "stringutils.h"
+#include "csendqueue.h"
+
+// class index buckets, from pinger -1 to master 10
+#define USER_CLASS_BUCKETS 12
 
 using std::string;
+using std::vector;
+using std::unordered_map;
 using std::unary_function;
 
 namespace nVerliHub {
+	namespace nUtils {
+		class cZLib;
+	};
+
 	using namespace nUtils;
 	class cUser;
 	class cUserBase;
 
 /*
 	a structure that allows to insert and remove users, to quickly iterate and hold common sendall buffer, provides also number of sendall functions
-	supports: quick iterating with (restrained) constant time increment (see std::slist) , logaritmic finding, adding, removing, testing for existence.... (see std::hash_map)
+	supports: iterating over dense array of users, constant time finding, adding, removing and testing for existence, removing current or visited user while iterating is safe
 	@author Daniel Muller
 */
 
-class cUserCollection: public tHashArray<cUserBase*>
+class cUserCollection: public tDenseHashArray<cUserBase*>
 {
 public:
 	struct ufSend: public unary_function<void, iterator> // unary function for sending data to all users
 	{
-		string &mData;
+		nSocket::cSendSegment *mSeg;
 		bool mCache;
 
-		ufSend(string &data, const bool cache):
-			mData(data),
+		ufSend(nSocket::cSendSegment *seg, const bool cache):
+			mSeg(seg),
 			mCache(cache)
 		{}
 
@@ -85,12 +99,12 @@ public:
 
 	struct ufSendWithClass: public unary_function<void, iterator> // unary function for sending data to all users by class range
 	{
-		string &mData;
+		nSocket::cSendSegment *mSeg;
 		int mMinClass, mMaxClass;
 		bool mCache;
 
-		ufSendWithClass(string &data, const int min_class, const int max_class, const bool cache):
-			mData(data),
+		ufSendWithClass(nSocket::cSendSegment *seg, const int min_class, const int max_class, const bool cache):
+			mSeg(seg),
 			mMinClass(min_class),
 			mMaxClass(max_class),
 			mCache(cache)
@@ -101,12 +115,12 @@ public:
 
 	struct ufSendWithFeature: public unary_function<void, iterator> // unary function for sending data to all users by feature in supports
 	{
-		string &mData;
+		nSocket::cSendSegment *mSeg;
 		unsigned mFeature;
 		bool mCache;
 
-		ufSendWithFeature(string &data, const unsigned feature, const bool cache):
-			mData(data),
+		ufSendWithFeature(nSocket::cSendSegment *seg, const unsigned feature, const bool cache):
+			mSeg(seg),
 			mFeature(feature),
 			mCache(cache)
 		{}
@@ -116,13 +130,13 @@ public:
 
 	struct ufSendWithClassFeature: public unary_function<void, iterator> // unary function for sending data to all users by class range and feature in supports
 	{
-		string &mData;
+		nSocket::cSendSegment *mSeg;
 		int mMinClass, mMaxClass;
 		unsigned mFeature;
 		bool mCache;
 
-		ufSendWithClassFeature(string &data, const int min_class, const int max_class, const unsigned feature, const bool cache):
-			mData(data),
+		ufSendWithClassFeature(nSocket::cSendSegment *seg, const int min_class, const int max_class, const unsigned feature, const bool cache):
+			mSeg(seg),
 			mMinClass(min_class),
 			mMaxClass(max_class),
 			mFeature(feature),
@@ -138,8 +152,42 @@ public:
 		string mStart;
 		string mSep;
 
+		// entry of each user in list, removed entry keeps zero length until compaction
+		struct sSlot
+		{
+			cUserBase *mUser;
+			size_t mPos, mLen;
+
+			sSlot(cUserBase *user, const size_t pos, const size_t len):
+				mUser(user),
+				mPos(pos),
+				mLen(len)
+			{}
+		};
+
+		vector<sSlot> mSlots;
+		unordered_map<cUserBase*, size_t> mSlotIndex;
+		size_t mDead; // size of removed entries still in list
+		unsigned long mRemakes; // complete rebuilds from users
+		unsigned long mCompacts; // removed entries dropped from list
+		unsigned long mGen; // changes with list content
+
+		// compressed list for zlib users, shared by all of them until list changes
+		nSocket::cSendSegment *mZipped;
+		unsigned long mZippedGen;
+		int mZippedLevel;
+		unsigned long mZips; // number of compressions
+
 		ufDoNickList(string &list):
-			mList(list)
+			mList(list),
+			mDead(0),
+			mRemakes(0),
+			mCompacts(0),
+			mGen(1),
+			mZipped(NULL),
+			mZippedGen(0),
+			mZippedLevel(0),
+			mZips(0)
 		{
 			/*
 #ifdef USE_BUFFER_RESERVE
@@ -150,7 +198,10 @@ public:
 		}
 
 		virtual ~ufDoNickList()
-		{}
+		{
+			if (mZipped)
+				mZipped->UnRef();
+		}
 
 		virtual void Clear()
 		{
@@ -158,6 +209,10 @@ public:
 				mList.clear();
 
 			ShrinkStringToFit(mList);
+			mSlots.clear();
+			mSlotIndex.clear();
+			mDead = 0;
+			mGen++;
 
 			if (mStart.size()) {
 #ifdef USE_BUFFER_RESERVE
@@ -169,10 +224,24 @@ public:
 
 		virtual void AppendList(string &list, cUserBase *user);
 
-		virtual void operator()(cUserBase *user)
+		void operator()(cUserBase *user)
 		{
+			const size_t pos = mList.size();
 			AppendList(mList, user);
+			mSlotIndex[user] = mSlots.size();
+			mSlots.push_back(sSlot(user, pos, mList.size() - pos));
+			mGen++;
 		}
+
+		void Remove(cUserBase *user);
+		void Compact();
+		void CopyList(string &dest, const bool pipe);
+		// compressed list with ending pipe if requested, NULL when it is too short or does not compress
+		nSocket::cSendSegment* Zipped(cZLib *zlib, const int level, const size_t min_len, const bool pipe, size_t &size);
+
+	private:
+		ufDoNickList(const ufDoNickList &);
+		ufDoNickList &operator=(const ufDoNickList &);
 	};
 
 	struct ufDoInfoList: ufDoNickList // unary function that constructs myinfo list
@@ -187,11 +256,6 @@ public:
 		}
 
 		virtual void AppendList(string &list, cUserBase *user);
-
-		virtual void operator()(cUserBase *user)
-		{
-			AppendList(mList, user);
-		}
 	};
 
 	struct ufDoIPList: ufDoNickList // unary function that constructs ip list
@@ -208,15 +272,19 @@ public:
 		}
 
 		virtual void AppendList(string &list, cUserBase *user);
+	};
 
-		virtual void operator()(cUserBase *user)
-		{
-			AppendList(mList, user);
-		}
+	// users of one class or with one feature, order is not kept
+	struct sUserBucket
+	{
+		vector<cUserBase*> mUsers;
+		unordered_map<cUserBase*, size_t> mPos;
+
+		void Add(cUserBase *user);
+		bool Remove(cUserBase *user);
 	};
 
 private:
-	string mSendAllCache;
 	string mNickList;
 	string mInfoList;
 	string mIPList;
@@ -224,6 +292,23 @@ private:
 	ufDoInfoList mInfoListMaker;
 	ufDoIPList mIPListMaker;
 
+	/*
+		recipients of targeted sends, built on first use and then kept up to date
+		collections that are never asked for them dont pay anything
+	*/
+	sUserBucket mClassIndex[USER_CLASS_BUCKETS];
+	bool mClassIndexed;
+	unordered_map<unsigned, sUserBucket> mFeatureIndex; // features dont change after login
+
+	// rebuild list from all users
+	void RemakeList(ufDoNickList &maker);
+
+	static unsigned ClassBucket(const int cls);
+	sUserBucket& GetFeatureBucket(const unsigned feature);
+	void BuildClassIndex();
+	void IndexAdd(cUserBase *user);
+	void IndexRemove(cUserBase *user);
+
 protected:
 	bool mKeepNickList;
 	bool mKeepInfoList;
@@ -256,6 +341,14 @@ public:
 	virtual void GetNickList(string &dest, const bool pipe);
 	virtual void GetInfoList(string &dest, const bool pipe);
 	virtual void GetIPList(string &dest, const bool pipe);
+
+	/*
+		compressed snapshot of list for zlib users, made once per list change
+		size is set to uncompressed length, NULL means list must be sent as usual
+	*/
+	nSocket::cSendSegment* GetZippedNickList(cZLib *zlib, const int level, const size_t min_len, size_t &size);
+	nSocket::cSendSegment* GetZippedInfoList(cZLib *zlib, const int level, const size_t min_len, size_t &size);
+	nSocket::cSendSegment* GetZippedIPList(cZLib *zlib, const int level, const size_t min_len, size_t &size);
 	void Nick2Hash(const string &nick, tHashType &hash);
 
 	tHashType Nick2Hash(const string &nick)
@@ -265,6 +358,17 @@ public:
 		return Key2Hash(key); //Key2HashLower(nick)
 	}
 
+	// same hash as above, without making the lowercase key
+	tHashType Nick2Hash(const char *nick, size_t len)
+	{
+		tHashType hash = 0;
+
+		for (size_t pos = 0; (pos < len) && nick[pos]; ++pos)
+			hash = 33 * hash + (char)::tolower(nick[pos]);
+
+		return hash;
+	}
+
 	void Nick2Key(const string &nick, string &key);
 
 	cUserBase* GetUserBaseByKey(const string &key)
@@ -309,6 +413,14 @@ public:
 		return NULL;
 	}
 
+	cUser* GetUserByNick(const char *nick, size_t len)
+	{
+		if (len)
+			return (cUser*)GetByHash(Nick2Hash(nick, len));
+
+		return NULL;
+	}
+
 	bool ContainsKey(const string &key)
 	{
 		return ContainsHash(Key2Hash(key));
@@ -361,23 +473,51 @@ public:
 
 		if (!mRemakeNextIPList && mKeepIPList)
 			mIPListMaker(user);
+
+		if (mClassIndexed || mFeatureIndex.size())
+			IndexAdd(user);
+	}
+
+	// myinfo of user in list has changed, its entry is moved to the end
+	void OnInfoChange(cUserBase *user)
+	{
+		if (!mRemakeNextInfoList && mKeepInfoList) {
+			mInfoListMaker.Remove(user);
+			mInfoListMaker(user);
+		}
 	}
 
 	virtual void OnRemove(cUserBase *user)
 	{
-		mRemakeNextNickList = mKeepNickList;
-		mRemakeNextInfoList = mKeepInfoList;
-		mRemakeNextIPList = mKeepIPList;
+		if (!mRemakeNextNickList && mKeepNickList)
+			mNickListMaker.Remove(user);
+
+		if (!mRemakeNextInfoList && mKeepInfoList)
+			mInfoListMaker.Remove(user);
+
+		if (!mRemakeNextIPList && mKeepIPList)
+			mIPListMaker.Remove(user);
+
+		if (mClassIndexed || mFeatureIndex.size())
+			IndexRemove(user);
+	}
+
+	// class of user in list has changed, must be called after every change of logged in user
+	void OnClassChange(cUserBase *user);
+
+	unsigned long GetListRemakes() const
+	{
+		return mNickListMaker.mRemakes + mInfoListMaker.mRemakes + mIPListMaker.mRemakes;
 	}
 
-	unsigned int GetCacheSize() const
+	unsigned long GetListCompacts() const
 	{
-		return mSendAllCache.size();
+		return mNickListMaker.mCompacts + mInfoListMaker.mCompacts + mIPListMaker.mCompacts;
 	}
 
-	unsigned int GetCacheCapacity() const
+	unsigned long GetListZips() const
 	{
-		return mSendAllCache.capacity();
+		return mNickListMaker.mZips + mInfoListMaker.mZips + mIPListMaker.mZips;
 	}
 
 	unsigned int GetNickListSize() const
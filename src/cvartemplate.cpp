@@ -0,0 +1,88 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#include "cvartemplate.h"
+#include <cstring>
+
+namespace nVerliHub {
+	namespace nUtils {
+
+static const char *sVarNames[cVarTemplate::eVAR_COUNT] = {"NICK", "CLASS", "CC", "CN", "CITY", "IP", "HOST"};
+
+cVarTemplate::cVarTemplate(const string &text):
+	mText(text),
+	mUses(0),
+	mLiteralSize(0)
+{
+	size_t last = 0, pos = mText.find("%["), end, len;
+	int var;
+
+	while (pos != mText.npos) {
+		end = mText.find(']', pos + 2);
+
+		if (end == mText.npos)
+			break;
+
+		len = end - pos - 2;
+
+		for (var = 0; var < eVAR_COUNT; var++) {
+			if ((strlen(sVarNames[var]) == len) && (mText.compare(pos + 2, len, sVarNames[var]) == 0))
+				break;
+		}
+
+		if (var < eVAR_COUNT) {
+			AddLiteral(last, pos - last);
+			sPart part = {0, 0, var};
+			mParts.push_back(part);
+			mUses |= (1 << var);
+			last = end + 1;
+			pos = mText.find("%[", last);
+		} else { // unknown, keep as text and look for next one inside, like %[%[NICK]
+			pos = mText.find("%[", pos + 2);
+		}
+	}
+
+	AddLiteral(last, mText.size() - last);
+}
+
+void cVarTemplate::AddLiteral(size_t pos, size_t len)
+{
+	if (!len)
+		return;
+
+	sPart part = {pos, len, -1};
+	mParts.push_back(part);
+	mLiteralSize += len;
+}
+
+void cVarTemplate::Render(string &dest, const string * const *values) const
+{
+	vector<sPart>::const_iterator it;
+
+	for (it = mParts.begin(); it != mParts.end(); ++it) {
+		if (it->mVar < 0)
+			dest.append(mText, it->mPos, it->mLen);
+		else if (values[it->mVar])
+			dest.append(*values[it->mVar]);
+	}
+}
+
+	}; // namespace nUtils
+}; // namespace nVerliHub
@@ -0,0 +1,95 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NUTILSCVARTEMPLATE_H
+#define NUTILSCVARTEMPLATE_H
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace nVerliHub {
+	namespace nUtils {
+
+/**
+* Message with user variables parsed once into literal and variable parts.
+*
+* Rendering for every recipient only appends the parts, so the cost is linear in output size,
+* unknown variables are kept as text and substituted values are never scanned for variables again.
+*/
+class cVarTemplate
+{
+public:
+	/// Known variables.
+	enum tVar
+	{
+		eVAR_NICK, // %[NICK]
+		eVAR_CLASS, // %[CLASS]
+		eVAR_CC, // %[CC]
+		eVAR_CN, // %[CN]
+		eVAR_CITY, // %[CITY]
+		eVAR_IP, // %[IP]
+		eVAR_HOST, // %[HOST]
+		eVAR_COUNT
+	};
+
+	cVarTemplate(const string &text);
+
+	/// Whether variable is present in template, values of unused variables are never read.
+	bool Uses(tVar var) const
+	{
+		return (mUses & (1 << var)) != 0;
+	}
+
+	/// Size of template without variables.
+	size_t LiteralSize() const
+	{
+		return mLiteralSize;
+	}
+
+	/**
+	* Append rendered template to buffer.
+	* @param dest The buffer.
+	* @param values Values indexed by tVar, only used variables must be set.
+	*/
+	void Render(string &dest, const string * const *values) const;
+
+private:
+	struct sPart
+	{
+		size_t mPos; // position in text, literals only
+		size_t mLen;
+		int mVar; // variable or -1 for literal
+	};
+
+	string mText;
+	vector<sPart> mParts;
+	unsigned int mUses;
+	size_t mLiteralSize;
+
+	void AddLiteral(size_t pos, size_t len);
+};
+
+	}; // namespace nUtils
+}; // namespace nVerliHub
+
+#endif
@@ -0,0 +1,96 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifdef HAVE_CONFIG_H
+	#include <config.h>
+#endif
+
+#include "cwakeup.h"
+
+#if HAVE_SYS_EVENTFD_H
+	#include <sys/eventfd.h>
+#endif
+
+#if HAVE_ERRNO_H
+	#include <errno.h>
+#endif
+
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace nVerliHub {
+	namespace nSocket {
+
+cWakeUp::cWakeUp():
+	mWakes(0),
+	mRead(INVALID_SOCKET),
+	mWrite(INVALID_SOCKET)
+{
+#if HAVE_SYS_EVENTFD_H
+	mRead = mWrite = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	if (mRead < 0)
+		throw "Unable to create wake up descriptor";
+#else
+	int fds[2];
+
+	if (pipe(fds) < 0)
+		throw "Unable to create wake up descriptor";
+
+	mRead = fds[0];
+	mWrite = fds[1];
+
+	for (int i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+#endif
+}
+
+cWakeUp::~cWakeUp()
+{
+	if (mWrite != mRead)
+		::close(mWrite);
+
+	::close(mRead);
+}
+
+void cWakeUp::Wake()
+{
+	const unsigned long long one = 1; // eventfd needs exactly 8 bytes, pipe takes any
+	ssize_t res;
+
+	do {
+		res = ::write(mWrite, &one, sizeof(one));
+	} while ((res < 0) && (errno == EINTR)); // full pipe or counter is fine, loop is woken anyway
+}
+
+void cWakeUp::Clear()
+{
+	unsigned long long buf[16];
+
+	while (::read(mRead, buf, sizeof(buf)) == (ssize_t)sizeof(buf)) // pipe may hold more, eventfd counter is reset by single read
+		;
+
+	mWakes++;
+}
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
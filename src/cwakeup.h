@@ -0,0 +1,74 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NSOCKETCWAKEUP_H
+#define NSOCKETCWAKEUP_H
+
+#include "cconnbase.h"
+
+namespace nVerliHub {
+	namespace nSocket {
+
+/**
+* Descriptor that makes main loop leave its wait in connection chooser.
+*
+* It is watched by connection chooser like a socket and becomes readable when Wake() is called,
+* so threads and io_uring engine can report new work without main loop polling for it.
+* Uses eventfd when available, otherwise a pipe.
+*/
+class cWakeUp : public cConnBase
+{
+public:
+	cWakeUp();
+	~cWakeUp();
+
+	/// Descriptor to watch for input.
+	virtual operator tSocket() const
+	{
+		return mRead;
+	}
+
+	/// Descriptor that kernel can signal directly, -1 when eventfd is not available.
+	int EventFD() const
+	{
+		return ((mRead == mWrite) ? mRead : -1);
+	}
+
+	/// Wake up main loop, can be called from any thread.
+	void Wake();
+
+	/// Drain all wake ups, called by main loop when descriptor becomes readable.
+	void Clear();
+
+	/// Number of times main loop was woken up.
+	unsigned long mWakes;
+
+private:
+	cWakeUp(const cWakeUp &);
+	cWakeUp &operator=(const cWakeUp &);
+
+	tSocket mRead;
+	tSocket mWrite;
+};
+
+	}; // namespace nSocket
+}; // namespace nVerliHub
+
+#endif
@@ -133,5 +133,99 @@ char *cZLib::Compress(const char *buffer, size_t len, size_t &outLen, int &err,
 	return outBuf;
 }
 
+string cZLibStream::msOut;
+
+cZLibStream::cZLibStream(int level, int windowBits, int memLevel):
+	mStream(NULL),
+	mStarted(false),
+	mTotalIn(0),
+	mTotalOut(0)
+{
+	if (level < Z_DEFAULT_COMPRESSION) // same limits as above
+		level = Z_DEFAULT_COMPRESSION;
+	else if (level < Z_BEST_SPEED)
+		level = Z_BEST_SPEED;
+	else if (level > Z_BEST_COMPRESSION)
+		level = Z_BEST_COMPRESSION;
+
+	if (windowBits < 9)
+		windowBits = 9;
+	else if (windowBits > MAX_WBITS)
+		windowBits = MAX_WBITS;
+
+	if (memLevel < 1)
+		memLevel = 1;
+	else if (memLevel > MAX_MEM_LEVEL)
+		memLevel = MAX_MEM_LEVEL;
+
+	z_stream *strm = (z_stream*)calloc(1, sizeof(z_stream));
+
+	if (!strm)
+		return;
+
+	strm->zalloc = Z_NULL;
+	strm->zfree = Z_NULL;
+	strm->data_type = Z_TEXT;
+
+	if (deflateInit2(strm, level, Z_DEFLATED, windowBits, memLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+		free(strm);
+		return;
+	}
+
+	mStream = strm;
+}
+
+cZLibStream::~cZLibStream()
+{
+	if (mStream) {
+		deflateEnd((z_stream*)mStream);
+		free(mStream);
+		mStream = NULL;
+	}
+}
+
+const char *cZLibStream::Compress(const char *buffer, size_t len, size_t &outLen)
+{
+	outLen = 0;
+
+	if (!mStream || !buffer || !len)
+		return NULL;
+
+	z_stream *strm = (z_stream*)mStream;
+	const size_t start = (mStarted ? 0 : ZON_LEN);
+	size_t need = start + deflateBound(strm, len) + 16; // sync flush marker and some spare
+
+	if (msOut.size() < need)
+		msOut.resize(need);
+
+	if (!mStarted)
+		memcpy(&msOut[0], "$ZOn|", ZON_LEN);
+
+	strm->next_in = (Bytef*)buffer;
+	strm->avail_in = (uInt)len;
+	size_t done = start;
+
+	while (true) {
+		strm->next_out = (Bytef*)&msOut[done];
+		strm->avail_out = (uInt)(msOut.size() - done);
+
+		if (deflate(strm, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+			return NULL;
+
+		done = msOut.size() - strm->avail_out;
+
+		if (strm->avail_out) // whole block is out
+			break;
+
+		msOut.resize(msOut.size() + ZLIB_BUFFER_SIZE);
+	}
+
+	mStarted = true;
+	mTotalIn += len;
+	mTotalOut += done;
+	outLen = done;
+	return msOut.data();
+}
+
 	}; // namespace nUtils
 }; // namespace nVerliHub
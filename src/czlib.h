@@ -86,6 +86,66 @@ namespace nUtils {
 			size_t outLastLen;
 	};
 
+	/**
+	 * Deflate stream kept for whole life of a connection.
+	 * Every flush is compressed as a sync flushed block of the same stream, so small messages
+	 * share the dictionary of everything sent before. Stream is started with $ZOn and never ends,
+	 * all later data to the connection must go through it.
+	 */
+	class cZLibStream
+	{
+		public:
+			/**
+			* Class constructor.
+			* @param level Compression level.
+			* @param windowBits Base two logarithm of window size, 9 to 15.
+			* @param memLevel Memory used for compression state, 1 to 9.
+			*/
+			cZLibStream(int level, int windowBits, int memLevel);
+
+			/**
+			* Class destructor.
+			*/
+			~cZLibStream();
+
+			/**
+			* Compress the given data as next block of the stream.
+			* Returned buffer is shared by all streams and valid until next call.
+			*
+			* @param buffer Pointer to buffer data.
+			* @param len Data length.
+			* @param outLen Length of compressed data.
+			* @return Pointer to compressed data or NULL on error.
+			*/
+			const char* Compress(const char *buffer, size_t len, size_t &outLen);
+
+			// stream has been started, data can no longer be sent without it
+			bool Started() const
+			{
+				return mStarted;
+			}
+
+			// total input and output of the stream
+			unsigned long long TotalIn() const
+			{
+				return mTotalIn;
+			}
+
+			unsigned long long TotalOut() const
+			{
+				return mTotalOut;
+			}
+
+		private:
+			void *mStream;
+			bool mStarted;
+			unsigned long long mTotalIn;
+			unsigned long long mTotalOut;
+
+			// shared out buffer
+			static string msOut;
+	};
+
 }; // namespace nUtils
 }; // namespace nVerliHub
 
@@ -698,6 +698,7 @@ bool AddRegUser(const char *nick, int clas, const char *pass, const char* op)
 		}
 
 		user->mClass = tUserCl(clas);
+		serv->OnUserClassChange(user);
 		serv->SetUserRegInfo(user->mxConn, user->mNick); // update registration information in real time aswell
 	}
 
@@ -758,6 +759,8 @@ bool DelRegUser(const char *nick)
 			serv->mTotalShare += user->mShare;
 		}
 
+		serv->OnUserClassChange(user);
+
 		serv->SetUserRegInfo(user->mxConn, user->mNick); // update registration information in real time aswell
 	}
 
@@ -829,6 +832,7 @@ bool SetRegClass(const char *nick, int clas)
 		}
 
 		user->mClass = tUserCl(clas);
+		serv->OnUserClassChange(user);
 		serv->SetUserRegInfo(user->mxConn, user->mNick); // update registration information in real time aswell
 	}
 
@@ -45,6 +45,11 @@
 	#include <sys/syslimits.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__AVX2__))
+	#include <immintrin.h>
+	#define USE_SIMD_SCAN
+#endif
+
 namespace nVerliHub {
 	namespace nUtils {
 
@@ -399,5 +404,43 @@ string StrByteList(const string &data, const string &sep)
 	return res;
 }
 
+const char* FindCharLast(const char *buf, size_t len, char c)
+{
+	const char *pos = buf + len;
+
+#ifdef USE_SIMD_SCAN
+	unsigned int mask;
+
+	#ifdef __AVX2__
+	const __m256i pat32 = _mm256_set1_epi8(c);
+
+	while ((pos - buf) >= 32) { // compare 32 bytes at once going backwards, highest set bit is the last match
+		pos -= 32;
+		mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)pos), pat32));
+
+		if (mask)
+			return pos + 31 - __builtin_clz(mask);
+	}
+	#endif
+
+	const __m128i pat16 = _mm_set1_epi8(c);
+
+	while ((pos - buf) >= 16) {
+		pos -= 16;
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)pos), pat16));
+
+		if (mask)
+			return pos + 31 - __builtin_clz(mask);
+	}
+#endif
+
+	while (pos > buf) { // remaining head, or everything without vector instructions
+		if (*--pos == c)
+			return pos;
+	}
+
+	return NULL;
+}
+
 	}; // namespace nUtils
 }; // namespace nVerliHub
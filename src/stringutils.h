@@ -57,6 +57,15 @@ unsigned int CountLines(const string &);
 bool LimitLines(const string &str, int max);
 string StrByteList(const string &data, const string &sep = " ");
 
+// find first occurrence of a character in a buffer or NULL, libc memchr is vectorized and picks the best kernel at run time
+inline const char* FindChar(const char *buf, size_t len, char c)
+{
+	return (const char*)memchr(buf, c, len);
+}
+
+// find last occurrence of a character in a buffer or NULL, uses sse2 or avx2 when compiled in
+const char* FindCharLast(const char *buf, size_t len, char c);
+
 inline void AppendReservePlusPipe(string &dest, string &data, const bool pipe)
 {
 	if (pipe) // must always be already reserved for pipe
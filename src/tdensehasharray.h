@@ -0,0 +1,463 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NUTILSTDENSEHASHARRAY_H
+#define NUTILSTDENSEHASHARRAY_H
+
+#include <vector>
+#include <ctype.h>
+#include "cobj.h"
+
+using std::vector;
+
+namespace nVerliHub {
+	namespace nUtils {
+
+/**
+* Hash container with open addressing and dense storage of values, same interface as tHashArray.
+*
+* Values and their hashes are kept in two dense arrays, so iteration touches only values and never empty slots.
+* Lookup table holds full hash and position of value, it is probed linearly and removal shifts following
+* slots back instead of leaving tombstones. Removed value is replaced by last one, so removal is constant time.
+*
+* Iteration goes from last value to first, so it is safe to remove current or any already visited value,
+* values added during iteration are not visited.
+* @author Verlihub Team
+*/
+template <class DataType> class tDenseHashArray : public cObj
+{
+public:
+	/// Define the type of the hash, 64 bits on every platform because values with same hash are refused.
+	typedef unsigned long long tHashType;
+
+	/**
+	* Class constructor.
+	* @param initialSize Minimum capacity of lookup table.
+	*/
+	tDenseHashArray(unsigned initialSize = 1024):
+		cObj("tDenseHashArray"),
+		mSize(0)
+	{
+		mMinCapacity = 16;
+
+		while (mMinCapacity < initialSize)
+			mMinCapacity <<= 1;
+
+		mSlots.resize(mMinCapacity);
+		mMask = mMinCapacity - 1;
+	}
+
+	virtual ~tDenseHashArray()
+	{}
+
+	/**
+	* Add an element with the given hash to the container.
+	* @param element The element to add.
+	* @param hash The hash.
+	* @return True if the element is added or false if it is null or hash already exists.
+	*/
+	bool AddWithHash(DataType element, const tHashType &hash)
+	{
+		if (element == (DataType)NULL)
+			return false;
+
+		if (((mSize + 1) * 4) > (mSlots.size() * 3)) // keep load under three quarters
+			Rehash(mSlots.size() * 2);
+
+		unsigned pos = Home(hash);
+
+		while (mSlots[pos].mIndex) {
+			if (mSlots[pos].mHash == hash)
+				return false;
+
+			pos = (pos + 1) & mMask;
+		}
+
+		mValues.push_back(element);
+		mHashes.push_back(hash);
+		mSlots[pos].mHash = hash;
+		mSlots[pos].mIndex = ++mSize;
+		OnAdd(element);
+		return true;
+	}
+
+	/**
+	* Shrink lookup table when most of it is empty, it grows by itself when elements are added.
+	*/
+	void AutoResize()
+	{
+		if ((mSlots.size() > mMinCapacity) && ((mSize * 8) < mSlots.size())) {
+			if (Log(3))
+				LogStream() << "Autoresizing capacity: " << mSlots.size() << " size: " << mSize << endl;
+
+			Resize(mSize * 2);
+		}
+	}
+
+	/**
+	* Clear the container, OnRemove is not called.
+	*/
+	void Clear()
+	{
+		mValues.clear();
+		mHashes.clear();
+		mSlots.assign(mSlots.size(), sSlot());
+		mSize = 0;
+	}
+
+	/**
+	* Check if an element with the given hash exists in the container.
+	* @param hash The hash.
+	* @return True if the element exists or false otherwise.
+	*/
+	bool ContainsHash(const tHashType &hash) const
+	{
+		return Find(hash) != NO_SLOT;
+	}
+
+	/**
+	* Dump probe statistics of the container to the given stream.
+	* @param os The stream where to store the result.
+	*/
+	void DumpProfile(ostream &os) const
+	{
+		unsigned long total = 0;
+		unsigned longest = 0, probe, pos;
+
+		for (pos = 0; pos < mSlots.size(); ++pos) {
+			if (!mSlots[pos].mIndex)
+				continue;
+
+			probe = ((pos - Home(mSlots[pos].mHash)) & mMask) + 1;
+			total += probe;
+
+			if (probe > longest)
+				longest = probe;
+		}
+
+		os << "Size = " << mSize << " Capacity = " << mSlots.size() << " Longest probe = " << longest << " Mean probe = " << (mSize ? (double(total) / mSize) : 0.) << endl;
+	}
+
+	/**
+	* Get the element with the given hash from the container.
+	* @param hash The hash.
+	* @return The element or NULL if the element does not exists.
+	*/
+	DataType GetByHash(const tHashType &hash) const
+	{
+		unsigned pos = Find(hash);
+
+		if (pos == NO_SLOT)
+			return (DataType)NULL;
+
+		return mValues[mSlots[pos].mIndex - 1];
+	}
+
+	/**
+	* Calculate the hash for the given string but convert it to lower case.
+	* @param string The string.
+	* @return The hash of the string.
+	*/
+	static tHashType HashLowerString(const string &str)
+	{
+		tHashType hash = 0;
+
+		for (const char *s = str.c_str(); *s; ++s)
+			hash = 33 * hash + ::tolower(*s);
+
+		return hash;
+	}
+
+	/**
+	* Calculate the hash for the given string.
+	* @param string The string.
+	* @return The hash of the string.
+	*/
+	static tHashType HashString(const string &str)
+	{
+		tHashType hash = 0;
+
+		for (const char *s = str.c_str(); *s; ++s)
+			hash = 33 * hash + *s;
+
+		return hash;
+	}
+
+	/**
+	* Event handler function called when an element is added.
+	* @param element The added element.
+	*/
+	virtual void OnAdd(DataType element)
+	{}
+
+	/**
+	* Event handler function called when an element is removed.
+	* @param element The removed element.
+	*/
+	virtual void OnRemove(DataType element)
+	{}
+
+	/**
+	* Calculate the hash for the given key.
+	* @param key The key.
+	* @return The hash of the key.
+	* @see HashString()
+	*/
+	tHashType Key2Hash(const string &key)
+	{
+		return HashString(key);
+	}
+
+	/**
+	* Remove an element with the given hash from the container.
+	* @param hash The hash.
+	* @return True if the element is removed or false otherwise.
+	*/
+	bool RemoveByHash(const tHashType &hash)
+	{
+		unsigned pos = Find(hash);
+
+		if (pos == NO_SLOT)
+			return false;
+
+		unsigned index = mSlots[pos].mIndex - 1;
+		DataType data = mValues[index];
+
+		if (index != (mSize - 1)) { // move last value to the gap
+			mValues[index] = mValues[mSize - 1];
+			mHashes[index] = mHashes[mSize - 1];
+			mSlots[Find(mHashes[index])].mIndex = index + 1;
+		}
+
+		mValues.pop_back();
+		mHashes.pop_back();
+		mSize--;
+		unsigned hole = pos, next = pos;
+
+		while (true) { // shift following slots of the cluster back if their home allows it
+			next = (next + 1) & mMask;
+
+			if (!mSlots[next].mIndex)
+				break;
+
+			if (((next - Home(mSlots[next].mHash)) & mMask) >= ((next - hole) & mMask)) {
+				mSlots[hole] = mSlots[next];
+				hole = next;
+			}
+		}
+
+		mSlots[hole] = sSlot();
+		OnRemove(data);
+		return true;
+	}
+
+	/*
+		resize lookup table to hold at least given number of slots, it never gets loaded over three quarters
+		newSize - the new size of the container
+		return - always 0
+	*/
+	int Resize(int newSize)
+	{
+		size_t cap = mMinCapacity;
+
+		while ((cap < size_t(newSize)) || ((mSize * 4) > (cap * 3)))
+			cap <<= 1;
+
+		if (cap != mSlots.size())
+			Rehash(cap);
+
+		return 0;
+	}
+
+	/**
+	* Replace the element with the given hash.
+	* @param hash The hash.
+	* @param value The new element.
+	* @return True if the element was found or false otherwise.
+	*/
+	bool SetByHash(const tHashType &hash, const DataType &value)
+	{
+		unsigned pos = Find(hash);
+
+		if (pos == NO_SLOT)
+			return false;
+
+		mValues[mSlots[pos].mIndex - 1] = value;
+		return true;
+	}
+
+	/**
+	* Return the number of elements in the container.
+	* @return The number of elements.
+	*/
+	unsigned Size() const
+	{
+		return mSize;
+	}
+
+	unsigned Capacity() const
+	{
+		return mSlots.size();
+	}
+
+	/**
+	* Iterator over dense array of values, from last to first.
+	*/
+	class iterator
+	{
+		public:
+			iterator():
+				mArray(NULL),
+				mPos(0)
+			{}
+
+			iterator(const tDenseHashArray *array, unsigned pos):
+				mArray(array),
+				mPos(pos)
+			{}
+
+			/**
+			* Test if the iterator is at the end of the container.
+			* @return True if it is at the end or false otherwise.
+			*/
+			bool IsEnd() const
+			{
+				return !mPos;
+			}
+
+			bool operator==(const iterator &it) const
+			{
+				return mPos == it.mPos;
+			}
+
+			bool operator!=(const iterator &it) const
+			{
+				return mPos != it.mPos;
+			}
+
+			iterator &operator++()
+			{
+				if (mPos)
+					mPos--;
+
+				if (mPos > mArray->mSize) // visited values were removed meanwhile
+					mPos = mArray->mSize;
+
+				return *this;
+			}
+
+			DataType operator*() const
+			{
+				return mArray->mValues[mPos - 1];
+			}
+
+			/**
+			* Hash of element pointed by the iterator.
+			*/
+			tHashType Hash() const
+			{
+				return mArray->mHashes[mPos - 1];
+			}
+
+		private:
+			const tDenseHashArray *mArray;
+			unsigned mPos; // one past pointed element, zero at end
+	};
+
+	/**
+	* Return the iterator that points to the first element in the container.
+	*/
+	iterator begin() const
+	{
+		return iterator(this, mSize);
+	}
+
+	/**
+	* Return the iterator that points after the last element in the container.
+	*/
+	iterator end() const
+	{
+		return iterator(this, 0);
+	}
+
+private:
+	// lookup table slot, position of value is stored plus one so that zero means empty slot
+	struct sSlot
+	{
+		tHashType mHash;
+		unsigned mIndex;
+
+		sSlot():
+			mHash(0),
+			mIndex(0)
+		{}
+	};
+
+	enum { NO_SLOT = ~0u };
+
+	vector<DataType> mValues;
+	vector<tHashType> mHashes;
+	vector<sSlot> mSlots;
+	unsigned mSize;
+	unsigned mMask;
+	unsigned mMinCapacity;
+
+	// nick hashes have poor low bits, so they are mixed before masking
+	unsigned Home(tHashType hash) const
+	{
+		return unsigned(((unsigned long long)hash * 0x9E3779B97F4A7C15ULL) >> 32) & mMask;
+	}
+
+	unsigned Find(tHashType hash) const
+	{
+		unsigned pos = Home(hash);
+
+		while (mSlots[pos].mIndex) {
+			if (mSlots[pos].mHash == hash)
+				return pos;
+
+			pos = (pos + 1) & mMask;
+		}
+
+		return NO_SLOT;
+	}
+
+	void Rehash(size_t cap)
+	{
+		mSlots.assign(cap, sSlot());
+		mMask = cap - 1;
+		unsigned pos;
+
+		for (unsigned index = 0; index < mSize; ++index) {
+			pos = Home(mHashes[index]);
+
+			while (mSlots[pos].mIndex)
+				pos = (pos + 1) & mMask;
+
+			mSlots[pos].mHash = mHashes[index];
+			mSlots[pos].mIndex = index + 1;
+		}
+	}
+};
+
+	}; // namespace nUtils
+}; // namespace nVerliHub
+
+#endif
@@ -0,0 +1,98 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NTHREADTLOCKFREEQUEUE_H
+#define NTHREADTLOCKFREEQUEUE_H
+
+#include <atomic>
+#include <vector>
+
+using std::vector;
+
+namespace nVerliHub {
+	namespace nThread {
+
+/**
+bounded single producer, single consumer queue
+
+one thread may only push, another thread may only pop, no locks are taken by either side
+
+@author Verlihub Team
+*/
+template <class DataType> class tLockFreeQueue
+{
+public:
+	tLockFreeQueue(unsigned int size):
+		mSize(size + 1), // one slot is always left empty to tell full from empty
+		mHead(0),
+		mTail(0)
+	{
+		mData.resize(mSize);
+	}
+
+	~tLockFreeQueue()
+	{}
+
+	/** producer side, returns false when queue is full */
+	bool Push(const DataType &data)
+	{
+		const unsigned int tail = mTail.load(std::memory_order_relaxed);
+		const unsigned int next = (tail + 1) % mSize;
+
+		if (next == mHead.load(std::memory_order_acquire))
+			return false;
+
+		mData[tail] = data;
+		mTail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	/** consumer side, returns false when queue is empty */
+	bool Pop(DataType &data)
+	{
+		const unsigned int head = mHead.load(std::memory_order_relaxed);
+
+		if (head == mTail.load(std::memory_order_acquire))
+			return false;
+
+		data = mData[head];
+		mHead.store((head + 1) % mSize, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const
+	{
+		return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire);
+	}
+
+private:
+	tLockFreeQueue(const tLockFreeQueue &);
+	tLockFreeQueue &operator=(const tLockFreeQueue &);
+
+	const unsigned int mSize;
+	vector<DataType> mData;
+	std::atomic<unsigned int> mHead; // next element to pop, owned by consumer
+	std::atomic<unsigned int> mTail; // next free slot, owned by producer
+};
+
+	}; // namespace nThread
+}; // namespace nVerliHub
+
+#endif
@@ -0,0 +1,116 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef NUTILSTOBJPOOL_H
+#define NUTILSTOBJPOOL_H
+
+#include <new>
+#include <cstddef>
+
+// maximum number of free objects kept by each pool
+#define OBJ_POOL_SIZE 4096
+
+namespace nVerliHub {
+	namespace nUtils {
+
+/**
+pool of memory for objects of one class, used by class specific operator new and delete
+
+freed memory is kept in a list and given to next object of the same class, so frequently created objects dont go through the allocator every time
+objects of derived classes have different size and are allocated normally
+not thread safe, objects must be created and deleted by main thread
+
+@author Verlihub Team
+*/
+template <class DataType> class tObjPool
+{
+public:
+	static void* Alloc(size_t size)
+	{
+		if (size != sizeof(DataType))
+			return ::operator new(size);
+
+		if (++sCount > sPeak)
+			sPeak = sCount;
+
+		if (!msFree)
+			return ::operator new(size);
+
+		sFree *block = msFree;
+		msFree = block->mNext;
+		sPooled--;
+		sReused++;
+		return block;
+	}
+
+	static void Free(void *ptr, size_t size)
+	{
+		if (!ptr)
+			return;
+
+		if (size != sizeof(DataType)) {
+			::operator delete(ptr);
+			return;
+		}
+
+		sCount--;
+
+		if (sPooled >= OBJ_POOL_SIZE) {
+			::operator delete(ptr);
+			return;
+		}
+
+		sFree *block = (sFree*)ptr; // free memory holds the list
+		block->mNext = msFree;
+		msFree = block;
+		sPooled++;
+	}
+
+	/// Number of existing objects.
+	static unsigned long sCount;
+
+	/// Highest number of existing objects.
+	static unsigned long sPeak;
+
+	/// Number of objects that got memory from the pool.
+	static unsigned long sReused;
+
+	/// Number of free objects in the pool.
+	static unsigned long sPooled;
+
+private:
+	struct sFree
+	{
+		sFree *mNext;
+	};
+
+	static sFree *msFree;
+};
+
+template <class DataType> unsigned long tObjPool<DataType>::sCount = 0;
+template <class DataType> unsigned long tObjPool<DataType>::sPeak = 0;
+template <class DataType> unsigned long tObjPool<DataType>::sReused = 0;
+template <class DataType> unsigned long tObjPool<DataType>::sPooled = 0;
+template <class DataType> typename tObjPool<DataType>::sFree *tObjPool<DataType>::msFree = NULL;
+
+	}; // namespace nUtils
+}; // namespace nVerliHub
+
+#endif
@@ -0,0 +1,172 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	poll and epoll connection choosers with many idle connections and a few active ones
+	usage: bench_connchoose [idle count]...
+	default counts are 1000, 10000 and 50000, limited by number of open files allowed to process
+*/
+
+#include "cconnpoll.h"
+#include "cconnepoll.h"
+#include "ctime.h"
+#include "cobj.h"
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace nVerliHub;
+using namespace nVerliHub::nSocket;
+using namespace nVerliHub::nEnums;
+using namespace nVerliHub::nUtils;
+
+// number of sockets with pending input in every choose
+#define ACTIVE_CONNS 16
+
+struct sBenchConn : public cConnBase
+{
+	tSocket mSock;
+
+	sBenchConn(tSocket sock):
+		mSock(sock)
+	{}
+
+	virtual ~sBenchConn()
+	{}
+
+	virtual operator tSocket() const
+	{
+		return mSock;
+	}
+};
+
+static double Usec(const cTime &from)
+{
+	cTime now;
+	now -= from;
+	return (now.Sec() * 1000000.) + now.tv_usec;
+}
+
+template <class tChooser> static void Bench(const char *name, unsigned int idle)
+{
+	tChooser ch;
+	vector<sBenchConn*> conns;
+	vector<int> peers;
+	int pair[2];
+	cTime start;
+
+	for (unsigned int i = 0; i < idle; i++) { // unbound datagram sockets never become readable
+		int sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+
+		if (sock < 0)
+			break;
+
+		conns.push_back(new sBenchConn(sock));
+	}
+
+	for (unsigned int i = 0; i < ACTIVE_CONNS; i++) { // peer writes one byte that is never read, so socket stays readable
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+			break;
+
+		if (write(pair[1], "x", 1) != 1)
+			break;
+
+		conns.push_back(new sBenchConn(pair[0]));
+		peers.push_back(pair[1]);
+	}
+
+	const size_t count = conns.size();
+	start.Get();
+
+	for (size_t i = 0; i < count; i++) {
+		ch.AddConn(conns[i]);
+		ch.cConnChoose::OptIn((cConnBase*)conns[i], tChEvent(eCC_INPUT | eCC_ERROR));
+	}
+
+	const double add = Usec(start) / count;
+	const unsigned int rounds = ((count < 2000) ? 2000 : (4000000 / count));
+	typename tChooser::iterator it;
+	cTime tmout(0, 0);
+	unsigned long ready = 0;
+	start.Get();
+
+	for (unsigned int r = 0; r < rounds; r++) {
+		ch.Choose(tmout);
+
+		for (it = ch.begin(); it != ch.end(); ++it) {
+			if ((*it).mRevent & eCC_INPUT)
+				ready++;
+		}
+	}
+
+	const double loop = Usec(start) / rounds;
+	printf("%-6s sockets %6zu (%zu idle)  register %6.2f us/socket  choose and iterate %9.1f us  ready %lu\n", name, count, count - peers.size(), add, loop, ready / rounds);
+
+	for (size_t i = 0; i < count; i++) {
+		ch.DelConn(conns[i]);
+		close(conns[i]->mSock);
+		delete conns[i];
+	}
+
+	for (size_t i = 0; i < peers.size(); i++)
+		close(peers[i]);
+}
+
+int main(int argc, char **argv)
+{
+	vector<unsigned int> counts;
+	struct rlimit lim;
+	unsigned long limit = 0;
+
+	for (int i = 1; i < argc; i++)
+		counts.push_back(atoi(argv[i]));
+
+	if (counts.empty()) {
+		counts.push_back(1000);
+		counts.push_back(10000);
+		counts.push_back(50000);
+	}
+
+	if (getrlimit(RLIMIT_NOFILE, &lim) == 0) { // allow as many sockets as possible
+		lim.rlim_cur = lim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &lim);
+		limit = lim.rlim_cur;
+		printf("open files limit: %lu\n", (unsigned long)lim.rlim_cur);
+	}
+
+	cObj::msLogLevel = 0;
+
+	for (size_t i = 0; i < counts.size(); i++) {
+		if (limit && ((counts[i] + (2 * ACTIVE_CONNS) + 16) > limit)) { // partial run would give misleading numbers
+			printf("skipping %u idle sockets, open files limit is too low\n", counts[i]);
+			continue;
+		}
+
+		Bench<cConnPoll>("poll", counts[i]);
+#if USE_EPOLL
+		Bench<cConnEpoll>("epoll", counts[i]);
+#endif
+	}
+
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	delimiter search used by line reader and chunk splitting against scalar search it replaced
+	usage: bench_findchar [rounds]
+	first part splits typical messages three times each like SplitOnTwo does
+	second part searches buffers of growing size where the only match is at the far end
+*/
+
+#include "stringutils.h"
+#include "ctime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+using namespace std;
+using namespace nVerliHub;
+using namespace nVerliHub::nUtils;
+
+struct sSplit
+{
+	size_t mStart; // offset of the chunk from the end of keyword
+	char mLim;
+	bool mLeft;
+};
+
+struct sMessage
+{
+	const char *mName;
+	string mStr;
+	sSplit mSplits[3];
+};
+
+static volatile size_t sSink = 0; // keeps results alive
+
+// search of SplitOnTwo before, left split scanned up to the end of message
+static size_t OldSplit(const string &str, size_t start, size_t len, char lim, bool left)
+{
+	size_t i;
+
+	if (left) {
+		i = str.find_first_of(lim, start);
+
+		if ((i == str.npos) || ((i - start) >= len))
+			return str.npos;
+	} else {
+		i = str.find_last_of(lim, (start + len) - 1);
+
+		if ((i == str.npos) || (i < start))
+			return str.npos;
+	}
+
+	return i;
+}
+
+// search of SplitOnTwo now, only inside of the chunk
+static size_t NewSplit(const string &str, size_t start, size_t len, char lim, bool left)
+{
+	const char *buf = str.data() + start;
+	const char *pos = (left ? FindChar(buf, len, lim) : FindCharLast(buf, len, lim));
+	return (pos ? (start + (pos - buf)) : str.npos);
+}
+
+// reverse byte loop, same as string::find_last_of with one character
+static const char* ScalarLast(const char *buf, size_t len, char c)
+{
+	const char *pos = buf + len;
+
+	while (pos > buf) {
+		if (*--pos == c)
+			return pos;
+	}
+
+	return NULL;
+}
+
+static const char* ScalarFirst(const char *buf, size_t len, char c)
+{
+	for (const char *end = buf + len; buf < end; buf++) {
+		if (*buf == c)
+			return buf;
+	}
+
+	return NULL;
+}
+
+static double Nsec(const cTime &from, unsigned long count)
+{
+	cTime now;
+	now -= from;
+	return ((now.Sec() * 1000000000.) + (now.tv_usec * 1000.)) / count;
+}
+
+template <size_t (*tSplit)(const string&, size_t, size_t, char, bool)> static double SplitMessage(const sMessage &msg, unsigned int rounds)
+{
+	const size_t len = msg.mStr.size();
+	cTime start;
+
+	for (unsigned int r = 0; r < rounds; r++) {
+		for (int s = 0; s < 3; s++) {
+			const sSplit &split = msg.mSplits[s];
+			sSink += tSplit(msg.mStr, split.mStart, len - split.mStart, split.mLim, split.mLeft);
+		}
+	}
+
+	return Nsec(start, rounds);
+}
+
+template <const char* (*tFind)(const char*, size_t, char)> static double FindIn(const string &buf, char c, unsigned int rounds)
+{
+	cTime start;
+
+	for (unsigned int r = 0; r < rounds; r++)
+		sSink += (size_t)tFind(buf.data(), buf.size(), c);
+
+	return Nsec(start, rounds);
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int rounds = ((argc > 1) ? atoi(argv[1]) : 2000000);
+
+	if (!rounds) {
+		printf("usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	string myinfo = "$MyINFO $ALL bob_the_builder ArchLinux box with a rather long description<ApexDC++ V:1.6.5,M:P,H:12/1/2,S:10,O:5>$ $LAN(T3)\x01$bob@example.org$104857600000$";
+	string sr = "$SR alice Share\\Linux\\distributions\\ubuntu\\releases\\22.04\\ubuntu-22.04-desktop-amd64.iso\x05" "3654957056 3/3\x05TTH:LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ (10.0.0.1:411)\x05" "bob_the_builder";
+	string search = "$Search 192.168.1.20:412 T?F?104857600?1?the$matrix$1999$1080p$bluray$remastered$directors$cut";
+	const sMessage msgs[] = { // splits similar to those in cMessageDC::SplitChunks
+		{"$MyINFO", myinfo, {{13, ' ', true}, {13, '$', true}, {13, '$', false}}},
+		{"$SR", sr, {{4, ' ', true}, {4, '\x05', false}, {4, '\x05', true}}},
+		{"$Search", search, {{8, ' ', true}, {8, '?', false}, {8, ':', true}}}
+	};
+
+	size_t i, n;
+
+	for (i = 0; i < (sizeof(msgs) / sizeof(msgs[0])); i++) { // results must be the same
+		for (n = 0; n < 3; n++) {
+			const sSplit &split = msgs[i].mSplits[n];
+			const size_t len = msgs[i].mStr.size() - split.mStart;
+
+			if (OldSplit(msgs[i].mStr, split.mStart, len, split.mLim, split.mLeft) != NewSplit(msgs[i].mStr, split.mStart, len, split.mLim, split.mLeft)) {
+				printf("split %zu of %s differs\n", n + 1, msgs[i].mName);
+				return 1;
+			}
+		}
+	}
+
+	printf("three splits per message\n");
+
+	for (i = 0; i < (sizeof(msgs) / sizeof(msgs[0])); i++)
+		printf("  %-8s %4zu bytes  scalar %7.1f ns  vector %7.1f ns\n", msgs[i].mName, msgs[i].mStr.size(), SplitMessage<OldSplit>(msgs[i], rounds), SplitMessage<NewSplit>(msgs[i], rounds));
+
+	printf("single search with match at far end\n");
+
+	for (size_t size = 16; size <= 65536; size *= 4) {
+		string buf(size, 'a');
+		buf[size - 1] = '|';
+		const double first = FindIn<ScalarFirst>(buf, '|', rounds / (size / 16)), vfirst = FindIn<FindChar>(buf, '|', rounds / (size / 16));
+		buf[size - 1] = 'a';
+		buf[0] = '|';
+		const double last = FindIn<ScalarLast>(buf, '|', rounds / (size / 16)), vlast = FindIn<FindCharLast>(buf, '|', rounds / (size / 16));
+		printf("  %6zu bytes  first: scalar %9.1f ns  vector %8.1f ns   last: scalar %9.1f ns  vector %8.1f ns\n", size, first, vfirst, last, vlast);
+	}
+
+#ifdef __AVX2__
+	printf("built with avx2\n");
+#else
+	printf("built without avx2, configure with -DCMAKE_CXX_FLAGS=-mavx2 to compare\n");
+#endif
+	return 0;
+}
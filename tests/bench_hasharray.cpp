@@ -0,0 +1,154 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	user list containers, chained tHashArray against open addressing tDenseHashArray
+	usage: bench_hasharray [size]...
+	default sizes are 10000 and 100000, keys are lower case nick hashes like in cUserCollection
+*/
+
+#include "thasharray.h"
+#include "tdensehasharray.h"
+#include "ctime.h"
+#include "cobj.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace std;
+using namespace nVerliHub;
+using namespace nVerliHub::nUtils;
+
+static double Nsec(const cTime &from, unsigned long count)
+{
+	cTime now;
+	now -= from;
+	return ((now.Sec() * 1000000000.) + (now.tv_usec * 1000.)) / count;
+}
+
+static unsigned int sSeed = 777;
+
+static unsigned int Random(unsigned int max)
+{
+	sSeed = (sSeed * 1103515245) + 12345;
+	return (sSeed >> 8) % max;
+}
+
+template <class tArray> static void Bench(const char *name, unsigned int size, const vector<unsigned long> &hashes, vector<int> &values)
+{
+	tArray array(1024); // both grow with number of users
+	unsigned long found = 0;
+	unsigned int i;
+	cTime start;
+
+	for (i = 0; i < size; i++) {
+		array.AddWithHash(&values[i], hashes[i]);
+
+		if (!(i % 1000)) // hub resizes user lists from timer
+			array.AutoResize();
+	}
+
+	const double add = Nsec(start, size);
+	const unsigned int lookups = size * 10;
+	sSeed = 777;
+	start.Get();
+
+	for (i = 0; i < lookups; i++) // existing nicks
+		found += (array.GetByHash(hashes[Random(size)]) != NULL);
+
+	const double hit = Nsec(start, lookups);
+	start.Get();
+
+	for (i = 0; i < lookups; i++) // nicks that are not online
+		found += array.ContainsHash(hashes[size + Random(size)]);
+
+	const double miss = Nsec(start, lookups);
+	const unsigned int churn = size * 4;
+	vector<unsigned int> online(size);
+	unsigned int next = size, pos;
+
+	for (i = 0; i < size; i++)
+		online[i] = i;
+
+	sSeed = 777;
+	start.Get();
+
+	for (i = 0; i < churn; i++) { // random user leaves, new one comes
+		pos = Random(size);
+		array.RemoveByHash(hashes[online[pos]]);
+		online[pos] = next;
+		array.AddWithHash(&values[next], hashes[next]);
+
+		if (++next >= hashes.size())
+			next = 0;
+
+		if (!(i % 1000))
+			array.AutoResize();
+	}
+
+	const double change = Nsec(start, churn);
+	const unsigned int walks = 20000000 / size;
+	long sum = 0;
+	start.Get();
+
+	for (i = 0; i < walks; i++) {
+		for (typename tArray::iterator it = array.begin(); it != array.end(); ++it)
+			sum += *(*it);
+	}
+
+	const double walk = Nsec(start, (unsigned long)walks * size);
+	printf("%-16s %7u  add %6.1f ns  lookup %6.1f ns  miss %6.1f ns  remove and add %6.1f ns  iterate %5.2f ns per element  (%lu %ld)\n", name, size, add, hit, miss, change, walk, found, sum);
+}
+
+int main(int argc, char **argv)
+{
+	vector<unsigned int> sizes;
+	char nick[32];
+
+	for (int i = 1; i < argc; i++)
+		sizes.push_back(atoi(argv[i]));
+
+	if (sizes.empty()) {
+		sizes.push_back(10000);
+		sizes.push_back(100000);
+	}
+
+	cObj::msLogLevel = 0;
+
+	for (size_t s = 0; s < sizes.size(); s++) {
+		const unsigned int size = sizes[s];
+
+		if (!size)
+			continue;
+
+		vector<unsigned long> hashes;
+		vector<int> values(size * 6, 1);
+
+		for (unsigned int i = 0; i < (size * 6); i++) { // first size are online, second size are looked up but not online, rest join later
+			sprintf(nick, "[ISP]User_%u", i * 7919);
+			hashes.push_back(tDenseHashArray<int*>::HashLowerString(nick));
+		}
+
+		Bench<tHashArray<int*> >("tHashArray", size, hashes, values);
+		Bench<tDenseHashArray<int*> >("tDenseHashArray", size, hashes, values);
+	}
+
+	return 0;
+}
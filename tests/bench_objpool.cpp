@@ -0,0 +1,175 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	connect and disconnect storm over pooled connection, user and parser objects
+	usage: bench_objpool [cycles] [live connections]
+	each cycle deletes objects of one random connection and creates new ones, like a client reconnecting
+	classes with one extra pointer have different size, so they bypass the pools and show cost of plain allocation
+	connection object needs a running server, so block of its size stands in for it
+*/
+
+#include "cconndc.h"
+#include "cuser.h"
+#include "cmessagedc.h"
+#include "tobjpool.h"
+#include "ctime.h"
+#include "cobj.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+using namespace nVerliHub;
+using namespace nVerliHub::nUtils;
+using namespace nVerliHub::nProtocol;
+
+static unsigned long sNews = 0;
+
+void* operator new(size_t size)
+{
+	sNews++;
+	void *ptr = malloc(size ? size : 1);
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+struct sPoolConn
+{
+	char mData[sizeof(cConnDC)];
+
+	static void* operator new(size_t size)
+	{
+		return tObjPool<sPoolConn>::Alloc(size);
+	}
+
+	static void operator delete(void *ptr, size_t size)
+	{
+		tObjPool<sPoolConn>::Free(ptr, size);
+	}
+};
+
+struct sPlainConn
+{
+	char mData[sizeof(cConnDC)];
+};
+
+struct sPlainUser: public cUser
+{
+	sPlainUser(const string &nick):
+		cUser(nick),
+		mPad(NULL)
+	{}
+
+	void *mPad; // pointer cant fit into tail padding of base class
+};
+
+struct sPlainParser: public cMessageDC
+{
+	sPlainParser():
+		mPad(NULL)
+	{}
+
+	void *mPad;
+};
+
+static_assert(sizeof(sPlainUser) != sizeof(cUser), "plain user would be pooled");
+static_assert(sizeof(sPlainParser) != sizeof(cMessageDC), "plain parser would be pooled");
+
+template <class tConn, class tUser, class tParser> struct sSlot
+{
+	tConn *mConn;
+	tUser *mUser;
+	tParser *mParser;
+};
+
+template <class tConn, class tUser, class tParser> static void Bench(const char *name, unsigned int cycles, unsigned int live)
+{
+	vector<sSlot<tConn, tUser, tParser> > slots(live);
+	char nick[32];
+	unsigned int rnd = 12345;
+
+	for (unsigned int i = 0; i < live; i++) {
+		sprintf(nick, "user%u", i);
+		slots[i].mConn = new tConn;
+		slots[i].mUser = new tUser(nick);
+		slots[i].mParser = new tParser;
+	}
+
+	const unsigned long news = sNews;
+	cTime start;
+
+	for (unsigned int i = 0; i < cycles; i++) {
+		rnd = (rnd * 1103515245) + 12345;
+		sSlot<tConn, tUser, tParser> &slot = slots[(rnd >> 8) % live];
+		delete slot.mParser;
+		delete slot.mUser;
+		delete slot.mConn;
+		sprintf(nick, "reconnect%u", i);
+		slot.mConn = new tConn;
+		slot.mUser = new tUser(nick);
+		slot.mParser = new tParser;
+	}
+
+	cTime took;
+	took -= start;
+	const double usec = (took.Sec() * 1000000.) + took.tv_usec;
+	printf("%-6s %u cycles with %u live  %8.0f us  %6.3f us/cycle  allocations %lu (%.2f/cycle)\n", name, cycles, live, usec, usec / cycles, sNews - news, double(sNews - news) / cycles);
+
+	for (unsigned int i = 0; i < live; i++) {
+		delete slots[i].mParser;
+		delete slots[i].mUser;
+		delete slots[i].mConn;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int cycles = ((argc > 1) ? atoi(argv[1]) : 20000);
+	const unsigned int live = ((argc > 2) ? atoi(argv[2]) : 5000);
+
+	if (!cycles || !live) {
+		printf("usage: %s [cycles] [live connections]\n", argv[0]);
+		return 1;
+	}
+
+	cObj::msLogLevel = 0;
+
+	for (int r = 0; r < 3; r++) {
+		Bench<sPlainConn, sPlainUser, sPlainParser>("plain", cycles, live);
+		Bench<sPoolConn, cUser, cMessageDC>("pooled", cycles, live);
+	}
+
+	printf("user pool: peak %lu, reused %lu, pooled %lu\n", tObjPool<cUser>::sPeak, tObjPool<cUser>::sReused, tObjPool<cUser>::sPooled);
+	return 0;
+}
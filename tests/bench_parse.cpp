@@ -0,0 +1,188 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	throughput of protocol command dispatch and chunk splitting over recorded mix of protocol lines
+	usage: bench_parse [rounds] [file]
+	default file is protocol_mix.txt in tests directory, one protocol line per line, without separator
+	old dispatch, that tried every command in turn, is kept here as reference and must give same results
+*/
+
+#include "cmessagedc.h"
+#include "cprotocommand.h"
+#include "ctime.h"
+#include "cobj.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <vector>
+
+using namespace nVerliHub;
+using namespace nVerliHub::nProtocol;
+using namespace nVerliHub::nEnums;
+using namespace nVerliHub::nUtils;
+
+// copy of sDC_Commands from cmessagedc.cpp, in the same order
+static const cProtoCommand sLinearCommands[] =
+{
+	cProtoCommand("$ConnectToMe "),
+	cProtoCommand("$RevConnectToMe "),
+	cProtoCommand("$SR "),
+	cProtoCommand("$Search Hub:"),
+	cProtoCommand("$Search "),
+	cProtoCommand("$SA "),
+	cProtoCommand("$SP "),
+	cProtoCommand("$MyINFO "),
+	cProtoCommand("$ExtJSON "),
+	cProtoCommand("$Key "),
+	cProtoCommand("$Supports "),
+	cProtoCommand("$ValidateNick "),
+	cProtoCommand("$Version "),
+	cProtoCommand("$GetNickList"),
+	cProtoCommand("$MyHubURL "),
+	cProtoCommand("$MyPass "),
+	cProtoCommand("$To: "),
+	cProtoCommand("$BotINFO "),
+	cProtoCommand("$GetINFO "),
+	cProtoCommand("$UserIP "),
+	cProtoCommand("$Kick "),
+	cProtoCommand("$OpForceMove $Who:"),
+	cProtoCommand("$MultiConnectToMe "),
+	cProtoCommand("$MultiSearch Hub:"),
+	cProtoCommand("$MultiSearch "),
+	cProtoCommand("$MCTo: "),
+	cProtoCommand("$Quit "),
+	cProtoCommand("$Ban "),
+	cProtoCommand("$TempBan "),
+	cProtoCommand("$UnBan "),
+	cProtoCommand("$GetBanList"),
+	cProtoCommand("$WhoIP "),
+	cProtoCommand("$GetTopic"),
+	cProtoCommand("$SetTopic "),
+	cProtoCommand("$MyIP "),
+	cProtoCommand("$MyNick "),
+	cProtoCommand("$Lock "),
+	cProtoCommand("$IN "),
+	cProtoCommand("<")
+};
+
+static_assert((sizeof(sLinearCommands) / sizeof(sLinearCommands[0])) == (eDC_CHAT + 1), "command table changed, update the copy");
+
+// dispatch as it was done before, every command is compared in turn
+static int LinearParse(const string &str)
+{
+	if (str.empty())
+		return eDC_UNKNOWN;
+
+	if (str[0] == '<')
+		return eDC_CHAT;
+
+	for (unsigned int i = 0; i < eDC_CHAT; i++) {
+		if (sLinearCommands[i].AreYou(str))
+			return i;
+	}
+
+	return eDC_UNKNOWN;
+}
+
+static double Usec(const cTime &from)
+{
+	cTime now;
+	now -= from;
+	return (now.Sec() * 1000000.) + now.tv_usec;
+}
+
+static void Report(const char *name, size_t lines, double usec, unsigned long check)
+{
+	printf("%-24s %8.2f million lines/s  (%lu)\n", name, lines / usec, check);
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int rounds = ((argc > 1) ? atoi(argv[1]) : 20000);
+	const char *path = ((argc > 2) ? argv[2] : TESTS_DATA_DIR "/protocol_mix.txt");
+	ifstream file(path, ios::binary);
+	vector<string> mix;
+	string line;
+
+	while (getline(file, line))
+		mix.push_back(line);
+
+	if (mix.empty() || !rounds) {
+		printf("usage: %s [rounds] [file], cant read %s\n", argv[0], path);
+		return 1;
+	}
+
+	cObj::msLogLevel = 0;
+	cMessageDC msg;
+	unsigned long check = 0;
+	size_t i, r;
+
+	for (i = 0; i < mix.size(); i++) { // both dispatches must agree on every line
+		msg.ReInit();
+		msg.mStr = mix[i];
+		const int type = msg.Parse();
+
+		if (type != LinearParse(mix[i])) {
+			printf("mismatch on line %zu: %d, linear search gives %d\n", i + 1, type, LinearParse(mix[i]));
+			return 1;
+		}
+	}
+
+	const size_t total = rounds * mix.size();
+	cTime start;
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < mix.size(); i++) { // same message setup as below, so only dispatch differs
+			msg.ReInit();
+			msg.mStr = mix[i];
+			check += LinearParse(msg.mStr);
+		}
+	}
+
+	Report("linear dispatch", total, Usec(start), check);
+	check = 0;
+	start.Get();
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < mix.size(); i++) {
+			msg.ReInit();
+			msg.mStr = mix[i];
+			check += msg.Parse();
+		}
+	}
+
+	Report("parse", total, Usec(start), check);
+	check = 0;
+	start.Get();
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < mix.size(); i++) {
+			msg.ReInit();
+			msg.mStr = mix[i];
+			msg.Parse();
+			check += msg.SplitChunks();
+		}
+	}
+
+	Report("parse and split chunks", total, Usec(start), check);
+	printf("%zu lines in mix, %u rounds\n", mix.size(), rounds);
+	return 0;
+}
@@ -0,0 +1,80 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	client tag parsing with single pass parser against regular expressions it replaced
+	usage: bench_tagparser [rounds]
+	descriptions are taken from tags.txt, same as for the differential test
+*/
+
+#include "tagparser_regex.h"
+#include "ctime.h"
+#include "cobj.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static double Nsec(const cTime &from, unsigned long count)
+{
+	cTime now;
+	now -= from;
+	return ((now.Sec() * 1000000000.) + (now.tv_usec * 1000.)) / count;
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int rounds = ((argc > 1) ? atoi(argv[1]) : 500);
+	cRegexTagParser regex;
+	vector<string> tags;
+	sTagFields fields;
+	unsigned long check = 0;
+	unsigned int r;
+	size_t i;
+
+	if (!rounds || !LoadTags(tags)) {
+		printf("usage: %s [rounds], tags.txt must be in tests directory\n", argv[0]);
+		return 1;
+	}
+
+	cObj::msLogLevel = 0;
+	const unsigned long count = rounds * tags.size();
+	cTime start;
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < tags.size(); i++) {
+			regex.Parse(tags[i], 3, fields);
+			check += fields.mSlots;
+		}
+	}
+
+	printf("regular expressions  %8.1f ns per description  (%lu)\n", Nsec(start, count), check);
+	check = 0;
+	start.Get();
+
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < tags.size(); i++) {
+			ParseTagFields(tags[i], 3, fields);
+			check += fields.mSlots;
+		}
+	}
+
+	printf("single pass parser   %8.1f ns per description  (%lu)\n", Nsec(start, count), check);
+	printf("%zu descriptions, %u rounds\n", tags.size(), rounds);
+	return 0;
+}
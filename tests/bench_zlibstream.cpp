@@ -0,0 +1,203 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	compression ratio and cpu time of per flush zlib blocks against persistent zlib stream
+	usage: bench_zlibstream [megabytes] [file]
+	default file is protocol_mix.txt in tests directory, one protocol line per line, without separator
+	outgoing traffic is made of lines picked from the file at random, it is cut into flushes of given minimum size
+	block mode follows the hub: flushes shorter than zlib_min_len and blocks that do not shrink are sent raw
+	stream output is inflated back and must match the traffic
+*/
+
+#include "czlib.h"
+#include "ctime.h"
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <vector>
+
+using namespace nVerliHub::nUtils;
+
+// default of zlib_min_len
+#define BLOCK_MIN_LEN 100
+
+static double Usec(const cTime &from)
+{
+	cTime now;
+	now -= from;
+	return (now.Sec() * 1000000.) + now.tv_usec;
+}
+
+// join lines into flushes of at least given size, zero means every line is flushed alone
+static void MakeFlushes(const vector<string> &lines, size_t size, vector<string> &flushes)
+{
+	string cur;
+	flushes.clear();
+
+	for (size_t i = 0; i < lines.size(); i++) {
+		cur += lines[i];
+
+		if (cur.size() >= size) {
+			flushes.push_back(cur);
+			cur.clear();
+		}
+	}
+
+	if (cur.size())
+		flushes.push_back(cur);
+}
+
+static size_t Block(const vector<string> &flushes, int level)
+{
+	cZLib zlib;
+	size_t out = 0, len;
+	int err;
+
+	for (size_t i = 0; i < flushes.size(); i++) {
+		len = 0;
+
+		if ((flushes[i].size() >= BLOCK_MIN_LEN) && zlib.Compress(flushes[i].data(), flushes[i].size(), len, err, level))
+			out += len;
+		else
+			out += flushes[i].size();
+	}
+
+	return out;
+}
+
+static size_t Stream(const vector<string> &flushes, int level, int window, int memlevel, string *keep)
+{
+	cZLibStream stream(level, window, memlevel);
+	size_t out = 0, len;
+	const char *buf;
+
+	for (size_t i = 0; i < flushes.size(); i++) {
+		if (!(buf = stream.Compress(flushes[i].data(), flushes[i].size(), len)))
+			return 0;
+
+		out += len;
+
+		if (keep)
+			keep->append(buf, len);
+	}
+
+	return out;
+}
+
+// inflate stream output without $ZOn and compare it to traffic
+static bool Verify(const string &zipped, const string &traffic)
+{
+	if (zipped.compare(0, ZON_LEN, "$ZOn|"))
+		return false;
+
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+
+	if (inflateInit(&strm) != Z_OK)
+		return false;
+
+	string out(traffic.size() + 1, '\0');
+	strm.next_in = (Bytef*)(zipped.data() + ZON_LEN);
+	strm.avail_in = (uInt)(zipped.size() - ZON_LEN);
+	strm.next_out = (Bytef*)&out[0];
+	strm.avail_out = (uInt)out.size();
+	const int res = inflate(&strm, Z_SYNC_FLUSH);
+	out.resize(out.size() - strm.avail_out);
+	inflateEnd(&strm);
+	return ((res == Z_OK) || (res == Z_BUF_ERROR)) && (out == traffic);
+}
+
+static void Report(const char *flush, const char *mode, int level, size_t in, size_t out, double usec)
+{
+	printf("%-10s %-18s %6d %8.3f %9.1f\n", flush, mode, level, (double)out / in, (usec * 1000.) / in);
+}
+
+int main(int argc, char **argv)
+{
+	const unsigned int megs = ((argc > 1) ? atoi(argv[1]) : 4);
+	const char *path = ((argc > 2) ? argv[2] : TESTS_DATA_DIR "/protocol_mix.txt");
+	ifstream file(path, ios::binary);
+	vector<string> mix;
+	string line;
+
+	while (getline(file, line)) {
+		if (line.size())
+			mix.push_back(line + '|');
+	}
+
+	if (mix.empty() || !megs) {
+		printf("usage: %s [megabytes] [file], cant read %s\n", argv[0], path);
+		return 1;
+	}
+
+	vector<string> lines;
+	string traffic;
+	srand(1);
+
+	while (traffic.size() < (megs << 20)) {
+		lines.push_back(mix[rand() % mix.size()]);
+		traffic += lines.back();
+	}
+
+	const struct { const char *mName; size_t mSize; } flushes[] = { { "per line", 0 }, { "512 B", 512 }, { "4 KiB", 4096 } };
+	const struct { int mWindow, mMemLevel; } streams[] = { { 13, 6 }, { 15, 8 } }; // default of zlib_stream_window and zlib_stream_memlevel, and zlib default
+	const int levels[] = { 1, 6 }; // note: zlib_compress_level default of -1 is raised to 1 by both classes
+	vector<string> parts;
+	char name[32];
+	string zipped;
+	size_t out;
+	cTime start;
+
+	printf("%-10s %-18s %6s %8s %9s\n", "flush", "mode", "level", "ratio", "ns/byte");
+
+	for (size_t f = 0; f < (sizeof(flushes) / sizeof(flushes[0])); f++) {
+		MakeFlushes(lines, flushes[f].mSize, parts);
+
+		for (size_t l = 0; l < (sizeof(levels) / sizeof(levels[0])); l++) {
+			start.Get();
+			out = Block(parts, levels[l]);
+			Report(flushes[f].mName, "block", levels[l], traffic.size(), out, Usec(start));
+
+			for (size_t s = 0; s < (sizeof(streams) / sizeof(streams[0])); s++) {
+				start.Get();
+				out = Stream(parts, levels[l], streams[s].mWindow, streams[s].mMemLevel, NULL);
+				const double usec = Usec(start);
+				zipped.clear();
+
+				if (!out || (Stream(parts, levels[l], streams[s].mWindow, streams[s].mMemLevel, &zipped) != out) || !Verify(zipped, traffic)) {
+					printf("stream %d/%d at level %d does not inflate back to traffic\n", streams[s].mWindow, streams[s].mMemLevel, levels[l]);
+					return 1;
+				}
+
+				snprintf(name, sizeof(name), "stream %d/%d", streams[s].mWindow, streams[s].mMemLevel);
+				Report(flushes[f].mName, name, levels[l], traffic.size(), out, usec);
+			}
+		}
+	}
+
+	printf("%zu bytes of traffic in %zu lines picked from %zu lines of file\n", traffic.size(), lines.size(), mix.size());
+
+	for (size_t s = 0; s < (sizeof(streams) / sizeof(streams[0])); s++) // deflate state size as documented by zlib
+		printf("stream %d/%d keeps about %d KiB per connection\n", streams[s].mWindow, streams[s].mMemLevel, ((1 << (streams[s].mWindow + 2)) + (1 << (streams[s].mMemLevel + 9))) >> 10);
+
+	return 0;
+}
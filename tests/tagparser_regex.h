@@ -0,0 +1,248 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef VERLIHUB_TESTS_TAGPARSER_REGEX_H
+#define VERLIHUB_TESTS_TAGPARSER_REGEX_H
+
+#include "cdcclients.h"
+#include "cdctag.h"
+#include "cpcre.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace nVerliHub;
+using namespace nVerliHub::nEnums;
+using namespace nVerliHub::nUtils;
+
+// everything tag parsing gives about a description
+struct sTagFields
+{
+	int mPos;
+	string mTag, mTagBody, mTagID;
+	double mClientVersion;
+	int mTotHubs, mHubsUsr, mHubsReg, mHubsOp, mSlots, mLimit;
+	int mClientMode;
+
+	bool operator==(const sTagFields &f) const
+	{
+		return (mPos == f.mPos) && (mTag == f.mTag) && (mTagBody == f.mTagBody) && (mTagID == f.mTagID) && (mClientVersion == f.mClientVersion) && (mTotHubs == f.mTotHubs) && (mHubsUsr == f.mHubsUsr) && (mHubsReg == f.mHubsReg) && (mHubsOp == f.mHubsOp) && (mSlots == f.mSlots) && (mLimit == f.mLimit) && (mClientMode == f.mClientMode);
+	}
+
+	void Set(const cDCTag &tag, int pos)
+	{
+		mPos = pos;
+		mTag = tag.mTag;
+		mTagBody = tag.mTagBody;
+		mTagID = tag.mTagID;
+		mClientVersion = tag.mClientVersion;
+		mTotHubs = tag.mTotHubs;
+		mHubsUsr = tag.mHubsUsr;
+		mHubsReg = tag.mHubsReg;
+		mHubsOp = tag.mHubsOp;
+		mSlots = tag.mSlots;
+		mLimit = tag.mLimit;
+		mClientMode = tag.mClientMode;
+	}
+};
+
+inline ostream& operator<<(ostream &os, const sTagFields &f)
+{
+	os << "pos=" << f.mPos << " tag=[" << f.mTag << "] id=[" << f.mTagID << "] body=[" << f.mTagBody << "] version=" << f.mClientVersion << " mode=" << f.mClientMode;
+	os << " hubs=" << f.mTotHubs << '/' << f.mHubsUsr << '/' << f.mHubsReg << '/' << f.mHubsOp << " slots=" << f.mSlots << " limit=" << f.mLimit;
+	return os;
+}
+
+// tag parsing as it was done by cDCClients::ParseTag with six regular expressions, hub summing mode is passed instead of read from config
+class cRegexTagParser
+{
+public:
+	cRegexTagParser()
+	{
+		if (!mTagRE.Compile("(<(.+) +v?(.+)>)?<(.+?) +[Vv]\\:?([^,]+),([^>]*)>") || !mVersRE.Compile("\\(?r?([\\d\\.]+)\\)?(\\-[^\\d]+(\\d+)?)?(\\-(\\d+))?") || !mModeRE.Compile("[Mm]\\:([^,]+)") || !mHubsRE.Compile("[Hh]\\:(\\d+)(\\/\\d+)?(\\/\\d+)?") || !mSlotsRE.Compile("[Ss]\\:(\\d+)") || !mLimitRE.Compile("([Bb]\\:|[Ll]\\:|[Ff]\\:\\d+\\/)(\\d+(\\.\\d)?)"))
+			throw "Error in tag regular expressions";
+	}
+
+	void Parse(const string &desc, int sum_hubs, sTagFields &fields)
+	{
+		string str, ver("0");
+		cDCTag tag(NULL);
+
+		enum {
+			eTP_COMPLETE,
+			eTP_PREFIX, eTP_PTAGID, eTP_PVERSION,
+			eTP_TAGID, eTP_VERSION,
+			eTP_BODY
+		};
+
+		enum {
+			eVP_COMPLETE,
+			eVP_MAINVER,
+			eVP_CRAPINFO, eVP_CRAPNUM,
+			eVP_BUILDINFO, eVP_BUILDVER
+		};
+
+		tag.mClientMode = eCM_NOTAG;
+		int pos = -1;
+
+		if (mTagRE.Exec(desc) >= 3) {
+			pos = mTagRE.StartOf(eTP_COMPLETE);
+			mTagRE.Extract(eTP_COMPLETE, desc, tag.mTag);
+			mTagRE.Extract(eTP_BODY, desc, tag.mTagBody);
+			mTagRE.Extract(eTP_TAGID, desc, tag.mTagID);
+			mTagRE.Extract(eTP_VERSION, desc, str);
+
+			if (mVersRE.Exec(str) >= 1) {
+				mVersRE.Extract(eVP_MAINVER, str, ver);
+
+				if (mVersRE.PartFound(eVP_BUILDINFO)) {
+					mVersRE.Extract(eVP_BUILDVER, str, str);
+					ver.append(1, '.');
+					ver.append(str);
+				}
+
+				size_t dot = ver.find('.');
+
+				if (dot != ver.npos) {
+					dot = ver.find('.', dot + 1);
+
+					while (dot != ver.npos) {
+						ver.erase(dot, 1);
+						dot = ver.find('.', dot);
+					}
+				}
+			}
+		}
+
+		if (mModeRE.Exec(tag.mTagBody) >= 1) {
+			mModeRE.Extract(1, tag.mTagBody, str);
+
+			if ((str == "A") || (str == "AA") || (str == "AP") || (str == "A5") || (str == "AN"))
+				tag.mClientMode = eCM_ACTIVE;
+			else if ((str == "P") || (str == "PP") || (str == "PA") || (str == "P5") || (str == "PN"))
+				tag.mClientMode = eCM_PASSIVE;
+			else if ((str == "5") || (str == "55") || (str == "5A") || (str == "5P") || (str == "5N"))
+				tag.mClientMode = eCM_SOCK5;
+			else
+				tag.mClientMode = eCM_OTHER;
+		}
+
+		istringstream is(ver);
+		is >> tag.mClientVersion;
+		is.clear();
+
+		int hubs = -1, hubs_usr = -1, hubs_reg = -1, hubs_op = -1, tmp;
+		char c;
+
+		if (mHubsRE.Exec(tag.mTagBody) >= 1) {
+			mHubsRE.Extract(1, tag.mTagBody, str);
+			is.str(str);
+			is >> hubs;
+			is.clear();
+			hubs_usr = hubs;
+
+			if (mHubsRE.PartFound(2)) {
+				tmp = 0;
+				mHubsRE.Extract(2, tag.mTagBody, str);
+				is.str(str);
+				is >> c >> tmp;
+				is.clear();
+
+				if (sum_hubs >= 2)
+					hubs += tmp;
+
+				hubs_reg = tmp;
+			}
+
+			if (mHubsRE.PartFound(3)) {
+				tmp = 0;
+				mHubsRE.Extract(3, tag.mTagBody, str);
+				is.str(str);
+				is >> c >> tmp;
+				is.clear();
+
+				if (sum_hubs >= 3)
+					hubs += tmp;
+
+				hubs_op = tmp;
+			}
+
+			tag.mTotHubs = hubs;
+			tag.mHubsUsr = hubs_usr;
+			tag.mHubsReg = hubs_reg;
+			tag.mHubsOp = hubs_op;
+		}
+
+		if (mSlotsRE.Exec(tag.mTagBody) >= 1) {
+			mSlotsRE.Extract(1, tag.mTagBody, str);
+			is.str(str);
+			is >> tag.mSlots;
+			is.clear();
+		}
+
+		if (mLimitRE.Exec(tag.mTagBody) >= 2) {
+			mLimitRE.Extract(2, tag.mTagBody, str);
+			is.str(str);
+			is >> tag.mLimit;
+			is.clear();
+		}
+
+		fields.Set(tag, pos);
+	}
+
+private:
+	cPCRE mTagRE, mVersRE, mModeRE, mHubsRE, mSlotsRE, mLimitRE;
+};
+
+// same steps as cDCClients::ParseTag does now
+inline void ParseTagFields(const string &desc, int sum_hubs, sTagFields &fields)
+{
+	cDCTag tag(NULL);
+	cDCTagParser::sTagPos pos;
+	int start = -1;
+	tag.mClientMode = eCM_NOTAG;
+
+	if (cDCTagParser::FindTag(desc, pos)) {
+		start = pos.mStart;
+		tag.mTag.assign(desc, pos.mStart, pos.mEnd - pos.mStart);
+		tag.mTagBody.assign(desc, pos.mBody, pos.mBodyLen);
+		tag.mTagID.assign(desc, pos.mID, pos.mIDLen);
+		tag.mClientVersion = cDCTagParser::ParseVersion(desc.data() + pos.mVers, pos.mVersLen);
+		cDCTagParser::ParseBody(&tag, sum_hubs);
+	}
+
+	fields.Set(tag, start);
+}
+
+// descriptions from corpus file, one per line
+inline bool LoadTags(vector<string> &tags)
+{
+	ifstream file(TESTS_DATA_DIR "/tags.txt", ios::binary);
+	string line;
+
+	while (getline(file, line))
+		tags.push_back(line);
+
+	return !tags.empty();
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+#ifndef VERLIHUB_TESTS_TEST_H
+#define VERLIHUB_TESTS_TEST_H
+
+#include <iostream>
+
+// minimal checks for unit tests, every failed check is reported and test exits with non zero code
+static int sTestFailures = 0;
+
+#define TEST_CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " << #cond << std::endl; \
+			sTestFailures++; \
+		} \
+	} while (0)
+
+#define TEST_RESULT() (sTestFailures ? 1 : 0)
+
+#endif
@@ -0,0 +1,235 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	random operations on tDenseHashArray checked against std::unordered_map
+	hashes are taken from small ranges and multiples of table sizes, so clusters, wrap around and backward shift removal are exercised
+	iteration removes current and already visited elements, like cServerDC::OnTimer and cBanList do
+*/
+
+#include "test.h"
+#include "tdensehasharray.h"
+#include "cobj.h"
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace nVerliHub;
+using namespace nVerliHub::nUtils;
+
+typedef tDenseHashArray<int*> tArray;
+typedef unordered_map<tArray::tHashType, int*> tModel;
+
+// counts events
+class cCountedArray: public tArray
+{
+public:
+	cCountedArray():
+		tArray(16),
+		mAdded(0),
+		mRemoved(0)
+	{}
+
+	virtual void OnAdd(int*)
+	{
+		mAdded++;
+	}
+
+	virtual void OnRemove(int*)
+	{
+		mRemoved++;
+	}
+
+	unsigned long mAdded, mRemoved;
+};
+
+static unsigned int sSeed = 4321;
+
+static unsigned int Random(unsigned int max)
+{
+	sSeed = (sSeed * 1103515245) + 12345;
+	return (sSeed >> 8) % max;
+}
+
+static vector<int> sValues(1024); // elements point here
+
+static int* RandomValue()
+{
+	return &sValues[Random(sValues.size())];
+}
+
+static tArray::tHashType RandomHash()
+{
+	switch (Random(4)) {
+		case 0: // dense range, long clusters
+			return Random(64);
+		case 1: // same low bits
+			return (tArray::tHashType)Random(64) << 20;
+		case 2: // high bits
+			return ~(tArray::tHashType)Random(64);
+		default:
+			return ((tArray::tHashType)Random(0x10000) << 16) | Random(0x10000);
+	}
+}
+
+static bool Same(const cCountedArray &array, const tModel &model)
+{
+	if (array.Size() != model.size())
+		return false;
+
+	tModel seen;
+
+	for (tArray::iterator it = array.begin(); it != array.end(); ++it) {
+		if (!seen.insert(tModel::value_type(it.Hash(), *it)).second) // visited twice
+			return false;
+	}
+
+	if (seen != model)
+		return false;
+
+	for (tModel::const_iterator it = model.begin(); it != model.end(); ++it) {
+		if (!array.ContainsHash(it->first) || (array.GetByHash(it->first) != it->second))
+			return false;
+	}
+
+	return true;
+}
+
+// remove some of the elements while iterating, every element must be visited once
+static void IterateRemoving(cCountedArray &array, tModel &model)
+{
+	tModel visited, before(model);
+	vector<tArray::tHashType> done;
+
+	for (tArray::iterator it = array.begin(); it != array.end(); ++it) {
+		TEST_CHECK(model.count(it.Hash()) && (model[it.Hash()] == *it));
+		TEST_CHECK(visited.insert(tModel::value_type(it.Hash(), *it)).second);
+		done.push_back(it.Hash());
+
+		switch (Random(4)) {
+			case 0: // current one
+				TEST_CHECK(array.RemoveByHash(it.Hash()));
+				model.erase(done.back());
+				done.pop_back();
+				break;
+			case 1: // one of already visited
+				if (done.size()) {
+					const size_t pos = Random(done.size());
+					TEST_CHECK(array.RemoveByHash(done[pos]));
+					model.erase(done[pos]);
+					done.erase(done.begin() + pos);
+				}
+
+				break;
+			default:
+				break;
+		}
+	}
+
+	TEST_CHECK(visited == before);
+}
+
+int main()
+{
+	cObj::msLogLevel = 0;
+	cCountedArray array;
+	tModel model;
+	tArray::tHashType hash;
+	unsigned long cleared = 0, events;
+	int *value;
+
+	for (unsigned int step = 0; step < 300000; step++) {
+		const unsigned int op = Random(100);
+		hash = RandomHash();
+
+		if (op < 45) { // add
+			value = RandomValue();
+			const bool is_new = !model.count(hash);
+			events = array.mAdded;
+			TEST_CHECK(array.AddWithHash(value, hash) == is_new);
+			TEST_CHECK((array.mAdded - events) == (is_new ? 1 : 0));
+
+			if (is_new)
+				model[hash] = value;
+		} else if (op < 80) { // remove, existing one most of times
+			if (model.size() && Random(4)) {
+				tModel::iterator it = model.begin();
+				advance(it, Random(model.size() < 32 ? model.size() : 32));
+				hash = it->first;
+			}
+
+			const bool exists = model.count(hash);
+			events = array.mRemoved;
+			TEST_CHECK(array.RemoveByHash(hash) == exists);
+			TEST_CHECK((array.mRemoved - events) == (exists ? 1 : 0));
+
+			if (exists)
+				model.erase(hash);
+		} else if (op < 90) { // lookup
+			tModel::iterator it = model.find(hash);
+			TEST_CHECK(array.ContainsHash(hash) == (it != model.end()));
+			TEST_CHECK(array.GetByHash(hash) == ((it != model.end()) ? it->second : NULL));
+		} else if (op < 94) { // replace
+			value = RandomValue();
+			const bool exists = model.count(hash);
+			TEST_CHECK(array.SetByHash(hash, value) == exists);
+
+			if (exists)
+				model[hash] = value;
+		} else if (op < 97) {
+			array.AutoResize();
+		} else if (op < 99) {
+			array.Resize(Random(2048));
+		} else if (!Random(20)) {
+			IterateRemoving(array, model);
+		} else if (!Random(50)) { // clear, events are not called
+			cleared += array.Size();
+			array.Clear();
+			model.clear();
+		}
+
+		if (!(step % 1000) || (model.size() < 4)) {
+			if (!Same(array, model)) {
+				TEST_CHECK(!"container differs from model");
+				break;
+			}
+
+			TEST_CHECK((array.mAdded - array.mRemoved - cleared) == array.Size());
+		}
+	}
+
+	for (int round = 0; round < 200; round++) { // bigger tables, iteration with removal
+		for (unsigned int i = Random(5000); i; i--) {
+			hash = RandomHash();
+
+			if (array.AddWithHash(RandomValue(), hash))
+				model[hash] = array.GetByHash(hash);
+		}
+
+		IterateRemoving(array, model);
+		TEST_CHECK(Same(array, model));
+		array.AutoResize();
+		TEST_CHECK(Same(array, model));
+	}
+
+	TEST_CHECK((array.mAdded - array.mRemoved - cleared) == array.Size());
+	cout << "final size " << array.Size() << ", capacity " << array.Capacity() << ", " << array.mAdded << " added, " << array.mRemoved << " removed" << endl;
+	return TEST_RESULT();
+}
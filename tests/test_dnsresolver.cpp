@@ -0,0 +1,160 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	cDNSResolver with a local stub resolver instead of name servers
+*/
+
+#include "test.h"
+#include "cdnsresolver.h"
+#include <atomic>
+#include <unistd.h>
+
+using namespace nVerliHub::nSocket;
+
+#define IP_NAMED 0x0A000001 // 10.0.0.1
+#define IP_UNNAMED 0x0A000002 // 10.0.0.2
+#define IP_SLOW 0x0A000003 // 10.0.0.3
+#define IP_NOCACHE 0x0A000004 // 10.0.0.4
+
+static std::atomic<bool> sSlowRelease(false);
+static std::atomic<int> sCalls(0);
+
+static bool StubResolve(unsigned long ip, string &host)
+{
+	sCalls++;
+
+	switch (ip) {
+		case IP_NAMED:
+			host = "named.example";
+			return true;
+		case IP_SLOW: // name server that does not answer in time
+			while (!sSlowRelease)
+				usleep(1000);
+
+			host = "slow.example";
+			return true;
+		case IP_NOCACHE:
+			host = "nocache.example";
+			return true;
+		default:
+			return false;
+	}
+}
+
+// wait until worker threads finish some lookups and collect them
+static void WaitCollect(cDNSResolver &res, vector<cDNSResolver::sResult> &done, long now, unsigned int ms = 2000)
+{
+	done.clear();
+
+	while (!res.HasResults() && ms--)
+		usleep(1000);
+
+	res.Collect(done, now);
+}
+
+static const string* FindResult(const vector<cDNSResolver::sResult> &done, unsigned long ip)
+{
+	for (vector<cDNSResolver::sResult>::const_iterator it = done.begin(); it != done.end(); ++it) {
+		if (it->mIP == ip)
+			return &it->mHost;
+	}
+
+	return NULL;
+}
+
+static void TestPositive(cDNSResolver &res)
+{
+	vector<cDNSResolver::sResult> done;
+	string host;
+	res.mTTL = 60;
+	res.Request(IP_NAMED);
+	TEST_CHECK(!res.Find(IP_NAMED, host, 1000)); // running
+	WaitCollect(res, done, 1000);
+	TEST_CHECK(FindResult(done, IP_NAMED) && (*FindResult(done, IP_NAMED) == "named.example"));
+	TEST_CHECK(res.Find(IP_NAMED, host, 1059) && (host == "named.example"));
+	TEST_CHECK(!res.Find(IP_NAMED, host, 1060)); // expired
+	res.Purge(1060);
+	TEST_CHECK(res.Size() == 0);
+}
+
+static void TestNegative(cDNSResolver &res)
+{
+	vector<cDNSResolver::sResult> done;
+	string host = "x";
+	res.mTTL = 3600;
+	res.mNegTTL = 30;
+	res.Request(IP_UNNAMED);
+	WaitCollect(res, done, 2000);
+	TEST_CHECK(FindResult(done, IP_UNNAMED) && FindResult(done, IP_UNNAMED)->empty());
+	TEST_CHECK(res.Find(IP_UNNAMED, host, 2029) && host.empty()); // kept for negative ttl, not for positive one
+	TEST_CHECK(!res.Find(IP_UNNAMED, host, 2030));
+	res.Purge(2030);
+}
+
+static void TestTimeout(cDNSResolver &res)
+{
+	vector<cDNSResolver::sResult> done;
+	string host;
+	res.mTTL = 60;
+	unsigned long lookups = res.mLookups;
+	res.Request(IP_SLOW);
+	res.Request(IP_SLOW); // second connection from same address while first lookup runs
+	TEST_CHECK(res.mLookups == (lookups + 1));
+	WaitCollect(res, done, 3000, 200); // caller gives up waiting here
+	TEST_CHECK(done.empty());
+	TEST_CHECK(res.Pending() == 1);
+	TEST_CHECK(!res.Find(IP_SLOW, host, 3000));
+	res.Purge(5000); // running lookup is never purged
+	sSlowRelease = true;
+	WaitCollect(res, done, 5000); // late answer is still cached for next connection
+	TEST_CHECK(FindResult(done, IP_SLOW) && (*FindResult(done, IP_SLOW) == "slow.example"));
+	TEST_CHECK(res.Pending() == 0);
+	TEST_CHECK(res.Find(IP_SLOW, host, 5001) && (host == "slow.example"));
+	res.Purge(6000);
+}
+
+static void TestZeroTTL(cDNSResolver &res)
+{
+	vector<cDNSResolver::sResult> done;
+	string host;
+	res.mTTL = 0; // dns_cache_ttl 0
+	int calls = sCalls;
+	res.Request(IP_NOCACHE);
+	WaitCollect(res, done, 7000);
+	TEST_CHECK(FindResult(done, IP_NOCACHE) && (*FindResult(done, IP_NOCACHE) == "nocache.example")); // waiting connections get the name
+	TEST_CHECK(!res.Find(IP_NOCACHE, host, 7000)); // but it is not cached
+	TEST_CHECK(res.Size() == 0);
+	TEST_CHECK(res.Pending() == 0);
+	res.Request(IP_NOCACHE); // next connection resolves again
+	WaitCollect(res, done, 7001);
+	TEST_CHECK(FindResult(done, IP_NOCACHE) != NULL);
+	TEST_CHECK(sCalls == (calls + 2));
+}
+
+int main()
+{
+	cDNSResolver res(2, NULL, StubResolve);
+	TestPositive(res);
+	TestNegative(res);
+	TestTimeout(res);
+	TestZeroTTL(res);
+	return TEST_RESULT();
+}
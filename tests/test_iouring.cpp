@@ -0,0 +1,272 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	cIOUring over loopback tcp connections, skipped when kernel does not support required io_uring features
+*/
+
+#include "test.h"
+#include "ciouring.h"
+#include "casyncconn.h"
+#include "cobj.h"
+#include <string>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// exit code that makes ctest report the test as skipped
+#define TEST_SKIPPED 77
+
+#if USE_IO_URING
+
+using namespace nVerliHub::nSocket;
+using namespace std;
+
+// hub side of a connection, gives test access to output queue and counts written bytes
+class cTestConn: public cAsyncConn
+{
+public:
+	cTestConn(int sd):
+		cAsyncConn(sd),
+		mWritten(0)
+	{}
+
+	cSendQueue& Queue()
+	{
+		return mBufSend;
+	}
+
+	size_t mWritten;
+
+protected:
+	virtual void OnWriteDone(int sent)
+	{
+		mWritten += sent;
+	}
+};
+
+// create connected pair of loopback tcp sockets, client side is nonblocking
+static bool MakePair(int &hub, int &client)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	int lis = socket(AF_INET, SOCK_STREAM, 0);
+	hub = client = -1;
+
+	if ((lis < 0) || bind(lis, (struct sockaddr*)&addr, sizeof(addr)) || listen(lis, 1) || getsockname(lis, (struct sockaddr*)&addr, &len)) {
+		if (lis >= 0)
+			close(lis);
+
+		return false;
+	}
+
+	client = socket(AF_INET, SOCK_STREAM, 0);
+
+	if ((client >= 0) && !connect(client, (struct sockaddr*)&addr, sizeof(addr)))
+		hub = accept(lis, NULL, NULL);
+
+	close(lis);
+
+	if (hub < 0)
+		return false;
+
+	fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+	fcntl(hub, F_SETFL, fcntl(hub, F_GETFL) | O_NONBLOCK); // as accepted connections of the hub
+	return true;
+}
+
+// run engine until given connection is reported with input
+static bool WaitReady(cIOUring &ring, cAsyncConn *conn, unsigned int ms = 2000)
+{
+	vector<cAsyncConn*> ready;
+
+	while (ms--) {
+		ring.Submit();
+		ready.clear();
+		ring.Reap(ready);
+
+		for (size_t pos = 0; pos < ready.size(); ++pos) {
+			if (ready[pos] == conn)
+				return true;
+		}
+
+		usleep(1000);
+	}
+
+	return false;
+}
+
+// read everything client has got so far
+static void ClientRead(int client, string &got)
+{
+	char buf[65536];
+	ssize_t len;
+
+	while ((len = recv(client, buf, sizeof(buf), 0)) > 0)
+		got.append(buf, len);
+}
+
+// multishot receive puts data into read buffer of connection
+static void TestRecv(cIOUring &ring, cTestConn *conn, int client)
+{
+	const unsigned long recvs = ring.mRecvs;
+	const string data = "$Supports NoGetINFO UserIP2|$Key abc|$ValidateNick test|";
+	TEST_CHECK(send(client, data.data(), data.size(), 0) == (ssize_t)data.size());
+	TEST_CHECK(WaitReady(ring, conn));
+	TEST_CHECK(ring.mRecvs > recvs);
+
+	string line;
+	const char *expect[] = { "$Supports NoGetINFO UserIP2", "$Key abc", "$ValidateNick test" };
+
+	for (size_t pos = 0; pos < (sizeof(expect) / sizeof(expect[0])); ++pos) {
+		conn->SetLineToRead(&line, '|', 1024);
+		conn->ReadLineLocal();
+		TEST_CHECK(conn->LineStatus() == AC_LS_LINE_DONE);
+		TEST_CHECK(line == expect[pos]);
+		conn->ClearLine();
+		line.clear();
+	}
+
+	TEST_CHECK(conn->BufferEmpty());
+}
+
+// whole output queue goes out by gathering sendmsg, short sends continue after socket becomes writable
+static void TestSend(cIOUring &ring, cTestConn *conn, int client, size_t segs, size_t seg_len)
+{
+	string expect, got;
+	const unsigned long sends = ring.mSends;
+	conn->mWritten = 0;
+
+	for (size_t pos = 0; pos < segs; ++pos) {
+		string seg(seg_len, 'a' + (pos % 26));
+		seg[seg_len - 1] = '|';
+		conn->Queue().Append(seg.data(), seg.size(), eTC_CONTROL);
+		expect += seg;
+	}
+
+	TEST_CHECK(conn->GetBufferSegments() == segs);
+	vector<cAsyncConn*> ready;
+	unsigned int ms = 5000;
+
+	while ((got.size() < expect.size()) && ms--) {
+		if (!conn->Queue().Empty()) // hub does this from OnIOUringSent through connection chooser
+			ring.Send(conn);
+
+		ring.Submit();
+		ring.Reap(ready);
+		ClientRead(client, got);
+
+		if (got.size() < expect.size())
+			usleep(1000);
+	}
+
+	TEST_CHECK(got == expect);
+	TEST_CHECK(conn->mWritten == expect.size());
+	TEST_CHECK(conn->Queue().Empty());
+	TEST_CHECK(ring.mSends > sends);
+	TEST_CHECK(ready.empty());
+}
+
+// deleting connection cancels its requests, so closing the socket closes connection for the peer, returns bytes peer got before
+static size_t TestDel(cIOUring &ring, cTestConn *conn, int client)
+{
+	TEST_CHECK(ring.Del(conn));
+	delete conn;
+
+	char buf[65536];
+	ssize_t len = -1;
+	size_t got = 0;
+	vector<cAsyncConn*> ready;
+
+	for (unsigned int ms = 2000; ms--;) {
+		ring.Reap(ready); // completes cancelled receive of deleted connection
+		while ((len = recv(client, buf, sizeof(buf), 0)) > 0) // drop data that was already sent
+			got += len;
+
+		if ((len == 0) || (errno != EAGAIN))
+			break;
+
+		usleep(1000);
+	}
+
+	TEST_CHECK(len == 0);
+	TEST_CHECK(ready.empty());
+	close(client);
+	return got;
+}
+
+int main()
+{
+	nVerliHub::cObj::msLogLevel = 0;
+	cIOUring ring;
+
+	if (!ring.Init(IOURING_ENTRIES)) {
+		cout << "io_uring is not supported, skipping" << endl;
+		return TEST_SKIPPED;
+	}
+
+	int hub, client;
+
+	if (!MakePair(hub, client)) {
+		cerr << "Failed to create loopback connection: " << strerror(errno) << endl;
+		return 1;
+	}
+
+	cTestConn *conn = new cTestConn(hub);
+	ring.Add(conn);
+	TestRecv(ring, conn, client);
+	TestSend(ring, conn, client, 8, 100); // single sendmsg
+	TestSend(ring, conn, client, SEND_QUEUE_IOV, 32768); // more than socket buffer takes
+	TestRecv(ring, conn, client); // receive is still armed
+	TestDel(ring, conn, client);
+
+	if (!MakePair(hub, client)) { // delete while kernel is sending
+		cerr << "Failed to create loopback connection: " << strerror(errno) << endl;
+		return 1;
+	}
+
+	conn = new cTestConn(hub);
+	ring.Add(conn);
+	string big(64 << 20, 'x'); // more than socket buffers take, so send waits for the peer
+	conn->Queue().Append(big.data(), big.size(), eTC_CONTROL);
+	ring.Send(conn);
+	ring.Submit();
+	TEST_CHECK(TestDel(ring, conn, client) < big.size()); // send was cancelled
+
+	cout << "io_uring: " << ring.mEnters << " calls, " << ring.mRecvs << " receives, " << ring.mSends << " sends" << endl;
+	return TEST_RESULT();
+}
+
+#else
+
+int main()
+{
+	std::cout << "Compiled without io_uring support, skipping" << std::endl;
+	return TEST_SKIPPED;
+}
+
+#endif
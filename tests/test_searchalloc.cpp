@@ -0,0 +1,198 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	allocations made by a parsed search routed to many users
+	message is parsed and split, search command is built from chunk views and sent to all users of a collection
+	every user queues shared segment like a connection does and sends it all, number of allocations must not depend on number of users
+*/
+
+#include "test.h"
+#include "cmessagedc.h"
+#include "cdcproto.h"
+#include "cusercollection.h"
+#include "cuser.h"
+#include "csendqueue.h"
+#include "cobj.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <new>
+#include <vector>
+
+using namespace nVerliHub;
+using namespace nVerliHub::nProtocol;
+using namespace nVerliHub::nSocket;
+using namespace nVerliHub::nEnums;
+
+// allocations are counted only while this is set
+static bool sCounting = false;
+static unsigned long sAllocs = 0;
+
+void* operator new(size_t size)
+{
+	if (sCounting)
+		sAllocs++;
+
+	void *ptr = malloc(size ? size : 1);
+
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+// user with output queue of a connection
+class cQueueUser: public cUserBase
+{
+public:
+	cQueueUser(const string &nick):
+		cUserBase(nick),
+		mReceived(0)
+	{}
+
+	virtual bool CanSend()
+	{
+		return true;
+	}
+
+	virtual void SendShared(cSendSegment *seg, bool)
+	{
+		mQueue.Append(seg, cSendQueue::Classify(seg->mData.data(), seg->mData.size()));
+	}
+
+	// everything was written to socket
+	void Sent()
+	{
+		mReceived += mQueue.Size();
+		mQueue.Consume(mQueue.Size());
+	}
+
+	cSendQueue mQueue;
+	size_t mReceived;
+};
+
+static const char *sSearches[] = {
+	"$Search 10.0.0.15:41412 F?T?0?9?TTH:LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ",
+	"$Search Hub:bob_the_builder F?T?0?1?ubuntu$22.04$desktop$amd64$iso",
+	"$Search 192.168.1.20:412 T?F?104857600?1?the$matrix$1080p",
+	"$Search Hub:alice F?T?0?9?TTH:TFQCNLV5ZJ6JTBKSAAEPGN3UNBVTGMCHXJ5YQBI"
+};
+
+#define SEARCH_COUNT (sizeof(sSearches) / sizeof(sSearches[0]))
+
+// same steps as cDCProto::DC_Search on its way to cUserCollection::SendToAll, returns size of sent command
+static size_t RouteSearch(cMessageDC &msg, cUserCollection &users, vector<cQueueUser*> &list, const char *line)
+{
+	msg.ReInit();
+	msg.mStr.append(line); // connection reads into reserved message buffer
+	const int type = msg.Parse();
+	TEST_CHECK((type == eDC_SEARCH) || (type == eDC_SEARCH_PAS));
+	TEST_CHECK(msg.SplitChunks() == false); // returns error flag
+	cChunkView lims, spat;
+	string saddr, search;
+
+	if (type == eDC_SEARCH_PAS) {
+		saddr.append("Hub:");
+		msg.ChunkView(eCH_PS_NICK).AppendTo(saddr);
+		lims = msg.ChunkView(eCH_PS_SEARCHLIMITS);
+		spat = msg.ChunkView(eCH_PS_SEARCHPATTERN);
+	} else {
+		msg.ChunkView(eCH_AS_IP).AppendTo(saddr);
+		saddr.append(1, ':');
+		msg.ChunkView(eCH_AS_PORT).AppendTo(saddr);
+		lims = msg.ChunkView(eCH_AS_SEARCHLIMITS);
+		spat = msg.ChunkView(eCH_AS_SEARCHPATTERN);
+	}
+
+	cDCProto::Create_Search(search, saddr, lims, spat, true);
+	TEST_CHECK(search == line);
+	users.SendToAll(search, true, true);
+
+	for (size_t i = 0; i < list.size(); i++)
+		list[i]->Sent();
+
+	return search.size() + 1; // with pipe
+}
+
+static void TestUsers(unsigned int count, unsigned long &per_search)
+{
+	cUserCollection users(false, false, false);
+	vector<cQueueUser*> list;
+	cMessageDC msg;
+	char nick[32];
+	size_t sent = 0;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		sprintf(nick, "user%u", i);
+		list.push_back(new cQueueUser(nick));
+		TEST_CHECK(users.Add(list.back()));
+	}
+
+	for (i = 0; i < (SEARCH_COUNT * 2); i++) // warm up pools and reserved buffers
+		sent += RouteSearch(msg, users, list, sSearches[i % SEARCH_COUNT]);
+
+	const unsigned int rounds = SEARCH_COUNT * 25;
+	sAllocs = 0;
+	sCounting = true;
+
+	for (i = 0; i < rounds; i++)
+		sent += RouteSearch(msg, users, list, sSearches[i % SEARCH_COUNT]);
+
+	sCounting = false;
+	per_search = (sAllocs + rounds - 1) / rounds;
+	cout << count << " users: " << sAllocs << " allocations for " << rounds << " searches" << endl;
+
+	for (i = 0; i < count; i++) { // every user got every search exactly once
+		TEST_CHECK(list[i]->mReceived == sent);
+		TEST_CHECK(list[i]->mQueue.Empty());
+		users.Remove(list[i]);
+		delete list[i];
+	}
+}
+
+int main()
+{
+	cObj::msLogLevel = 0;
+	unsigned long first = 0, per_search = 0;
+	const unsigned int counts[] = {1, 10, 100, 1000, 10000};
+
+	for (size_t i = 0; i < (sizeof(counts) / sizeof(counts[0])); i++) {
+		TestUsers(counts[i], per_search);
+
+		if (!i)
+			first = per_search;
+
+		TEST_CHECK(per_search == first); // same for any number of users
+		TEST_CHECK(per_search <= 4); // command and sender address, nothing per user
+	}
+
+	return TEST_RESULT();
+}
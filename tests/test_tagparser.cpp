@@ -0,0 +1,133 @@
+/*
+	Copyright (C) 2003-2005 Daniel Muller, dan at verliba dot cz
+	Copyright (C) 2006-2020 Verlihub Team, info at verlihub dot net
+
+	Verlihub is free software; You can redistribute it
+	and modify it under the terms of the GNU General
+	Public License as published by the Free Software
+	Foundation, either version 3 of the license, or at
+	your option any later version.
+
+	Verlihub is distributed in the hope that it will be
+	useful, but without any warranty, without even the
+	implied warranty of merchantability or fitness for
+	a particular purpose. See the GNU General Public
+	License for more details.
+
+	Please see http://www.gnu.org/licenses/ for a copy
+	of the GNU General Public License.
+*/
+
+/*
+	differential test of single pass tag parser against regular expressions it replaced
+	descriptions from tags.txt are compared as they are, with random changes and as random strings made of tag characters
+*/
+
+#include "test.h"
+#include "tagparser_regex.h"
+#include "cobj.h"
+
+// characters that mean something to the tag parser
+static const char sTagChars[] = "<>:,/.() -+vVmMhHsSlLbBfFrAPN50123456789x";
+
+static unsigned int sSeed = 12345;
+
+static unsigned int Random(unsigned int max)
+{
+	sSeed = (sSeed * 1103515245) + 12345;
+	return (sSeed >> 8) % max;
+}
+
+static char RandomChar()
+{
+	return sTagChars[Random(sizeof(sTagChars) - 1)];
+}
+
+static void Mutate(string &str)
+{
+	const unsigned int changes = 1 + Random(3);
+
+	for (unsigned int i = 0; i < changes; i++) {
+		const size_t pos = (str.empty() ? 0 : Random(str.size() + 1));
+
+		switch (Random(3)) {
+			case 0:
+				str.insert(pos, 1, RandomChar());
+				break;
+			case 1:
+				if (pos < str.size())
+					str.erase(pos, 1);
+
+				break;
+			default:
+				if (pos < str.size())
+					str[pos] = RandomChar();
+
+				break;
+		}
+	}
+}
+
+static unsigned long sCompared = 0;
+
+static bool Compare(cRegexTagParser &regex, const string &desc)
+{
+	sTagFields expect, got;
+
+	for (int sum = 1; sum <= 3; sum++) { // every hub summing mode
+		regex.Parse(desc, sum, expect);
+		ParseTagFields(desc, sum, got);
+		sCompared++;
+
+		if (!(got == expect)) {
+			cerr << "description: [" << desc << "] tag_sum_hubs=" << sum << endl;
+			cerr << "  regex:  " << expect << endl;
+			cerr << "  parser: " << got << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	cObj::msLogLevel = 0;
+	cRegexTagParser regex;
+	vector<string> tags;
+	size_t i;
+	int n;
+
+	TEST_CHECK(LoadTags(tags));
+
+	for (i = 0; i < tags.size(); i++)
+		TEST_CHECK(Compare(regex, tags[i]));
+
+	for (i = 0; i < tags.size(); i++) {
+		for (n = 0; n < 300; n++) {
+			string desc(tags[i]);
+			Mutate(desc);
+
+			if (!Compare(regex, desc)) {
+				TEST_CHECK(!"mutated description differs");
+				break;
+			}
+		}
+	}
+
+	for (n = 0; n < 20000; n++) {
+		string desc;
+		const unsigned int len = Random(40);
+
+		for (unsigned int c = 0; c < len; c++)
+			desc.append(1, RandomChar());
+
+		if (!Compare(regex, desc)) {
+			TEST_CHECK(!"random description differs");
+			break;
+		}
+	}
+
+	cout << sCompared << " descriptions compared" << endl;
+	return TEST_RESULT();
+}